@@ -0,0 +1,136 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <string>
+#include <deque>
+#include <algorithm>
+#include <ctype.h>
+
+using namespace std; 
+
+#include "ahocorasick.h"
+
+void tAhoCorasick::Clear ()
+{
+  patterns.clear ();
+  ids.clear ();
+  transitions.clear ();
+  outputs.clear ();
+  built = false;
+} // end of tAhoCorasick::Clear
+
+void tAhoCorasick::Add (const string & pattern, const int & id)
+{
+  if (pattern.empty ())
+    return;   // would match everything
+  patterns.push_back (pattern);
+  ids.push_back (id);
+  built = false;
+} // end of tAhoCorasick::Add
+
+void tAhoCorasick::Build ()
+{
+  // work out which characters we care about - upper and lower case share a column
+  fill (symbols, symbols + 256, 0);
+  symbolCount = 1;    // column 0 is everything else
+  for (vector<string>::const_iterator i = patterns.begin (); i != patterns.end (); ++i)
+    for (string::const_iterator c = i->begin (); c != i->end (); ++c)
+      {
+      unsigned char lower = tolower ((unsigned char) *c);
+      if (symbols [lower] == 0 && symbolCount < 256)
+        symbols [lower] = symbolCount++;
+      }
+  for (int c = 0; c < 256; ++c)
+    symbols [c] = symbols [(unsigned char) tolower (c)];
+      
+  // build the trie of patterns - state 0 is the root, -1 means no transition yet
+  transitions.assign (symbolCount, -1);
+  outputs.assign (1, vector<int> ());
+  
+  for (vector<string>::size_type i = 0; i < patterns.size (); ++i)
+    {
+    int state = 0;
+    for (string::const_iterator c = patterns [i].begin (); c != patterns [i].end (); ++c)
+      {
+      int & next = transitions [state * symbolCount + symbols [(unsigned char) *c]];
+      if (next == -1)
+        {
+        next = outputs.size ();   // new state
+        outputs.push_back (vector<int> ());
+        transitions.resize (transitions.size () + symbolCount, -1);
+        }
+      state = transitions [state * symbolCount + symbols [(unsigned char) *c]];
+      }
+    outputs [state].push_back (ids [i]);
+    } // end of each pattern
+    
+  // breadth-first, fill in the failure transitions so every state has
+  // somewhere to go on every symbol (this makes it a DFA)
+  vector<int> fail (outputs.size (), 0);
+  deque<int> queue;
+  
+  for (int s = 0; s < symbolCount; ++s)
+    {
+    int & next = transitions [s];
+    if (next == -1)
+      next = 0;     // stay at root
+    else
+      queue.push_back (next);
+    }
+    
+  while (!queue.empty ())
+    {
+    int state = queue.front ();
+    queue.pop_front ();
+    
+    // anything matched by the failure state is matched here too
+    const vector<int> & inherited = outputs [fail [state]];
+    outputs [state].insert (outputs [state].end (), inherited.begin (), inherited.end ());
+    
+    for (int s = 0; s < symbolCount; ++s)
+      {
+      int & next = transitions [state * symbolCount + s];
+      int fallback = transitions [fail [state] * symbolCount + s];
+      if (next == -1)
+        next = fallback;
+      else
+        {
+        fail [next] = fallback;
+        queue.push_back (next);
+        }
+      }
+    } // end of processing queue
+    
+  built = true;
+} // end of tAhoCorasick::Build
+
+void tAhoCorasick::Match (const string & text, vector<int> & found) const
+{
+  found.clear ();
+  if (!built || outputs.empty ())
+    return;
+    
+  int state = 0;
+  for (string::const_iterator c = text.begin (); c != text.end (); ++c)
+    {
+    state = transitions [state * symbolCount + symbols [(unsigned char) *c]];
+    
+    const vector<int> & matched = outputs [state];
+    for (vector<int>::const_iterator i = matched.begin (); i != matched.end (); ++i)
+      if (find (found.begin (), found.end (), *i) == found.end ())
+        found.push_back (*i);
+    } // end of each character
+} // end of tAhoCorasick::Match
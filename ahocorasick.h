@@ -0,0 +1,40 @@
+#ifndef TINYMUDSERVER_AHOCORASICK_H
+#define TINYMUDSERVER_AHOCORASICK_H
+
+#include <vector>
+
+/*---------------------------------------------- */
+/*  Aho-Corasick - find many patterns in one pass */
+/*---------------------------------------------- */
+
+/*
+ All the patterns are compiled into one state machine, so a message is
+ scanned once, a character at a time, no matter how many patterns there are.
+ Matching is case-independent, the same as ciLess.
+*/
+
+class tAhoCorasick
+  {
+  std::vector<string> patterns;     // what we are looking for
+  std::vector<int> ids;             // what the caller calls each pattern
+  
+  unsigned char symbols [256];      // character -> column in transitions (0 = not in any pattern)
+  int symbolCount;                  // columns in transitions
+  std::vector<int> transitions;     // state * symbolCount + symbol -> next state
+  std::vector<std::vector<int> > outputs;   // ids matched on reaching each state
+  bool built;
+  
+  public:
+  
+  tAhoCorasick () : symbolCount (1), built (false) {}
+  
+  void Clear ();
+  void Add (const string & pattern, const int & id);  // needs Build afterwards
+  void Build ();
+  bool IsBuilt () const { return built; }
+  
+  // ids of all patterns found in the text (each one once, in order of first match)
+  void Match (const string & text, std::vector<int> & found) const;
+  };  // end of class tAhoCorasick
+
+#endif // TINYMUDSERVER_AHOCORASICK_H
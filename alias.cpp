@@ -0,0 +1,163 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <string>
+#include <algorithm>
+#include <sstream>
+
+using namespace std; 
+
+#include "strings.h"
+#include "alias.h"
+
+// which node follows this one for character c? -1 if none
+int tAliasTrie::Child (const int & node, const char c) const
+{
+  const vector<pair<char, int> > & children = nodes [node].children;
+  for (vector<pair<char, int> >::const_iterator i = children.begin (); i != children.end (); ++i)
+    if (i->first == c)
+      return i->second;
+  return -1;
+} // end of tAliasTrie::Child
+
+void tAliasTrie::Clear ()
+{
+  nodes.clear ();
+  expansions.clear ();
+  count = 0;
+} // end of tAliasTrie::Clear
+
+void tAliasTrie::Add (const string & name, const string & expansion)
+{
+  if (nodes.empty ())
+    nodes.push_back (tNode ());   // the root
+    
+  int node = 0;
+  for (string::const_iterator c = name.begin (); c != name.end (); ++c)
+    {
+    char lower = tolower ((unsigned char) *c);
+    int next = Child (node, lower);
+    if (next == -1)
+      {
+      next = nodes.size ();
+      nodes.push_back (tNode ());
+      nodes [node].children.push_back (make_pair (lower, next));
+      }
+    node = next;
+    }
+    
+  if (nodes [node].expansion == -1)
+    {
+    nodes [node].expansion = expansions.size ();
+    expansions.push_back (make_pair (name, expansion));
+    ++count;
+    }
+  else
+    expansions [nodes [node].expansion] = make_pair (name, expansion);
+} // end of tAliasTrie::Add
+
+bool tAliasTrie::Remove (const string & name)
+{
+  int node = 0;
+  for (string::const_iterator c = name.begin (); c != name.end () && node != -1; ++c)
+    node = nodes.empty () ? -1 : Child (node, tolower ((unsigned char) *c));
+    
+  if (node == -1 || nodes.empty () || nodes [node].expansion == -1)
+    return false;
+  
+  // the expansion slot is left empty - it all goes when the last one does
+  expansions [nodes [node].expansion].first.erase ();
+  nodes [node].expansion = -1;
+  if (--count == 0)
+    Clear ();
+  return true;
+} // end of tAliasTrie::Remove
+
+const string * tAliasTrie::Find (const string & name) const
+{
+  if (count == 0)
+    return NULL;
+    
+  int node = 0;
+  for (string::const_iterator c = name.begin (); c != name.end (); ++c)
+    if ((node = Child (node, tolower ((unsigned char) *c))) == -1)
+      return NULL;
+    
+  if (nodes [node].expansion == -1)
+    return NULL;
+  return &expansions [nodes [node].expansion].second;
+} // end of tAliasTrie::Find
+
+// functor for sorting aliases by name
+struct aliasNameLess
+{
+  bool operator() (const pair<string, string> & a1, const pair<string, string> & a2) const
+    { return ciLess () (a1.first, a2.first); }
+};  // end of aliasNameLess
+
+vector<pair<string, string> > tAliasTrie::List () const
+{
+  vector<pair<string, string> > result;
+  for (vector<pair<string, string> >::const_iterator i = expansions.begin (); 
+       i != expansions.end (); ++i)
+    if (!i->first.empty ())   // skip removed ones
+      result.push_back (*i);
+  sort (result.begin (), result.end (), aliasNameLess ());
+  return result;
+} // end of tAliasTrie::List
+
+string ExpandAlias (const string & expansion, const string & args)
+{
+  // split up the arguments
+  vector<string> words;
+  istringstream is (args);
+  string word;
+  while (is >> word)
+    words.push_back (word);
+  
+  string result;
+  bool substituted = false;
+  
+  for (string::size_type i = 0; i < expansion.size (); ++i)
+    {
+    if (expansion [i] == '$' && i + 1 < expansion.size ())
+      {
+      char c = expansion [i + 1];
+      if (c == '*')
+        {
+        result += args;
+        substituted = true;
+        ++i;
+        continue;
+        }
+      if (c >= '1' && c <= '9')
+        {
+        vector<string>::size_type n = c - '1';
+        if (n < words.size ())
+          result += words [n];
+        substituted = true;
+        ++i;
+        continue;
+        }
+      }
+    result += expansion [i];
+    } // end of each character
+    
+  if (!substituted && !args.empty ())
+    result += " " + args;
+    
+  return result;
+} // end of ExpandAlias
@@ -0,0 +1,52 @@
+#ifndef TINYMUDSERVER_ALIAS_H
+#define TINYMUDSERVER_ALIAS_H
+
+#include <vector>
+#include <utility>
+
+/*---------------------------------------------- */
+/*  a player's aliases (eg. gs = get sword), in a trie */
+/*---------------------------------------------- */
+
+/*
+ Alias names are looked up a character at a time, case-independently,
+ so finding one costs the length of the word typed, not the number of aliases.
+*/
+
+class tAliasTrie
+  {
+  // a node for each prefix of an alias name
+  struct tNode
+    {
+    std::vector<std::pair<char, int> > children;  // next character -> node
+    int expansion;    // index into expansions, -1 if no alias ends here
+    tNode () : expansion (-1) {}
+    };  // end of tNode
+    
+  std::vector<tNode> nodes;   // node 0 is the root
+  std::vector<std::pair<string, string> > expansions;  // name, what it expands to
+  int count;                  // aliases defined
+  
+  int Child (const int & node, const char c) const;
+  
+  public:
+  
+  tAliasTrie () : count (0) {}
+  
+  bool Empty () const { return count == 0; }
+  unsigned int Size () const { return count; }
+  void Clear ();
+  
+  void Add (const string & name, const string & expansion);  // replaces an existing one
+  bool Remove (const string & name);    // false if not there
+  const string * Find (const string & name) const;  // NULL if not there
+  
+  // all of them, sorted by name
+  std::vector<std::pair<string, string> > List () const;
+  };  // end of class tAliasTrie
+
+// replace $1 to $9 with words from args, and $* with all of them
+// (if there are no $ variables, args go on the end)
+string ExpandAlias (const string & expansion, const string & args);
+
+#endif // TINYMUDSERVER_ALIAS_H
@@ -0,0 +1,117 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <pthread.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+
+using namespace std; 
+
+#include "constants.h"
+#include "arena.h"
+
+// one thread's memory for temporaries
+class tArena
+  {
+  vector<char*> blocks;   // all the memory we got, each ARENA_BLOCK_SIZE
+  size_t block;           // the block in use
+  size_t used;            // bytes used in it
+  
+  public:
+  
+  tArena () : block (0), used (ARENA_BLOCK_SIZE) {}   // no block yet
+  
+  void * Allocate (size_t size)
+    {
+    size = (size + 15) & ~size_t (15);    // keep everything 16-byte aligned
+    
+    // on to the next block, making it if this is the most we have needed
+    if (used + size > ARENA_BLOCK_SIZE)
+      {
+      if (!blocks.empty ())
+        ++block;
+      if (block == blocks.size ())
+        blocks.push_back (new char [ARENA_BLOCK_SIZE]);
+      used = 0;
+      }
+      
+    void * p = blocks [block] + used;
+    used += size;
+    return p;
+    }
+    
+  // only the last thing made can be given back
+  void Free (void * p, size_t size)
+    {
+    size = (size + 15) & ~size_t (15);
+    if (!blocks.empty () && used >= size && (char *) p + size == blocks [block] + used)
+      used -= size;
+    }
+    
+  // keep the blocks, for next tick
+  void Reset ()
+    {
+    block = 0;
+    used = blocks.empty () ? ARENA_BLOCK_SIZE : 0;
+    }
+  };  // end of class tArena
+
+template class std::basic_string<char, std::char_traits<char>, tArenaAllocator<char> >;
+template class std::basic_stringbuf<char, std::char_traits<char>, tArenaAllocator<char> >;
+template class std::basic_istringstream<char, std::char_traits<char>, tArenaAllocator<char> >;
+template class std::vector<tTempString, tArenaAllocator<tTempString> >;
+
+static vector<tArena*> arenas;    // every thread that has made temporaries
+static pthread_mutex_t arenaslock = PTHREAD_MUTEX_INITIALIZER;
+static __thread tArena * myarena = NULL;
+
+// this thread's arena, made the first time it needs one
+static tArena * MyArena ()
+{
+  if (myarena == NULL)
+    {
+    myarena = new tArena;
+    pthread_mutex_lock (&arenaslock);
+    arenas.push_back (myarena);
+    pthread_mutex_unlock (&arenaslock);
+    }
+  return myarena;
+} // end of MyArena
+
+void * ArenaAllocate (const size_t size)
+{
+  if (size > ARENA_LARGE_SIZE)
+    return ::operator new (size);
+  return MyArena ()->Allocate (size);
+} // end of ArenaAllocate
+
+void ArenaFree (void * p, const size_t size)
+{
+  if (size > ARENA_LARGE_SIZE)
+    ::operator delete (p);
+  else
+    MyArena ()->Free (p, size);
+} // end of ArenaFree
+
+// only between ticks - the worker threads are waiting for work then
+void ResetArenas ()
+{
+  pthread_mutex_lock (&arenaslock);
+  for (vector<tArena*>::const_iterator i = arenas.begin (); i != arenas.end (); ++i)
+    (*i)->Reset ();
+  pthread_mutex_unlock (&arenaslock);
+} // end of ResetArenas
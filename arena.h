@@ -0,0 +1,74 @@
+#ifndef TINYMUDSERVER_ARENA_H
+#define TINYMUDSERVER_ARENA_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <sstream>
+
+/*---------------------------------------------- */
+/*  arena - memory for temporaries, freed each tick */
+/*---------------------------------------------- */
+
+/*
+ Working on a command makes lots of short-lived strings (the line, each
+ command in it, the words, the messages sent). Made as a tTempString
+ (or tTempStream, tTempStrings) they are carved out of large blocks
+ belonging to the thread, by moving a pointer along - no lock, and no
+ call to "new". Deleting one only gets its memory back if it was the
+ last thing made (as temporaries usually are). At the end of each tick,
+ when no command is running, ResetArenas starts every thread's blocks again.
+
+ Anything bigger than ARENA_LARGE_SIZE (eg. the list of a hundred players
+ in a room, as it grows) is got with "new" as usual, so that its memory
+ is reused straight away rather than at the end of the tick.
+
+ Nothing made from an arena may be kept past the end of the tick:
+ copy it into a string first (as tPlayer::operator<< does).
+*/
+
+// memory from this thread's arena (aligned for anything)
+void * ArenaAllocate (const size_t size);
+
+// finished with it (the same size as allocated)
+void ArenaFree (void * p, const size_t size);
+
+// end of the tick - every thread's temporaries are finished with
+void ResetArenas ();
+
+// STL allocator using the arena (eg. for strings, vectors)
+template <typename T>
+class tArenaAllocator
+  {
+  public:
+  typedef T value_type;
+
+  tArenaAllocator () {}
+  template <typename U> tArenaAllocator (const tArenaAllocator<U> &) {}
+
+  T * allocate (const size_t n) { return static_cast<T *> (ArenaAllocate (n * sizeof (T))); }
+  void deallocate (T * p, const size_t n) { ArenaFree (p, n * sizeof (T)); }
+
+  // any one can free what another allocated
+  template <typename U> bool operator== (const tArenaAllocator<U> &) const { return true; }
+  template <typename U> bool operator!= (const tArenaAllocator<U> &) const { return false; }
+  };  // end of class tArenaAllocator
+
+typedef std::basic_string<char, std::char_traits<char>, tArenaAllocator<char> > tTempString;
+typedef std::basic_istringstream<char, std::char_traits<char>, tArenaAllocator<char> > tTempStream;
+typedef std::vector<tTempString, tArenaAllocator<tTempString> > tTempStrings;
+
+// their code is made once, in arena.cpp, which is built optimised - as the 
+// library's own string and stream code is
+extern template class std::basic_string<char, std::char_traits<char>, tArenaAllocator<char> >;
+extern template class std::basic_stringbuf<char, std::char_traits<char>, tArenaAllocator<char> >;
+extern template class std::basic_istringstream<char, std::char_traits<char>, tArenaAllocator<char> >;
+extern template class std::vector<tTempString, tArenaAllocator<tTempString> >;
+
+// a temporary copy of a string (eg. "Tell " + Temp (p->playername) + " what?")
+inline tTempString Temp (const std::string & s)
+{
+  return tTempString (s.data (), s.size ());
+} // end of Temp
+
+#endif // TINYMUDSERVER_ARENA_H
@@ -0,0 +1,204 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <vector>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+using namespace std; 
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "room.h"
+#include "globals.h"
+#include "broadcast.h"
+
+// people moving the same way in the same room during one tick
+struct tRoomEvent
+  {
+  bool arriving;                // true = enters, false = goes
+  int room;                     // where it is seen
+  string direction;             // which way they went, or came from
+  vector<string> names;         // who moved, in order
+  vector<const tPlayer *> players;  // the player for each name (NULL if not a player)
+  set<const tPlayer *> movers;  // so they don't see their own movement
+  };  // end of tRoomEvent
+
+// events queued so far this tick, in the order they first happened
+static vector<tRoomEvent> roomevents;
+
+// where to find each event in roomevents, by (arriving, room, direction)
+typedef pair <pair <bool, int>, string> tRoomEventKey;
+static map<tRoomEventKey, vector<tRoomEvent>::size_type> roomeventindex;
+
+// add a mover to a matching event, or start a new one
+// (p is NULL if the mover is not a player)
+static void QueueRoomEvent (const tPlayer * p, const string & name, const bool arriving, 
+                            const int & room, const string & direction)
+{
+  tRoomEventKey key (make_pair (arriving, room), direction);
+  map<tRoomEventKey, vector<tRoomEvent>::size_type>::const_iterator i = roomeventindex.find (key);
+  if (i != roomeventindex.end ())
+    {
+    tRoomEvent & event = roomevents [i->second];
+    if (p == NULL || event.movers.insert (p).second)
+      {
+      event.names.push_back (name);
+      event.players.push_back (p);
+      }
+    return;
+    }
+  
+  roomeventindex [key] = roomevents.size ();
+  
+  tRoomEvent event;
+  event.arriving = arriving;
+  event.room = room;
+  event.direction = direction;
+  event.names.push_back (name);
+  event.players.push_back (p);
+  if (p)
+    event.movers.insert (p);
+  roomevents.push_back (event);
+} // end of QueueRoomEvent
+
+// find the exit leading back where they came from (eg. s if they went n)
+static string ExitBackTo (const int & room, const int & fromRoom)
+{
+  string direction;
+  
+  tRoomMapIterator roomiter = roommap.find (room);
+  if (roomiter != roommap.end ())
+    {
+    const tExitMap & exits = roomiter->second->exits;
+    for (tExitMap::const_iterator exititer = exits.begin ();
+         exititer != exits.end (); ++exititer)
+      if (exititer->second == fromRoom)
+        {
+        direction = exititer->first;
+        break;
+        }
+    }
+      
+  return direction;
+} // end of ExitBackTo
+
+void QueueDeparture (const tPlayer * p, const int & room, const string & direction)
+{
+  QueueRoomEvent (p, p->playername, false, room, direction);
+} // end of QueueDeparture
+
+void QueueArrival (const tPlayer * p, const int & room, const int & fromRoom)
+{
+  QueueRoomEvent (p, p->playername, true, room, ExitBackTo (room, fromRoom));
+} // end of QueueArrival
+
+void QueueDeparture (const string & name, const int & room, const string & direction)
+{
+  QueueRoomEvent (NULL, name, false, room, direction);
+} // end of QueueDeparture
+
+void QueueArrival (const string & name, const int & room, const int & fromRoom)
+{
+  QueueRoomEvent (NULL, name, true, room, ExitBackTo (room, fromRoom));
+} // end of QueueArrival
+
+// eg. "Nick", "Nick and Bob", "Nick, Bob, Sue and 5 others"
+static string ListNames (const vector<string> & names)
+{
+  string result;
+  int shown = names.size () > MAX_NAMES_LISTED + 1 ? MAX_NAMES_LISTED : names.size ();
+  int others = names.size () - shown;
+  
+  for (int i = 0; i < shown; ++i)
+    {
+    if (i > 0)
+      result += (i == shown - 1 && others == 0) ? " and " : ", ";
+    result += names [i];
+    }
+    
+  if (others)
+    result += MAKE_STRING (" and " << others << " others");
+  
+  return result;
+} // end of ListNames
+
+// what the others in the room see - or one of the movers, who doesn't see themselves
+// (empty if that leaves nobody)
+static string DescribeRoomEvent (const tRoomEvent & event, const tPlayer * mover = NULL)
+{
+  vector<string> names;
+  for (vector<string>::size_type i = 0; i < event.names.size (); ++i)
+    if (mover == NULL || event.players [i] != mover)
+      names.push_back (event.names [i]);
+  if (names.empty ())
+    return "";
+    
+  bool plural = names.size () > 1;
+  string message = tosentence (ListNames (names));   // eg. A rat enters
+  
+  if (event.arriving)
+    {
+    message += plural ? " enter" : " enters";
+    if (!event.direction.empty ())
+      message += " from " + event.direction;
+    }
+  else
+    message += (plural ? " go " : " goes ") + event.direction;
+    
+  return message + ".\n";
+} // end of DescribeRoomEvent
+
+void FlushRoomEvents ()
+{
+  if (roomevents.empty ())
+    return;
+  
+  // which events happened in each room
+  map<int, vector<const tRoomEvent *> > eventsbyroom;
+  for (vector<tRoomEvent>::const_iterator i = roomevents.begin (); i != roomevents.end (); ++i)
+    eventsbyroom [i->room].push_back (&*i);
+
+  // the message for each event is built once, and shared by everyone who sees it
+  map<const tRoomEvent *, string> messages;
+  for (vector<tRoomEvent>::const_iterator i = roomevents.begin (); i != roomevents.end (); ++i)
+    messages [&*i] = DescribeRoomEvent (*i);
+  
+  // the players in each of those rooms are told what happened there
+  for (map<int, vector<const tRoomEvent *> >::const_iterator roomiter = eventsbyroom.begin (); 
+       roomiter != eventsbyroom.end (); ++roomiter)
+    {
+    tRoomPlayersMapIterator playersiter = roomplayersmap.find (roomiter->first);
+    if (playersiter == roomplayersmap.end ())
+      continue;   // nobody to see it
+      
+    const vector<tPlayer *> & players = playersiter->second;
+    for (vector<tPlayer *>::const_iterator p = players.begin (); p != players.end (); ++p)
+      for (vector<const tRoomEvent *>::const_iterator i = roomiter->second.begin (); 
+           i != roomiter->second.end (); ++i)
+        {
+        if ((*i)->movers.find (*p) == (*i)->movers.end ())
+          **p << messages [*i];
+        else
+          **p << DescribeRoomEvent (**i, *p);   // the others who came (or went) with them
+        }
+    } // end of each room
+    
+  roomevents.clear ();
+  roomeventindex.clear ();
+} // end of FlushRoomEvents
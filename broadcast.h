@@ -0,0 +1,20 @@
+#ifndef TINYMUDSERVER_BROADCAST_H
+#define TINYMUDSERVER_BROADCAST_H
+
+// broadcast.h - room messages that are merged and sent once per tick
+
+// tell others in the room someone left (eg. Nick goes n)
+void QueueDeparture (const tPlayer * p, const int & room, const string & direction);
+
+// tell others in the room someone arrived (eg. Nick enters from s)
+void QueueArrival (const tPlayer * p, const int & room, const int & fromRoom);
+
+// the same for things that are not players (eg. mobiles)
+void QueueDeparture (const string & name, const int & room, const string & direction);
+void QueueArrival (const string & name, const int & room, const int & fromRoom);
+
+// send everything queued this tick, merged per room (eg. Nick and Bob enter) -
+// the movers see the others who moved with them (eg. Bob enters, for Nick)
+void FlushRoomEvents ();
+
+#endif // TINYMUDSERVER_BROADCAST_H
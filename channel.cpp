@@ -0,0 +1,87 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std; 
+
+#include "utils.h"
+#include "player.h"
+#include "channel.h"
+#include "globals.h"
+
+void tChannel::Subscribe (tPlayer * p)
+{
+  vector<tPlayer*>::iterator i = lower_bound (subscribers.begin (), subscribers.end (), p);
+  if (i == subscribers.end () || *i != p)
+    subscribers.insert (i, p);
+} // end of tChannel::Subscribe
+
+void tChannel::Unsubscribe (tPlayer * p)
+{
+  vector<tPlayer*>::iterator i = lower_bound (subscribers.begin (), subscribers.end (), p);
+  if (i != subscribers.end () && *i == p)
+    subscribers.erase (i);
+} // end of tChannel::Unsubscribe
+
+bool tChannel::IsSubscribed (tPlayer * p) const
+{
+  return binary_search (subscribers.begin (), subscribers.end (), p);
+} // end of tChannel::IsSubscribed
+
+// the same message goes to every subscriber, nobody else is looked at
+void tChannel::Post (const string & message) const
+{
+  for (vector<tPlayer*>::const_iterator i = subscribers.begin (); 
+       i != subscribers.end (); ++i)
+    if ((*i)->IsPlaying ())
+      **i << message;
+} // end of tChannel::Post
+
+tChannel * FindChannel (const string & name)
+{
+  tChannelMapIterator channeliter = channelmap.find (name);
+  
+  if (channeliter == channelmap.end ())
+    return NULL;
+    
+  return channeliter->second;
+} // end of FindChannel
+
+// called when they enter the game
+void JoinChannels (tPlayer * p)
+{
+  for (set<string, ciLess>::const_iterator i = p->channels.begin (); 
+       i != p->channels.end (); ++i)
+    {
+    tChannel * c = FindChannel (*i);
+    if (c)    // channel might have been removed from the control file
+      c->Subscribe (p);
+    }
+} // end of JoinChannels
+
+// called when they are deleted
+void LeaveChannels (tPlayer * p)
+{
+  for (set<string, ciLess>::const_iterator i = p->channels.begin (); 
+       i != p->channels.end (); ++i)
+    {
+    tChannel * c = FindChannel (*i);
+    if (c)
+      c->Unsubscribe (p);
+    }
+} // end of LeaveChannels
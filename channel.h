@@ -0,0 +1,35 @@
+#ifndef TINYMUDSERVER_CHANNEL_H
+#define TINYMUDSERVER_CHANNEL_H
+
+#include <map>
+#include <vector>
+
+// a chat channel (eg. newbie, trade) and the players listening to it
+class tChannel
+  {
+  public:
+  
+  string name;                        // channel name
+  std::vector<tPlayer*> subscribers;  // who is listening, kept sorted
+
+  // ctor
+  tChannel (const string & n) : name (n) {}
+  
+  void Subscribe   (tPlayer * p);
+  void Unsubscribe (tPlayer * p);
+  bool IsSubscribed (tPlayer * p) const;
+  
+  // send to everyone listening
+  void Post (const string & message) const;
+  };  // end of class tChannel
+
+// we will use a map of channels, keyed by name
+typedef std::map <string, tChannel*, ciLess> tChannelMap;
+typedef tChannelMap::const_iterator tChannelMapIterator;
+
+tChannel * FindChannel (const string & name);
+
+void JoinChannels (tPlayer * p);    // listen to the player's saved channels
+void LeaveChannels (tPlayer * p);   // stop listening to all channels
+
+#endif // TINYMUDSERVER_CHANNEL_H
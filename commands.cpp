@@ -14,8 +14,10 @@ warranty, and with no claim as to its suitability for any purpose.
 
 // standard library includes ...
 
+#include <stdio.h>
 #include <stdexcept>
 #include <iostream>
+#include <vector>
 
 using namespace std; 
 
@@ -25,6 +27,14 @@ using namespace std;
 #include "player.h"
 #include "room.h"
 #include "globals.h"
+#include "broadcast.h"
+#include "trigger.h"
+#include "editdistance.h"
+#include "metrics.h"
+#include "gameclock.h"
+#include "log.h"
+#include "journal.h"
+#include "gatewaylink.h"
 
 void NoMore (tPlayer * p, istream & sArgs)
   {
@@ -35,13 +45,13 @@ void NoMore (tPlayer * p, istream & sArgs)
   } // end of NoMore
 
 // helper function for say, tell, chat, etc.
-string GetMessage (istream & sArgs, const string & noMessageError)
+tTempString GetMessage (istream & sArgs, const tTempString & noMessageError)
   {
-  string message;
+  tTempString message;
   sArgs >> ws;  // skip leading spaces
   getline (sArgs, message); // get rest of line
   if (message.empty ()) // better have something
-    throw runtime_error (noMessageError);
+    throw runtime_error (noMessageError.c_str ());
   return message;  
   } // end of GetMessage
   
@@ -59,16 +69,22 @@ string GetFlag (istream & sArgs, const string & noFlagError)
     
 void PlayerToRoom (tPlayer * p,       // which player
                   const int & vnum,   // which room
-                  const string & sPlayerMessage,  // what to tell the player
-                  const string & sOthersDepartMessage,  // tell people in original room 
-                  const string & sOthersArrriveMessage) // tell people in new room
+                  const tTempString & sPlayerMessage,  // what to tell the player
+                  const tTempString & sOthersDepartMessage,  // tell people in original room 
+                  const tTempString & sOthersArrriveMessage) // tell people in new room
 {
   tRoom * r = FindRoom (vnum); // find the destination room (throws exception if not there)
-  SendToAll (sOthersDepartMessage, p, p->room);  // tell others where s/he went
-  p->room = vnum;  // move to new room
+  StopFighting (p);  // they get away from whatever they were fighting
+  if (!sOthersDepartMessage.empty ())
+    SendToAll (sOthersDepartMessage, p, p->room);  // tell others where s/he went
+  p->MoveTo (vnum);  // move to new room
   *p << sPlayerMessage; // tell player
-  p->DoCommand ("look");   // look around new room  
-  SendToAll (sOthersArrriveMessage, p, p->room);  // tell others ws/he has arrived  
+  if (p->batching)
+    p->pendingLook = true;  // only look at the last room of a batch
+  else
+    p->DoCommand ("look");   // look around new room  
+  if (!sOthersArrriveMessage.empty ())
+    SendToAll (sOthersArrriveMessage, p, p->room);  // tell others ws/he has arrived  
 } // end of PlayerToRoom
 
 void DoDirection (tPlayer * p, const string & sArgs)
@@ -82,11 +98,13 @@ void DoDirection (tPlayer * p, const string & sArgs)
   if (exititer == r->exits.end ())
     throw runtime_error ("You cannot go that way.");
 
-  // move player
-  PlayerToRoom (p, exititer->second,
-                "You go " + sArgs + "\n",
-                p->playername + " goes " + sArgs + "\n",
-                p->playername + " enters.\n");
+  int fromRoom = p->room;
+  
+  // move player - others are told at the end of the tick, so that 
+  // people moving together give one message (eg. Nick and Bob enter from s)
+  PlayerToRoom (p, exititer->second, "You go " + Temp (sArgs) + "\n", "", "");
+  QueueDeparture (p, fromRoom, sArgs);
+  QueueArrival (p, p->room, fromRoom);
   
   } // end of DoDirection
   
@@ -101,18 +119,38 @@ void DoQuit (tPlayer * p, istream & sArgs)
   if (p->connstate == ePlaying)
     {
     *p << "See you next time!\n";
-    cout << "Player " << p->playername << " has left the game.\n";
+    Log (eLogInfo, "Player " + p->playername + " has left the game.");
     SendToAll ("Player " + p->playername + " has left the game.\n", p);   
     } /* end of properly connected */
 
   p->ClosePlayer ();
   } // end of DoQuit
 
+// find an object the player is carrying, or that is in the room with them
+tObject * FindNearbyObject (tPlayer * p, const string & which)
+  {
+  tObject * o = p->inventory.Find (which);
+  if (o == NULL)
+    o = FindRoom (p->room)->contents.Find (which);
+  return o;
+  } // end of FindNearbyObject
+
 void lookObject (tPlayer * p, string & which)
   {
-  *p << "Looking at object " << which << "\n";
+  tObject * o = FindNearbyObject (p, which);
+  if (o == NULL)
+    throw runtime_error ("You don't see that here.");
+    
+  *p << o->proto->description;
 
-  // scan available objects and display information about them ...
+  // show what is inside containers
+  if (o->proto->flags & OBJ_CONTAINER)
+    {
+    if (o->contents.Empty ())
+      *p << "It is empty.\n";
+    else
+      *p << "It contains:\n" << DescribeObjects (o->contents, false);
+    }
   }  // end of lookObject
 
 /* look */
@@ -135,44 +173,39 @@ void DoLook (tPlayer * p, istream & sArgs)
   // find our current room, throws exception if not there
   tRoom * r = FindRoom (p->room);
   
-  // show room description
-  *p << r->description;
+  p->pendingLook = false;   // they have now seen it
   
-  // show available exits
-  if (!r->exits.empty ())
-    {
-    *p << "Exits: ";
-    for (tExitMap::const_iterator exititer = r->exits.begin ();
-         exititer != r->exits.end (); ++exititer)
-      *p << exititer->first << " ";
-    *p << "\n";        
-    }
+  // show room description and exits (these don't change, so are kept ready)
+  *p << r->Render ();
+  
+  // show mobiles and objects
+  *p << DescribeMobilesInRoom (p->room);
+  *p << DescribeObjects (r->contents, true);
   
   /* list other players in the same room */
   
-  int iOthers = 0;
-  for (tPlayerListIterator listiter = playerlist.begin (); 
-      listiter != playerlist.end (); 
+  tRoomPlayersMapIterator roomiter = roomplayersmap.find (p->room);
+  if (roomiter == roomplayersmap.end ())
+    return;
+    
+  tTempString sOthers;
+  for (vector<tPlayer*>::const_iterator listiter = roomiter->second.begin (); 
+      listiter != roomiter->second.end (); 
       listiter++)
     {
     tPlayer *otherp = *listiter;
     if (otherp != p && /* we don't see ourselves */
-        otherp->IsPlaying () &&
-        otherp->room == p->room)  // need to be in same room
+        otherp->IsPlaying ())
       {
-      if (iOthers++ == 0)
-        *p << "You also see ";
-      else
-        *p << ", ";
-      *p << otherp->playername;
+      sOthers += sOthers.empty () ? "You also see " : ", ";
+      sOthers += otherp->playername.c_str ();
       }
-    }   /* end of looping through all players */
+    }   /* end of looping through players in this room */
 
   /* If we listed anyone, finish up the line with a period, newline */
-  if (iOthers)
-    *p << ".\n";
+  if (!sOthers.empty ())
+    *p << sOthers << ".\n";
 
-  
 } // end of DoLook
 
 /* say <something> */
@@ -180,10 +213,11 @@ void DoLook (tPlayer * p, istream & sArgs)
 void DoSay (tPlayer * p, istream & sArgs)
 {
   p->NeedNoFlag ("gagged"); // can't if gagged
-  string what = GetMessage (sArgs, "Say what?");  // what
+  tTempString what = GetMessage (sArgs, "Say what?");  // what
   *p << "You say, \"" << what << "\"\n";  // confirm
-  SendToAll (p->playername + " says, \"" + what + "\"\n", 
+  SendToAll (Temp (p->playername) + " says, \"" + what + "\"\n", 
             p, p->room);  // say it
+  CheckTriggers (p, what);  // might make something happen
 } // end of DoSay 
 
 /* tell <someone> <something> */
@@ -192,7 +226,7 @@ void DoTell (tPlayer * p, istream & sArgs)
 {
   p->NeedNoFlag ("gagged"); // can't if gagged
   tPlayer * ptarget = p->GetPlayer (sArgs, "Tell whom?", true);  // who
-  string what = GetMessage (sArgs, "Tell " + p->playername + " what?");  // what  
+  tTempString what = GetMessage (sArgs, "Tell " + Temp (p->playername) + " what?");  // what  
   *p << "You tell " << ptarget->playername << ", \"" << what << "\"\n";     // confirm
   *ptarget << p->playername << " tells you, \"" << what << "\"\n";    // tell them
 } // end of DoTell
@@ -206,34 +240,333 @@ void DoSave  (tPlayer * p, istream & sArgs)
 void DoChat (tPlayer * p, istream & sArgs)
 {
   p->NeedNoFlag ("gagged"); // can't if gagged
-  string what = GetMessage (sArgs, "Chat what?");  // what  
-  SendToAll (p->playername + " chats, \"" + what + "\"\n");  // chat it
+  tTempString what = GetMessage (sArgs, "Chat what?");  // what  
+  SendToAll (Temp (p->playername) + " chats, \"" + what + "\"\n");  // chat it
 }
 
+/* <channel> <something> */
+
+void DoChannel (tPlayer * p, tChannel * c, istream & sArgs)
+{
+  p->NeedNoFlag ("gagged"); // can't if gagged
+  if (!c->IsSubscribed (p))
+    throw runtime_error ("You are not on the " + c->name + " channel.");
+  tTempString what = GetMessage (sArgs, Temp (c->name) + " what?");  // what  
+  c->Post ("[" + c->name + "] " + p->playername + ": " + what.c_str () + "\n");  // post it
+} // end of DoChannel
+
+// helper function for join and leave
+tChannel * GetChannel (istream & sArgs, const string & noChannelError)
+  {
+  string name;
+  sArgs >> ws >> name;
+  if (name.empty ())
+    throw runtime_error (noChannelError);
+  tChannel * c = FindChannel (name);
+  if (c == NULL)
+    throw runtime_error ("There is no channel called " + name + ".");
+  return c;
+  } // end of GetChannel
+
+void DoJoin (tPlayer * p, istream & sArgs)
+{
+  tChannel * c = GetChannel (sArgs, "Join which channel?");
+  NoMore (p, sArgs);  // check no more input
+  if (c->IsSubscribed (p))
+    throw runtime_error ("You are already on the " + c->name + " channel.");
+  c->Subscribe (p);
+  p->channels.insert (c->name);   // remember for next time
+  *p << "You join the " << c->name << " channel.\n";  // confirm
+} // end of DoJoin
+
+void DoPart (tPlayer * p, istream & sArgs)
+{
+  tChannel * c = GetChannel (sArgs, "Leave which channel?");
+  NoMore (p, sArgs);  // check no more input
+  if (!c->IsSubscribed (p))
+    throw runtime_error ("You are not on the " + c->name + " channel.");
+  c->Unsubscribe (p);
+  p->channels.erase (c->name);
+  *p << "You leave the " << c->name << " channel.\n";  // confirm
+} // end of DoPart
+
+void DoChannels (tPlayer * p, istream & sArgs)
+{
+  NoMore (p, sArgs);  // check no more input
+  *p << "Channels ...\n";
+  for (tChannelMapIterator channeliter = channelmap.begin (); 
+       channeliter != channelmap.end (); ++channeliter)
+    {
+    tChannel * c = channeliter->second;
+    *p << (c->IsSubscribed (p) ? "* " : "  ") << c->name << 
+          " (" << c->subscribers.size () << " listening)\n";
+    }
+  *p << "Type: join (channel), part (channel), or (channel) (message)\n";
+} // end of DoChannels
+
+/* get <object> [ <container> ] */
+
+void DoGet (tPlayer * p, istream & sArgs)
+{
+  string which, from;
+  sArgs >> ws >> which >> ws >> from;
+  if (which.empty ())
+    throw runtime_error ("Get what?");
+  NoMore (p, sArgs);  // check no more input
+  
+  tObjectList * source = &FindRoom (p->room)->contents;
+  
+  // getting from a container?
+  if (!from.empty ())
+    {
+    tObject * container = FindNearbyObject (p, from);
+    if (container == NULL)
+      throw runtime_error ("You don't see that here.");
+    if (!(container->proto->flags & OBJ_CONTAINER))
+      throw runtime_error ("That is not a container.");
+    source = &container->contents;
+    }
+    
+  tObject * o = source->Find (which);
+  if (o == NULL)
+    throw runtime_error (from.empty () ? "You don't see that here." : "It isn't in there.");
+  
+  MoveObject (o, p->inventory);
+  *p << "You get " << o->proto->name << ".\n";    // confirm
+  SendToAll (p->playername + " gets " + o->proto->name + ".\n", p, p->room);
+} // end of DoGet
+
+/* drop <object> */
+
+void DoDrop (tPlayer * p, istream & sArgs)
+{
+  string which;
+  sArgs >> ws >> which;
+  if (which.empty ())
+    throw runtime_error ("Drop what?");
+  NoMore (p, sArgs);  // check no more input
+  
+  tObject * o = p->inventory.Find (which);
+  if (o == NULL)
+    throw runtime_error ("You are not carrying that.");
+    
+  MoveObject (o, FindRoom (p->room)->contents);
+  *p << "You drop " << o->proto->name << ".\n";    // confirm
+  SendToAll (p->playername + " drops " + o->proto->name + ".\n", p, p->room);
+} // end of DoDrop
+
+/* put <object> <container> */
+
+void DoPut (tPlayer * p, istream & sArgs)
+{
+  string which, into;
+  sArgs >> ws >> which >> ws >> into;
+  if (which.empty () || into.empty ())
+    throw runtime_error ("Usage: put <object> <container>");
+  NoMore (p, sArgs);  // check no more input
+  
+  tObject * o = p->inventory.Find (which);
+  if (o == NULL)
+    throw runtime_error ("You are not carrying that.");
+  tObject * container = FindNearbyObject (p, into);
+  if (container == NULL)
+    throw runtime_error ("You don't see that here.");
+  if (!(container->proto->flags & OBJ_CONTAINER))
+    throw runtime_error ("That is not a container.");
+  if (container == o)
+    throw runtime_error ("You cannot put something inside itself.");
+    
+  MoveObject (o, container->contents);
+  *p << "You put " << o->proto->name << " in " << container->proto->name << ".\n";  // confirm
+  SendToAll (p->playername + " puts " + o->proto->name + " in " + 
+             container->proto->name + ".\n", p, p->room);
+} // end of DoPut
+
+void DoInventory (tPlayer * p, istream & sArgs)
+{
+  NoMore (p, sArgs);  // check no more input
+  if (p->inventory.Empty ())
+    *p << "You are not carrying anything.\n";
+  else
+    *p << "You are carrying:\n" << DescribeObjects (p->inventory, false);
+} // end of DoInventory
+
+/* alias [ <name> [ <commands> ] ] */
+
+void DoAlias (tPlayer * p, istream & sArgs)
+{
+  string name;
+  sArgs >> ws >> name;
+  
+  // list them
+  if (name.empty ())
+    {
+    if (p->aliases.Empty ())
+      throw runtime_error ("You have no aliases.");
+    *p << "Your aliases ...\n";
+    vector<pair<string, string> > aliases = p->aliases.List ();
+    for (vector<pair<string, string> >::const_iterator i = aliases.begin (); 
+         i != aliases.end (); ++i)
+      *p << "  " << i->first << " = " << i->second << "\n";
+    return;
+    }
+    
+  if (name.find_first_not_of (valid_player_name) != string::npos)
+    throw runtime_error ("Alias name not valid.");
+  if (ciStringEqual (name, "alias") || ciStringEqual (name, "unalias"))
+    throw runtime_error ("You cannot alias that.");
+    
+  string expansion;
+  sArgs >> ws;
+  getline (sArgs, expansion);
+  
+  // show one
+  if (expansion.empty ())
+    {
+    const string * current = p->aliases.Find (name);
+    if (current == NULL)
+      throw runtime_error ("You have no alias called " + name + ".");
+    *p << name << " = " << *current << "\n";
+    return;
+    }
+    
+  if (!p->aliases.Find (name) && p->aliases.Size () >= MAX_ALIASES)
+    throw runtime_error ("You have too many aliases.");
+    
+  p->aliases.Add (name, expansion);
+  *p << "Alias " << name << " = " << expansion << "\n";  // confirm
+} // end of DoAlias
+
+void DoUnalias (tPlayer * p, istream & sArgs)
+{
+  string name;
+  sArgs >> ws >> name;
+  if (name.empty ())
+    throw runtime_error ("Remove which alias?");
+  NoMore (p, sArgs);  // check no more input
+  
+  if (!p->aliases.Remove (name))
+    throw runtime_error ("You have no alias called " + name + ".");
+  *p << "Alias " << name << " removed.\n";  // confirm
+} // end of DoUnalias
+
+/* kill <mobile> */
+
+void DoKill (tPlayer * p, istream & sArgs)
+{
+  string which;
+  sArgs >> ws >> which;
+  if (which.empty ())
+    throw runtime_error ("Kill what?");
+  NoMore (p, sArgs);  // check no more input
+  
+  int m = FindMobileInRoom (p->room, which);
+  if (m == NO_MOBILE)
+    throw runtime_error ("You don't see that here.");
+  if (p->fighting == m)
+    throw runtime_error ("You are already fighting it!");
+    
+  StartFighting (p, m);
+  *p << "You attack " << mobiles.Name (m) << "!\n";    // confirm
+  SendToAll (p->playername + " attacks " + mobiles.Name (m) + "!\n", p, p->room);
+} // end of DoKill
+
 void DoEmote (tPlayer * p, istream & sArgs)
 {
-  string what = GetMessage (sArgs, "Emote what?");  // what  
-  SendToAll (p->playername + " " + what + "\n", 0, p->room);  // emote it
+  tTempString what = GetMessage (sArgs, "Emote what?");  // what  
+  SendToAll (Temp (p->playername) + " " + what + "\n", 0, p->room);  // emote it
+  CheckTriggers (p, what);  // might make something happen
 }
 
+// the who list is rebuilt when someone arrives, leaves or moves - but not too often
+static bool bWhoListChanged = true;
+static time_t tWhoListBuilt = 0;
+static string sWhoList;         // in the order they connected
+static string sWhoListSorted;   // sorted by name
+
+void InvalidateWhoList ()
+{
+  bWhoListChanged = true;
+} // end of InvalidateWhoList
+
+// one line in the who list
+static tTempString WhoLine (const tPlayer * p)
+{
+  char room [16];
+  snprintf (room, sizeof room, "%d", p->room);    // (MAKE_STRING would need a stream for each line)
+  return "  " + Temp (p->playername) + " in room " + room + "\n";
+} // end of WhoLine
+
+static void RebuildWhoList ()
+{
+  if (!bWhoListChanged || GameTime () < tWhoListBuilt + WHO_REFRESH_INTERVAL)
+    return;
+    
+  tTempString sList, sSorted;
+  
+  for (tPlayerListIterator iter = playerlist.begin (); iter != playerlist.end (); ++iter)
+    if ((*iter)->IsPlaying ())
+      sList += WhoLine (*iter);
+  
+  // the name index is already sorted
+  for (tPlayerNameMapIterator iter = playernamemap.begin (); 
+       iter != playernamemap.end (); ++iter)
+    sSorted += WhoLine (iter->second);
+  
+  string sCount = MAKE_STRING (playernamemap.size () << " player(s)\n");
+  sWhoList = "Connected players ...\n" + string (sList.begin (), sList.end ()) + sCount;
+  sWhoListSorted = "Connected players ...\n" + string (sSorted.begin (), sSorted.end ()) + sCount;
+  
+  bWhoListChanged = false;
+  tWhoListBuilt = GameTime ();
+} // end of RebuildWhoList
+
+/* who [ sorted | room <n> | <name prefix> ] */
+
 void DoWho (tPlayer * p, istream & sArgs)
 {
-  NoMore (p, sArgs);  // check no more input
-  *p << "Connected players ...\n";
+  string which;
+  sArgs >> which;
   
+  // whole list - comes from the cache
+  if (which.empty () || ciStringEqual (which, "sorted"))
+    {
+    NoMore (p, sArgs);  // check no more input
+    RebuildWhoList ();
+    *p << (which.empty () ? sWhoList : sWhoListSorted);
+    return;
+    }
+    
   int count = 0;
-  for (tPlayerListIterator iter = playerlist.begin ();
-       iter != playerlist.end ();
-       ++iter)
+  
+  // players in one room - from the room index
+  if (ciStringEqual (which, "room"))
     {
-    tPlayer * pTarget = *iter;    // the player  
-    if (pTarget->IsPlaying ())
-      {
-      *p << "  " << pTarget->playername << 
-            " in room " << pTarget->room << "\n";
-      ++count;
-      } // end of if playing
-    } // end of doing each player
+    int room;
+    sArgs >> room;
+    if (sArgs.fail ())
+      throw runtime_error ("Who in which room?");
+    NoMore (p, sArgs);  // check no more input
+    
+    *p << "Players in room " << room << " ...\n";
+    tRoomPlayersMapIterator roomiter = roomplayersmap.find (room);
+    if (roomiter != roomplayersmap.end ())
+      for (vector<tPlayer*>::const_iterator iter = roomiter->second.begin ();
+           iter != roomiter->second.end (); ++iter, ++count)
+        *p << WhoLine (*iter);
+    }
+  else
+    {
+    // players whose names start with something - from the name index
+    NoMore (p, sArgs);  // check no more input
+    
+    *p << "Players starting with " << tocapitals (which) << " ...\n";
+    for (tPlayerNameMapIterator iter = playernamemap.lower_bound (which);
+         iter != playernamemap.end () && 
+         ciStringEqual (iter->first.substr (0, which.size ()), which);
+         ++iter, ++count)
+      *p << WhoLine (iter->second);
+    }
   
   *p << count << " player(s)\n";  
 } // end of DoWho
@@ -274,6 +607,28 @@ void DoShutdown (tPlayer * p, istream & sArgs)
   bStopNow = true;
 } // end of DoShutdown
 
+void DoCopyover (tPlayer * p, istream & sArgs)
+{
+  NoMore (p, sArgs);  // check no more input
+  p->NeedFlag ("can_shutdown");
+  if (GatewaySocket () != NO_SOCKET)
+    throw runtime_error ("The gateway keeps the connections - just restart the game.");
+  if (iControl == NO_SOCKET)
+    throw runtime_error ("There are no connections to keep.");   // eg. replaying a journal
+  if (Recording ())
+    throw runtime_error ("Not while recording a journal.");
+  SendToAll (p->playername + " restarts the game\n");
+  bCopyover = true;
+  bStopNow = true;
+} // end of DoCopyover
+
+void DoStats (tPlayer * p, istream & sArgs)
+{
+  NoMore (p, sArgs);  // check no more input
+  p->NeedFlag ("can_stats");
+  *p << MetricsReport ();
+} // end of DoStats
+
 void DoHelp (tPlayer * p, istream & sArgs)
 {
   NoMore (p, sArgs);  // check no more input
@@ -295,9 +650,9 @@ void DoGoTo (tPlayer * p, istream & sArgs)
 
   // move player
   PlayerToRoom (p, room,
-                MAKE_STRING ("You go to room " << room << "\n"),
-                p->playername + " disappears in a puff of smoke!\n",
-                p->playername + " appears in a puff of smoke!\n");
+                Temp (MAKE_STRING ("You go to room " << room << "\n")),
+                Temp (p->playername) + " disappears in a puff of smoke!\n",
+                Temp (p->playername) + " appears in a puff of smoke!\n");
   
   } // end of DoGoTo
   
@@ -318,14 +673,34 @@ void DoTransfer (tPlayer * p, istream & sArgs)
   
    // move player
   PlayerToRoom (ptarget, room,
-                p->playername + " transfers you to another room!\n",
-                ptarget->playername + " is yanked away by unseen forces!\n",
-                ptarget->playername + " appears breathlessly!\n");
+                Temp (p->playername) + " transfers you to another room!\n",
+                Temp (ptarget->playername) + " is yanked away by unseen forces!\n",
+                Temp (ptarget->playername) + " appears breathlessly!\n");
      
 } // end of DoTransfer
 
+// closest command, direction or channel to a mistyped one (eg. " Did you mean: look?")
+static string SuggestCommand (const string & command)
+{
+  tEditDistance e (command);
+  
+  for (set<string>::const_iterator i = directionset.begin (); i != directionset.end (); ++i)
+    e.Consider (*i);
+  for (map<string, tHandler>::const_iterator i = commandmap.begin (); i != commandmap.end (); ++i)
+    e.Consider (i->first);
+  for (tChannelMapIterator i = channelmap.begin (); i != channelmap.end (); ++i)
+    e.Consider (i->first);
+    
+  return DidYouMean (e);
+} // end of SuggestCommand
+
 /* process commands when player is connected */
 
+// how long each command takes (see LoadCommands)
+static map<string, int> commandhistograms;
+static int movehistogram = -1;
+static int channelhistogram = -1;
+
 void ProcessCommand (tPlayer * p, istream & sArgs)
 {
 
@@ -335,18 +710,205 @@ void ProcessCommand (tPlayer * p, istream & sArgs)
   // first see if they have entered a movement command (eg. n, s, e, w)
   set<string>::const_iterator direction_iter = directionset.find (command);
   if (direction_iter != directionset.end ())
+    {
+    tTimer timer (movehistogram);
     DoDirection (p, command);
+    }
   else
     {
     // otherwise, look up command in commands map  
     map<string, tHandler>::const_iterator command_iter = commandmap.find (command);
-    if (command_iter == commandmap.end ())
-       throw runtime_error ("Huh?");      // don't get it
- 
-    command_iter->second (p, sArgs);  // execute command (eg. DoLook)
+    if (command_iter != commandmap.end ())
+      {
+      map<string, int>::const_iterator h = commandhistograms.find (command);   // read-only, we may be on a worker thread
+      tTimer timer (h == commandhistograms.end () ? -1 : h->second);
+      command_iter->second (p, sArgs);  // execute command (eg. DoLook)
+      }
+    else
+      {
+      // finally, it might be a chat channel (eg. newbie hi there)
+      tChannel * c = FindChannel (command);
+      if (c == NULL)
+        {
+        Count (eUnknownCommands);
+        throw runtime_error ("Huh?" + SuggestCommand (command));      // don't get it
+        }
+      tTimer timer (channelhistogram);
+      DoChannel (p, c, sArgs);
+      }
     }
 } /* end of ProcessCommand */
 
+// expand a speedwalk (eg. 3n2e) into single steps (eg. n n n e e)
+// returns false if the word is not a speedwalk
+bool ExpandSpeedwalk (const tTempString & s, tTempStrings & steps)
+{
+  int count = 0;
+  bool counted = false;   // words like "need" are not speedwalks - it needs a number
+  tTempStrings result;
+  
+  for (tTempString::const_iterator i = s.begin (); i != s.end (); ++i)
+    {
+    if (isdigit ((unsigned char) *i))
+      {
+      counted = true;
+      count = count * 10 + (*i - '0');
+      if (count > MAX_SPEEDWALK)
+        throw runtime_error ("That speedwalk is too long.");
+      continue;
+      }
+      
+    // only single-letter directions (eg. n, s, e, w) can be run together
+    string dir (1, *i);
+    if (directionset.find (dir) == directionset.end ())
+      return false;
+      
+    result.insert (result.end (), max (count, 1), tTempString (1, *i));
+    count = 0;
+    
+    if (result.size () > MAX_SPEEDWALK)
+      throw runtime_error ("That speedwalk is too long.");
+    } // end of each character
+    
+  // a trailing number (eg. 3n2) is not a speedwalk
+  if (count != 0 || result.empty () || !counted)
+    return false;
+    
+  steps.insert (steps.end (), result.begin (), result.end ());
+  return true;
+} // end of ExpandSpeedwalk
+
+// finish a batch of commands - show the room they ended up in
+void EndBatch (tPlayer * p)
+{
+  p->batching = false;
+  if (p->pendingLook && p->IsPlaying ())
+    p->DoCommand ("look");
+  p->pendingLook = false;
+} // end of EndBatch
+
+void SplitCommands (tPlayer * p, const tTempString & sLine, tTempStrings & commands,
+                    const int depth, const string & expanding);
+
+// commands whose text can contain the separator (see LoadCommands)
+static set<string, ciLess> textcommands;
+
+bool TakesRestOfLine (const string & command)
+{
+  if (textcommands.find (command) != textcommands.end ())
+    return true;
+    
+  // a chat channel (eg. newbie hi; anyone there?)
+  return commandmap.find (command) == commandmap.end () && 
+         directionset.find (command) == directionset.end () &&
+         FindChannel (command) != NULL;
+} // end of TakesRestOfLine
+
+// is this word a direction or a command (eg. n, look)?
+static bool IsCommand (const tTempString & word)
+{
+  const string w (word.begin (), word.end ());    // (one word fits in a string without "new")
+  return directionset.find (w) != directionset.end () || commandmap.find (w) != commandmap.end ();
+} // end of IsCommand
+
+// add one command to a batch, expanding aliases (eg. gs) and speedwalks (eg. 3n2e)
+void AddToBatch (tPlayer * p, const tTempString & command, tTempStrings & commands, 
+                 const int depth, const string & expanding)
+{
+  // costs nothing if they have no aliases
+  if (!p->aliases.Empty ())
+    {
+    pair<string, string> words = GetWord (string (command.begin (), command.end ()));
+    const string * expansion = p->aliases.Find (words.first);
+    
+    // an alias can use a command of the same name (eg. alias look look here)
+    if (expansion && !ciStringEqual (words.first, expanding))
+      {
+      if (depth >= MAX_ALIAS_DEPTH)
+        throw runtime_error ("Too many aliases inside aliases.");
+      SplitCommands (p, Temp (ExpandAlias (*expansion, words.second)), commands, 
+                     depth + 1, words.first);
+      return;
+      }
+    }
+    
+  // a single word which is not a known command might be a speedwalk
+  if (command.find_first_of (SPACES.c_str ()) != tTempString::npos ||
+      IsCommand (command) ||
+      !ExpandSpeedwalk (command, commands))
+    commands.push_back (command);
+    
+  if (commands.size () > MAX_BATCH)
+    throw runtime_error ("Too many commands at once.");
+} // end of AddToBatch
+
+// split line at the separators (eg. n;e;look)
+void SplitCommands (tPlayer * p, const tTempString & sLine, tTempStrings & commands,
+                    const int depth, const string & expanding)
+{
+  tTempString::size_type start = 0;
+  
+  while (start <= sLine.size ())
+    {
+    tTempString::size_type end = sLine.find (COMMAND_SEPARATOR, start);
+    
+    // text takes the rest of the line (eg. say hi; how are you, alias gs get sword;look)
+    const tTempString word = GetWord (sLine.substr (start)).first;
+    if (TakesRestOfLine (string (word.begin (), word.end ())))
+      end = tTempString::npos;
+      
+    if (end == tTempString::npos)
+      end = sLine.size ();
+    tTempString command = Trim (sLine.substr (start, end - start));
+    start = end + 1;
+    
+    if (!command.empty ())
+      AddToBatch (p, command, commands, depth, expanding);
+    } // end of splitting line
+} // end of SplitCommands
+
+/* process a line of input when player is connected - may be several commands
+   separated by semicolons (eg. n;e;look), a speedwalk (eg. 3n2e), or an alias.
+   Commands which take text (eg. say) take the rest of the line, semicolons and all. */
+
+void ProcessCommandLine (tPlayer * p, istream & sArgs)
+{
+  tTempString sLine;
+  getline (sArgs, sLine);
+  
+  tTempStrings commands;
+  SplitCommands (p, sLine, commands, 0, "");
+    
+  // just one command? do it the simple way
+  if (commands.size () <= 1)
+    {
+    tTempStream is (commands.empty () ? tTempString () : commands.front ());
+    ProcessCommand (p, is);
+    return;
+    }
+    
+  // run them all, with one look at the end
+  p->batching = true;
+  try
+    {
+    for (tTempStrings::const_iterator i = commands.begin (); 
+         i != commands.end () && p->IsPlaying (); ++i)
+      {
+      tTempStream is (*i);
+      ProcessCommand (p, is);
+      }
+    } // end of try block
+    
+  // stop at the first error, but still show where they are
+  catch (runtime_error & e)
+    {
+    EndBatch (p);
+    throw;
+    }
+    
+  EndBatch (p);
+} /* end of ProcessCommandLine */
+
 
 void LoadCommands ()
   {
@@ -357,6 +919,7 @@ void LoadCommands ()
   commandmap ["\""]       = DoSay;      // synonym for say
   commandmap ["tell"]     = DoTell;     // tell someone
   commandmap ["shutdown"] = DoShutdown; // shut MUD down
+  commandmap ["copyover"] = DoCopyover; // restart MUD, keeping connections
   commandmap ["help"]     = DoHelp;     // show help message
   commandmap ["goto"]     = DoGoTo;     // go to room
   commandmap ["transfer"] = DoTransfer; // transfer someone else
@@ -366,5 +929,31 @@ void LoadCommands ()
   commandmap ["chat"]     = DoChat;      // chat
   commandmap ["emote"]    = DoEmote;     // emote
   commandmap ["who"]      = DoWho;       // who is on?
+  commandmap ["kill"]     = DoKill;      // fight a mobile
+  commandmap ["alias"]    = DoAlias;     // list or set aliases
+  commandmap ["unalias"]  = DoUnalias;   // remove an alias
+  commandmap ["get"]      = DoGet;       // pick something up
+  commandmap ["drop"]     = DoDrop;      // put something down
+  commandmap ["put"]      = DoPut;       // put something in a container
+  commandmap ["inventory"]= DoInventory; // what am I carrying?
+  commandmap ["i"]        = DoInventory; // synonym for inventory
+  commandmap ["channels"] = DoChannels;  // list chat channels
+  commandmap ["join"]     = DoJoin;      // join a chat channel
+  commandmap ["part"]     = DoPart;      // leave a chat channel
+  commandmap ["stats"]    = DoStats;     // server metrics
+  
+  // these take the rest of the line, semicolons and all (as do chat channels)
+  textcommands.insert ("say");
+  textcommands.insert ("\"");
+  textcommands.insert ("tell");
+  textcommands.insert ("chat");
+  textcommands.insert ("emote");
+  textcommands.insert ("alias");
+  
+  // time each of them - made now, as commands can run on worker threads
+  for (map<string, tHandler>::const_iterator i = commandmap.begin (); i != commandmap.end (); ++i)
+    commandhistograms [i->first] = AddHistogram ("command", i->first);
+  movehistogram = AddHistogram ("command", "(move)");
+  channelhistogram = AddHistogram ("command", "(channel)");
   } // end of LoadCommands
 
@@ -15,6 +15,8 @@ warranty, and with no claim as to its suitability for any purpose.
 #include <fcntl.h>
 #include <signal.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/errno.h>
@@ -28,6 +30,7 @@ warranty, and with no claim as to its suitability for any purpose.
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <vector>
 
 using namespace std; 
 
@@ -35,13 +38,29 @@ using namespace std;
 #include "constants.h"
 #include "player.h"
 #include "globals.h"
-
-void PeriodicUpdates ();
-
-// comms descriptors
-static fd_set in_set;  
-static fd_set out_set;
-static fd_set exc_set;
+#include "broadcast.h"
+#include "inputqueue.h"
+#include "metrics.h"
+#include "journal.h"
+#include "log.h"
+#include "gatewaylink.h"
+#include "arena.h"
+#include "gameclock.h"
+
+// comms descriptors - poll rather than select, as there can be more than FD_SETSIZE of them
+static vector<struct pollfd> pollfds;             // control socket, wakeup pipe, pending, players
+static vector<tPendingConnection*> pollpending;   // connection for each pending entry
+static vector<tPlayer*> pollplayers;              // player for each player entry
+static vector<int> pollscrapers;                  // metrics connections
+static vector<int> pollscraperwrites;             // metrics connections we are still answering
+
+// how long each part of the main loop takes
+static int periodichistogram;
+static int removehistogram;
+static int pollhistogram;
+static int descriptorshistogram;
+static int inputhistogram;
+static int roomeventshistogram;
 
 /* Here when a signal is raised */
 
@@ -53,49 +72,61 @@ void bailout (int sig)
 
 /* set up comms - get ready to listen for connection */
 
-int InitComms ()
+static void CreateControlSocket ()
   {
   struct sockaddr_in sa;
     
-  try
-    {
+  // Create the control socket
+  if ( (iControl = socket (AF_INET, SOCK_STREAM, 0)) == -1)
+    throw runtime_error ("creating control socket");
   
-    // Create the control socket
-    if ( (iControl = socket (AF_INET, SOCK_STREAM, 0)) == -1)
-      throw runtime_error ("creating control socket");
-    
-    // make sure socket doesn't block
-    if (fcntl( iControl, F_SETFL, FNDELAY ) == -1)
-      throw runtime_error ("fcntl on control socket");
-  
-    struct linger ld = linger ();  // zero it
-  
-    // Don't allow closed sockets to linger
-    if (setsockopt( iControl, SOL_SOCKET, SO_LINGER,
-                    (char *) &ld, sizeof ld ) == -1)
-      throw runtime_error ("setsockopt (SO_LINGER)");
+  // make sure socket doesn't block
+  if (fcntl( iControl, F_SETFL, FNDELAY ) == -1)
+    throw runtime_error ("fcntl on control socket");
 
-    int x = 1;
+  struct linger ld = linger ();  // zero it
 
-    // Allow address reuse 
-    if (setsockopt( iControl, SOL_SOCKET, SO_REUSEADDR,
-                   (char *) &x, sizeof x ) == -1)
-      throw runtime_error ("setsockopt (SO_REUSEADDR)");
-    
-    sa.sin_family       = AF_INET;
-    sa.sin_port         = htons (PORT);
-    sa.sin_addr.s_addr  = INADDR_ANY;   /* change to listen on a specific adapter */
-  
-    // bind the socket to our connection port
-    if ( bind (iControl, (struct sockaddr *) &sa, sizeof sa) == -1)
-      throw runtime_error ("bind");
-    
-    // listen for connections
+  // Don't allow closed sockets to linger
+  if (setsockopt( iControl, SOL_SOCKET, SO_LINGER,
+                  (char *) &ld, sizeof ld ) == -1)
+    throw runtime_error ("setsockopt (SO_LINGER)");
+
+  int x = 1;
+
+  // Allow address reuse 
+  if (setsockopt( iControl, SOL_SOCKET, SO_REUSEADDR,
+                 (char *) &x, sizeof x ) == -1)
+    throw runtime_error ("setsockopt (SO_REUSEADDR)");
   
-    if (listen (iControl, SOMAXCONN) == -1)   // SOMAXCONN is the backlog count
-      throw runtime_error ("listen");
+  sa.sin_family       = AF_INET;
+  sa.sin_port         = htons (PORT);
+  sa.sin_addr.s_addr  = INADDR_ANY;   /* change to listen on a specific adapter */
+
+  // bind the socket to our connection port
+  if ( bind (iControl, (struct sockaddr *) &sa, sizeof sa) == -1)
+    throw runtime_error ("bind");
   
-    tLastMessage = time (NULL);
+  // listen for connections
+
+  if (listen (iControl, SOMAXCONN) == -1)   // SOMAXCONN is the backlog count
+    throw runtime_error ("listen");
+  } /* end of CreateControlSocket */
+
+int InitComms ()
+  {
+  try
+    {
+    // unless we have one from before a copyover, or the gateway has the players
+    if (iControl == NO_SOCKET && GatewaySocket () == NO_SOCKET)
+      CreateControlSocket ();
+      
+    // we may have a lot of connections waiting to log in, so allow as many files as we can
+    struct rlimit rl;
+    if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+      {
+      rl.rlim_cur = rl.rlim_max;
+      setrlimit (RLIMIT_NOFILE, &rl);
+      }
     }  // end of try block
     
   // problem?
@@ -106,6 +137,17 @@ int InitComms ()
     return 1;    
     }
 
+  // time the parts of the main loop
+  periodichistogram    = AddHistogram ("phase", "periodic_updates");
+  removehistogram      = AddHistogram ("phase", "remove_inactive_players");
+  pollhistogram        = AddHistogram ("phase", "poll");
+  descriptorshistogram = AddHistogram ("phase", "process_descriptors");
+  inputhistogram       = AddHistogram ("phase", "run_queued_input");
+  roomeventshistogram  = AddHistogram ("phase", "flush_room_events");
+  
+  // Prometheus can get them here (not fatal if it can't be set up)
+  InitMetricsPort ();
+
   // standard termination signals
   signal (SIGINT,  bailout);
   signal (SIGTERM, bailout);
@@ -120,68 +162,93 @@ int InitComms ()
 void CloseComms ()
   {
 
-  cerr << "Closing all comms connections." << endl;
+  Log (eLogInfo, "Closing all comms connections.");
 
   // close listening socket
   if (iControl != NO_SOCKET)
     close (iControl);
 
+  // close connections that never logged in
+  ClosePendingConnections ();
+  
+  // players at the gateway stay connected, for the next game
+  FlushGateway ();
+  DetachGateway ();
+  
+  // and the metrics port
+  CloseMetricsPort ();
+  
   // delete all players - this will close connections
   for_each (playerlist.begin (), playerlist.end (), DeleteObject ());
 
   // delete all rooms
   for_each (roommap.begin (), roommap.end (), DeleteMapObject ());
+  
+  // delete all channels
+  for_each (channelmap.begin (), channelmap.end (), DeleteMapObject ());
+  
+  // delete all object prototypes (objects themselves went with the rooms and players)
+  for_each (objectprotomap.begin (), objectprotomap.end (), DeleteMapObject ());
  
   } /* end of CloseComms */
 
+// add a descriptor to poll
+static void AddPoll (const int fd, const short events)
+{
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = events;
+  pfd.revents = 0;
+  pollfds.push_back (pfd);
+} // end of AddPoll
+
   // prepare for comms
 struct setUpDescriptors
 {
-  int iMaxdesc;
-  
-  setUpDescriptors (const int i) : iMaxdesc (i) {}
-    
   // check this player
-  void operator() (const tPlayer * p) 
+  void operator() (tPlayer * p) 
     {
-     /* don't bother if connection is closed */
-      if (p->Connected ())
+     /* don't bother if connection is closed, or not a socket (eg. at the gateway) */
+      if (p->Connected () && p->GetSocket () != NO_SOCKET)
         {
-        iMaxdesc = max (iMaxdesc, p->GetSocket ());
+        short events = 0;
         // don't take input if they are closing down
         if (!p->closing)
-          {
-          FD_SET( p->GetSocket (), &in_set  );
-          FD_SET( p->GetSocket (), &exc_set );
-          }
+          events |= POLLIN | POLLPRI;
 
         /* we are only interested in writing to sockets we have something for */
         if (p->PendingOutput ())
-          FD_SET( p->GetSocket (), &out_set );
+          events |= POLLOUT;
+          
+        AddPoll (p->GetSocket (), events);
+        pollplayers.push_back (p);
         } /* end of active player */
     } // end of operator()  
     
-  int GetMax () const { return iMaxdesc; }
-  
 };  // end of setUpDescriptors
 
 // handle comms
 struct processDescriptors
 {
+  const struct pollfd * pfd;    // the entry for the next player
+  
+  processDescriptors (const struct pollfd * first) : pfd (first) {}
   
   // handle this player
   void operator() (tPlayer * p) 
     {
+      const short revents = (pfd++)->revents;
+      
       /* handle exceptions */
-      if (p->Connected () && FD_ISSET (p->GetSocket (), &exc_set))
+      if (p->Connected () && (revents & POLLPRI))
         p->ProcessException ();
 
-      /* look for ones we can read from, provided they aren't closed */
-      if (p->Connected () && FD_ISSET (p->GetSocket (), &in_set))
+      /* look for ones we can read from, provided they aren't closed (hangups show up as a read of 0) */
+      if (p->Connected () && (revents & (POLLIN | POLLHUP | POLLERR)))
         p->ProcessRead ();
 
       /* look for ones we can write to, provided they aren't closed */
-      if (p->Connected () && FD_ISSET (p->GetSocket (), &out_set))
+      if (p->Connected () && (revents & POLLOUT))
         p->ProcessWrite ();
      } // end of operator()  
       
@@ -209,7 +276,7 @@ void ProcessNewConnection ()
       if ( errno == EWOULDBLOCK )
         return;
 
-      perror ("accept");
+      LogError ("accept");
       return;
       }
         
@@ -217,31 +284,38 @@ void ProcessNewConnection ()
     
     if (fcntl (s, F_SETFL, FNDELAY) == -1)
       {
-      perror ("fcntl on player socket");
+      LogError ("fcntl on player socket");
       return;
       }
 
-    string address = inet_ntoa ( sa.sin_addr);
-    int port = ntohs (sa.sin_port);
-            
     // immediately close connections from blocked IP addresses
-    if (blockedIP.find (address) != blockedIP.end ())
+    const tIPAddress from = IPv4Address (sa.sin_addr);
+    if (blockedIP.Contains (from))
       {
-      cerr << "Rejected connection from " << address << endl;
+      Count (eBlocked);
+      Log (eLogWarning, MAKE_STRING ("Rejected connection from " << inet_ntoa (sa.sin_addr)));
       close (s);
       continue;      
       }
       
-    tPlayer * p = new tPlayer (s, port, address);
-    playerlist.push_back (p);
-    
-    cout << "New player accepted on socket " << s << 
-            ", from address " << address << 
-            ", port " << port << endl;
+    // or that are connecting too often (not logged - that would be too often as well)
+    if (!throttle.AllowConnect (from))
+      {
+      Count (eThrottled);
+      close (s);
+      continue;
+      }
+      
+    string address = inet_ntoa ( sa.sin_addr);
+    int port = ntohs (sa.sin_port);
+            
+    Count (eAccepts);
+    Log (eLogInfo, MAKE_STRING ("New player accepted on socket " << s << 
+                                ", from address " << address << 
+                                ", port " << port));
       
-    *p << "\nWelcome to the Tiny MUD Server version " << VERSION << "\n"; 
-    *p << messagemap ["welcome"];   // message from message file
-    *p << p->prompt;    // initial prompt (Enter your name ...)
+    // they don't get a tPlayer until they send their name
+    AddPendingConnection (s, sa);
     
     } /* end of processing *all* new connections */
 
@@ -268,13 +342,16 @@ void ProcessPlayerInput (tPlayer * p, const string & s)
 {
    try
     {
-    istringstream is (s);
+    tTempStream is (Temp (s));
               
     // look up what to do in state map  
     map<tConnectionStates, tHandler>::iterator si = statemap.find (p->connstate);
   
     if (si != statemap.end ())
+      {
+      tTimer timer (StateHistogram (p->connstate));
       si->second (p, is);  // execute command (eg. ProcessCommand) 
+      }
     } // end of try block
 
   // all errors during input processing will be caught here
@@ -287,6 +364,22 @@ void ProcessPlayerInput (tPlayer * p, const string & s)
 
 } /* end of ProcessPlayerInput */
 
+// called approximately every 0.5 seconds - handle things like fights here
+void PeriodicUpdates ()
+  {
+  //      The example below just sends a message every MESSAGE_INTERVAL seconds.
+  // send new command if it is time
+  if (GameTime () > (tLastMessage + MESSAGE_INTERVAL))
+    {
+    SendToAll ("You hear creepy noises ...\n");
+    tLastMessage = GameTime ();
+    }
+  
+  // mobiles wander, attack, fight and respawn
+  UpdateMobiles ();
+    
+  } // end of PeriodicUpdates
+
 // main processing loop
 void MainLoop ()
 {
@@ -296,40 +389,122 @@ void MainLoop ()
 
     // We will go through this loop roughly every COMMS_WAIT_SEC/COMMS_WAIT_USEC
     // seconds (at present 0.5 seconds).
+    {
+    tTimer timer (periodichistogram);
     PeriodicUpdates ();   // do things that don't rely on player input
+    }
       
+    // close connections that are taking too long to log in
+    CheckLoginDeadlines ();
+    
     // delete players who have closed their comms - have to do it outside other loops to avoid 
     // access violations (iterating loops that have had items removed)
+    {
+    tTimer timer (removehistogram);
     RemoveInactivePlayers ();
+    }
       
-    // get ready for "select" function ... 
-    FD_ZERO (&in_set);
-    FD_ZERO (&out_set);
-    FD_ZERO (&exc_set);
+    // get ready for "poll" function ... 
+    pollfds.clear ();
+    pollpending.clear ();
+    pollplayers.clear ();
+    pollscrapers.clear ();
+    pollscraperwrites.clear ();
 
     // add our control socket (for new connections)
-    FD_SET (iControl, &in_set);
-
-    // set bits in in_set, out_set etc. for each connected player
-    int iMaxdesc = for_each (playerlist.begin (), playerlist.end (), 
-                             setUpDescriptors (iControl)).GetMax ();
+    AddPoll (iControl, POLLIN);
+    
+    // and the pipe that tells us background work is done
+    AddPoll (backgroundpool.WakeupFd (), POLLIN);
     
-    // set up timeout interval
-    struct timeval timeout;
-    timeout.tv_sec = COMMS_WAIT_SEC;    // seconds
-    timeout.tv_usec = COMMS_WAIT_USEC;  // + 1000th. of second
+    // and the gateway's doorbell (poll ignores NO_SOCKET)
+    AddPoll (GatewaySocket (), POLLIN);
+    
+    // and the metrics port, and anyone scraping it
+    AddPoll (MetricsSocket (), POLLIN);
+    GetScraperSockets (pollscrapers, pollscraperwrites);
+    for (vector<int>::const_iterator i = pollscrapers.begin (); i != pollscrapers.end (); ++i)
+      AddPoll (*i, POLLIN);
+    for (vector<int>::const_iterator i = pollscraperwrites.begin (); i != pollscraperwrites.end (); ++i)
+      AddPoll (*i, POLLOUT);
+    
+    // connections waiting for a name
+    for (tPendingConnections::const_iterator i = pendingconnections.begin (); 
+         i != pendingconnections.end (); ++i)
+      if ((*i)->s != NO_SOCKET)
+        {
+        AddPoll ((*i)->s, POLLIN);
+        pollpending.push_back (*i);
+        }
 
-    // check for activity, timeout after 'timeout' seconds
-    if (select (iMaxdesc + 1, &in_set, &out_set, &exc_set, &timeout) > 0)
+    // and each connected player
+    for_each (playerlist.begin (), playerlist.end (), setUpDescriptors ());
+    
+    // check for activity, timeout after COMMS_WAIT_SEC/COMMS_WAIT_USEC
+    const int timeout = COMMS_WAIT_SEC * 1000 + COMMS_WAIT_USEC / 1000;   // milliseconds
+    int ready;
+    {
+    tTimer timer (pollhistogram);
+    ready = poll (&pollfds [0], pollfds.size (), timeout);
+    }
+    if (ready > 0)
       {
+      tTimer timer (descriptorshistogram);
+      
       // New connection on control port?
-      if (FD_ISSET (iControl, &in_set))
+      if (pollfds [0].revents & POLLIN)
         ProcessNewConnection ();
+        
+      // results of background work (eg. password checked)
+      if (pollfds [1].revents & POLLIN)
+        backgroundpool.FinishJobs ();
+        
+      // connections, input or hangups from the gateway
+      if (pollfds [2].revents)
+        ProcessGateway ();
+        
+      // someone wants the metrics
+      if (pollfds [3].revents & POLLIN)
+        ProcessMetricsConnection ();
+        
+      const struct pollfd * pfd = &pollfds [4];
+      for (vector<int>::const_iterator i = pollscrapers.begin (); i != pollscrapers.end (); ++i, ++pfd)
+        if (pfd->revents)
+          ProcessScraperRead (*i);
+      for (vector<int>::const_iterator i = pollscraperwrites.begin (); i != pollscraperwrites.end (); ++i, ++pfd)
+        if (pfd->revents)
+          ProcessScraperWrite (*i);
+        
+      // someone who hasn't logged in has sent something
+      for (vector<tPendingConnection*>::const_iterator i = pollpending.begin (); 
+           i != pollpending.end (); ++i, ++pfd)
+        if (pfd->revents && (*i)->s != NO_SOCKET)
+          ProcessPendingRead (*i);
       
       // handle all player input/output
-      for_each (playerlist.begin (), playerlist.end (), 
-                processDescriptors ());      
+      for_each (pollplayers.begin (), pollplayers.end (), processDescriptors (pfd));      
       } // end of something happened
+      
+    // act on the input received
+    {
+    tTimer timer (inputhistogram);
+    RunQueuedInput ();
+    }
+    
+    // tell people in each room who came and went during this tick
+    {
+    tTimer timer (roomeventshistogram);
+    FlushRoomEvents ();
+    }
+    
+    // send the gateway's players their output (the others are sent it as poll allows)
+    FlushGateway ();
+    
+    // make sure what was recorded this tick is on disk
+    FlushJournal ();
+    
+    // the temporaries made by this tick's commands are finished with
+    ResetArenas ();
   
     }  while (!bStopNow);   // end of looping processing input
 
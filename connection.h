@@ -0,0 +1,53 @@
+#ifndef TINYMUDSERVER_CONNECTION_H
+#define TINYMUDSERVER_CONNECTION_H
+
+#include <unistd.h>
+#include <errno.h>
+#include <string>
+
+#include "constants.h"  // for NO_SOCKET
+
+/*---------------------------------------------- */
+/*  connections - how a player's text gets to and from them */
+/*---------------------------------------------- */
+
+/*
+ Normally a socket, but the game doesn't need to know that: a replayed
+ journal, or the simulation (see sim.cpp), use connections that only exist
+ in memory. Read and Write behave like read and write (-1 with errno set on
+ an error, and a read of 0 means they have gone).
+*/
+
+class tConnection
+  {
+  public:
+  virtual ~tConnection () {}
+  virtual int Read (char * buf, const int size) = 0;
+  virtual int Write (const char * buf, const int size) = 0;
+  virtual int Socket () const { return NO_SOCKET; }  // to poll, if there is one
+  };  // end of class tConnection
+
+// a TCP connection - closed when they go
+class tSocketConnection : public tConnection
+  {
+  int s;
+
+  public:
+  tSocketConnection (const int sock) : s (sock) {}
+  ~tSocketConnection () { close (s); }
+  int Read (char * buf, const int size) { return read (s, buf, size); }
+  int Write (const char * buf, const int size) { return write (s, buf, size); }
+  int Socket () const { return s; }
+  };  // end of class tSocketConnection
+
+// a connection in memory - input comes from tPlayer::AddInput, output is kept here
+class tVirtualConnection : public tConnection
+  {
+  public:
+  std::string output;   // everything sent to them, until someone clears it
+
+  int Read (char * buf, const int size) { errno = EWOULDBLOCK; return -1; }  // never anything to read
+  int Write (const char * buf, const int size) { output.append (buf, size); return size; }
+  };  // end of class tVirtualConnection
+
+#endif // TINYMUDSERVER_CONNECTION_H
@@ -5,20 +5,76 @@
 
 static const string VERSION = "2.2.0";        // server version
 static const int PORT = 4000;                 // incoming connections port
+static const int METRICS_PORT = 4001;         // Prometheus metrics, from this machine only
+static const unsigned int MAX_SCRAPERS = 8;   // metrics connections at once
+static const int SCRAPE_TIMEOUT = 5;          // seconds for a scraper to send its request (or take more of the answer)
 static const string PROMPT = "> ";            // normal player prompt
 static const int INITIAL_ROOM = 1000;         // what room they start in
 static const int MAX_PASSWORD_ATTEMPTS = 3;   // times they can try a password
+static const string NAME_PROMPT = "Enter your name, or 'new' to create a new character ...  ";
+// connections that haven't logged in yet
+static const int PREAUTH_TIMEOUT = 30;        // seconds to send their name
+static const int LOGIN_TIMEOUT = 120;         // seconds from sending their name to playing
+static const int PREAUTH_INPUT_LIMIT = 80;    // bytes they can send before their name
+static const unsigned int MAX_PENDING_CONNECTIONS = 50000;  // waiting to send their name
 static const int MESSAGE_INTERVAL = 60;       // seconds between tick messages
+static const int WHO_REFRESH_INTERVAL = 1;    // seconds between rebuilding the who list
+// mobiles
+static const long MOBILE_TICK_USEC = 500000;  // time between mobile updates in microseconds
+static const int WANDER_MIN_TICKS = 10;       // least mobile ticks between wandering
+static const int WANDER_MAX_TICKS = 40;       // most mobile ticks between wandering
+static const int RESPAWN_TICKS = 120;         // mobile ticks until a dead mobile comes back
+static const int PLAYER_DAMAGE = 4;           // most damage a player does per combat round
+static const char COMMAND_SEPARATOR = ';';    // separates several commands on one line
+static const int MAX_SPEEDWALK = 50;          // most steps in one speedwalk (eg. 3n2e)
+static const unsigned int MAX_BATCH = 100;    // most commands from one line, after expanding aliases
+static const int MAX_ALIAS_DEPTH = 5;         // aliases inside aliases inside ...
+static const unsigned int MAX_ALIASES = 100;  // most aliases a player can have
+static const unsigned int MAX_NAMES_LISTED = 3;  // names in a merged message before "and 5 others"
 // This is the time the "select" waits before timing out.
 static const long COMMS_WAIT_SEC = 0;         // time to wait in seconds
 static const long COMMS_WAIT_USEC = 500000;   // time to wait in microseconds
 static const int NO_SOCKET = -1;              // indicator for no socket connected
+static const int NO_MOBILE = -1;              // indicator for no mobile (eg. not fighting)
+static const int WORKER_THREADS = 4;          // threads for room commands
+static const unsigned int PARALLEL_INPUT_ROOMS = 8; // rooms with input before using threads for it
+static const int BACKGROUND_THREADS = 2;      // threads for slow work (eg. password hashing)
+static const size_t ARENA_BLOCK_SIZE = 64 * 1024;   // memory for temporaries is got this much at a time
+static const size_t ARENA_LARGE_SIZE = 1024;        // bigger temporaries than this are got with "new"
+static const unsigned int MAX_BACKGROUND_JOBS = 64;  // slow work queued before we say we are busy
+static const unsigned int MAX_TYPEAHEAD = 20; // lines kept while their password is being checked
+static const unsigned int PLAYER_CACHE_SIZE = 1000;  // player files kept in memory
+// password hashing (scrypt) - memory used per hash is 128 * r * 2^N bytes (16 Mb)
+static const unsigned int SCRYPT_LOG2_N = 14;
+static const unsigned int SCRYPT_R = 8;
+static const unsigned int SCRYPT_P = 1;
+// throttling, for each address (see ipfilter.h) - connections from this machine aren't throttled
+static const double CONNECT_RATE = 2;         // connections a second, on average
+static const double CONNECT_BURST = 20;       // connections at once
+static const double LOGIN_RATE = 0.5;         // names sent a second, on average
+static const double LOGIN_BURST = 10;         // names sent at once
+static const unsigned int THROTTLE_TABLE_SIZE = 4096;  // addresses tracked to start with
+// logging (see log.h)
+static const unsigned int LOG_RING_SIZE = 1024;  // records each thread can have waiting (a power of 2)
+static const unsigned int LOG_TEXT_SIZE = 240;   // longest message in a record
+static const long LOG_DRAIN_USEC = 50000;        // how often the log thread looks for records
+static const long LOG_ROTATE_BYTES = 10000000;   // start a new log file after this much
+static const int LOG_KEEP_FILES = 5;             // old log files kept
+// gateway process (see gatewayipc.h)
+static const char * GATEWAY_SOCKET = "./system/gateway.sock";  // the game attaches here
+static const char * GATEWAY_MEMORY = "/tinymudserver-gateway";   // shared memory name
+static const unsigned int GATEWAY_RING_SIZE = 4 * 1024 * 1024;   // bytes each way (a power of 2)
+static const unsigned int GATEWAY_READ_SIZE = 4096;  // most read from a player at once
 // files
 static const string PLAYER_DIR    = "./players/";    // location of player files
 static const string PLAYER_EXT    = ".player";       // suffix for player files
 static const char * MESSAGES_FILE = "./system/messages.txt";  // messages
 static const char * CONTROL_FILE  = "./system/control.txt";   // control file
 static const char * ROOMS_FILE    = "./rooms/rooms.txt";      // rooms file
+static const char * TRIGGERS_FILE = "./rooms/triggers.txt";   // room triggers file
+static const char * MOBILES_FILE  = "./mobs/mobiles.txt";     // mobiles file
+static const char * OBJECTS_FILE  = "./objects/objects.txt";  // objects file
+static const char * COPYOVER_FILE = "./system/copyover.dat";  // players handed over by copyover
 // player names must consist of characters from this list
 static const string valid_player_name = 
   "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_-";
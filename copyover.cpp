@@ -0,0 +1,244 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+using namespace std;
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "globals.h"
+#include "channel.h"
+#include "preauth.h"
+#include "metrics.h"
+#include "log.h"
+#include "copyover.h"
+
+static const char COPYOVER_MAGIC [] = "TMC1";
+
+static int64_t RealTime ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return int64_t (tv.tv_sec) * 1000000 + tv.tv_usec;
+} // end of RealTime
+
+// true if we can hand this player over
+static bool Keep (const tPlayer * p)
+{
+  return p->IsPlaying () && p->GetSocket () != NO_SOCKET;
+} // end of Keep
+
+/*
+ The file is:
+   TMC1 <listening socket> <time written (usec)> <number of players>
+ then for each player:
+   <socket> <port> <address> <name> <output length> <input length> <player file length>
+ followed by that many bytes of each.
+*/
+
+static bool WriteCopyoverFile ()
+{
+  // it has their passwords in it, so only we can read it
+  const int fd = open (COPYOVER_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  FILE * f = fd == -1 ? NULL : fdopen (fd, "wb");
+  if (f == NULL)
+    {
+    LogError (COPYOVER_FILE);
+    if (fd != -1)
+      close (fd);
+    return false;
+    }
+
+  int count = 0;
+  for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); ++i)
+    if (Keep (*i))
+      ++count;
+
+  fprintf (f, "%s %d %lld %d\n", COPYOVER_MAGIC, iControl, (long long) RealTime (), count);
+
+  ostringstream data;
+  for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); ++i)
+    {
+    const tPlayer * p = *i;
+    if (!Keep (p))
+      continue;
+
+    data.str ("");
+    p->Write (data);
+    const string & output = p->GetPendingOutput ();
+    const string & input = p->GetPendingInput ();
+    const string details = data.str ();
+
+    fprintf (f, "%d %d %s %s %lu %lu %lu\n", p->GetSocket (), p->GetPort (),
+             p->GetAddress ().c_str (), p->playername.c_str (),
+             (unsigned long) output.size (), (unsigned long) input.size (),
+             (unsigned long) details.size ());
+    fwrite (output.data (), 1, output.size (), f);
+    fwrite (input.data (), 1, input.size (), f);
+    fwrite (details.data (), 1, details.size (), f);
+    } // end of each player
+
+  const bool ok = !ferror (f);
+  if (fclose (f) != 0 || !ok)
+    {
+    LogError (COPYOVER_FILE);
+    unlink (COPYOVER_FILE);
+    return false;
+    }
+  return true;
+} // end of WriteCopyoverFile
+
+void Copyover (char * argv [])
+{
+  // get the warning to them now, rather than after the restart
+  SendToAll ("\n** Restarting the game - please wait. **\n");
+  for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); ++i)
+    (*i)->ProcessWrite ();
+
+  if (!WriteCopyoverFile ())
+    {
+    SendToAll ("** Restart failed - carry on. **\n");
+    return;
+    }
+
+  // anyone we aren't keeping has to go, or their socket would stay open in the new process
+  int kept = 0;
+  for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); )
+    if (Keep (*i))
+      {
+      ++kept;
+      ++i;
+      }
+    else
+      {
+      **i << "\nPlease connect again in a moment.\n";
+      delete *i;
+      playerlist.erase (i++);
+      }
+  ClosePendingConnections ();
+  CloseMetricsPort ();
+
+  workerpool.Stop ();
+  backgroundpool.Stop ();
+
+  Log (eLogInfo, MAKE_STRING ("Copyover: handing over " << kept << " player(s)"));
+  StopLogging ();
+
+  // the same arguments (eg. --log), with --copyover so it knows to pick up where we left off
+  vector<char*> args;
+  args.push_back (argv [0]);
+  for (int i = 1; argv [i]; ++i)
+    if (string (argv [i]) != "--copyover")
+      args.push_back (argv [i]);
+  args.push_back (const_cast<char*> ("--copyover"));
+  args.push_back (NULL);
+
+  cout << "Copyover - restarting " << argv [0] << endl;
+  execvp (args [0], &args [0]);
+
+  // still us - the file is no use now, but everyone is still here
+  perror (argv [0]);
+  unlink (COPYOVER_FILE);
+  
+  // whatever happens next, don't lose what they have done
+  for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); ++i)
+    (*i)->Save ();
+  
+  // start up what we stopped, and carry on
+  if (!RestartLogging () || !backgroundpool.Start (BACKGROUND_THREADS, true))
+    exit (1);
+  workerpool.Start (WORKER_THREADS);
+  InitMetricsPort ();
+  Log (eLogError, "Copyover failed - carrying on");
+  SendToAll ("** Restart failed - carry on. **\n");
+} // end of Copyover
+
+bool RecoverCopyover ()
+{
+  ifstream f (COPYOVER_FILE, ios::in | ios::binary);
+  if (!f)
+    {
+    Log (eLogWarning, MAKE_STRING ("No copyover file " << COPYOVER_FILE << " - starting afresh"));
+    return false;
+    }
+  unlink (COPYOVER_FILE);   // it has their passwords in it
+
+  string magic;
+  long long written = 0;
+  int control = NO_SOCKET, count = 0;
+  f >> magic >> control >> written >> count;
+  if (!f || magic != COPYOVER_MAGIC)
+    {
+    Log (eLogError, MAKE_STRING (COPYOVER_FILE << " is not a copyover file"));
+    return false;
+    }
+  iControl = control;
+
+  int recovered = 0;
+  for (int n = 0; n < count; ++n)
+    {
+    int s, port;
+    string address, name;
+    unsigned long outputlength, inputlength, detailslength;
+    f >> s >> port >> address >> name >> outputlength >> inputlength >> detailslength;
+    f.ignore ();  // the newline
+    if (!f)
+      break;
+
+    string output (outputlength, ' '), input (inputlength, ' '), details (detailslength, ' ');
+    f.read (&output [0], outputlength);
+    f.read (&input [0], inputlength);
+    f.read (&details [0], detailslength);
+    if (!f)
+      break;
+
+    // still there?
+    if (fcntl (s, F_GETFD) == -1)
+      continue;
+
+    tPlayer * p = new tPlayer (new tSocketConnection (s), port, address);
+    p->playername = name;
+    istringstream is (details);
+    p->Load (is);
+    p->connstate = ePlaying;
+    p->prompt = PROMPT;
+    playerlist.push_back (p);
+    AddPlayerToIndex (p);
+    JoinChannels (p);
+
+    // carry on as if nothing happened
+    *p << output << "** Restart complete. **\n" << p->prompt;
+    p->AddInput (input);
+    ++recovered;
+    } // end of each player
+
+  Log (eLogInfo, MAKE_STRING ("Copyover: " << recovered << " of " << count
+                              << " player(s) back after " << (RealTime () - written) / 1000 << " ms"));
+  return true;
+} // end of RecoverCopyover
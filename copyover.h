@@ -0,0 +1,29 @@
+#ifndef TINYMUDSERVER_COPYOVER_H
+#define TINYMUDSERVER_COPYOVER_H
+
+/*---------------------------------------------- */
+/*  copyover - restart without dropping anyone   */
+/*---------------------------------------------- */
+
+/*
+ The "copyover" command (for players with can_shutdown) restarts the server
+ - a new version, or to pick up changed rooms and so on - without closing
+ player connections. Everyone playing is written to COPYOVER_FILE: their
+ socket, name, address, what was waiting to be sent to them or read from
+ them, and what would be in their player file. Then the server execs itself
+ again with --copyover, and the new process inherits the listening socket and
+ the players' sockets, reads the file back (and deletes it), and carries on.
+ Players see a message before and after, and nothing in between.
+
+ Players who were still logging in are asked to connect again, and the world
+ (rooms, mobiles, objects on the floor) is loaded afresh. Copyover isn't
+ allowed while recording a journal, as the new process wouldn't be.
+*/
+
+// hand over to a new copy of the server - only returns if it couldn't
+void Copyover (char * argv []);
+
+// in the new copy, take over the listening socket and the players from the old one
+bool RecoverCopyover ();
+
+#endif // TINYMUDSERVER_COPYOVER_H
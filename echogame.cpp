@@ -0,0 +1,126 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon
+          http://www.gammon.com.au/
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+
+*/
+
+/*
+
+ echogame - a stand-in for the game, to try out the gateway (see gatewayipc.h)
+
+ Attaches to the gateway like "tinymudserver --gateway" does, greets each
+ connection, and sends back each line it is sent, with a prompt. Stop it
+ and start it again, and the connections should still be there.
+
+*/
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+
+// standard library includes ...
+
+#include <string>
+#include <map>
+#include <iostream>
+
+using namespace std;
+
+#include "constants.h"
+#include "gatewayipc.h"
+
+static bool bStop = false;
+
+static void bailout (int sig)
+{
+  bStop = true;
+} // end of bailout
+
+int main (int argc, char * argv [])
+{
+  struct sockaddr_un sa;
+  const socklen_t sa_len = GatewayAddress (sa);
+  const int gateway = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (connect (gateway, (struct sockaddr *) &sa, sa_len) == -1)
+    {
+    perror (GATEWAY_SOCKET);
+    return 1;
+    }
+  tGatewayShared * shared = MapGatewayMemory (false);
+  if (shared == NULL)
+    {
+    perror (GATEWAY_MEMORY);
+    return 1;
+    }
+
+  signal (SIGINT,  bailout);
+  signal (SIGTERM, bailout);
+
+  map<uint32_t, string> inbufs;   // part lines, by connection
+  map<uint32_t, string> pending;  // replies that didn't fit in the ring
+  unsigned long lines = 0;
+
+  cout << "Echoing lines from the gateway" << endl;
+
+  while (!bStop)
+    {
+    struct pollfd pfd = { gateway, POLLIN, 0 };
+    if (poll (&pfd, 1, 1000) <= 0)
+      continue;
+    if (!AnswerDoorbell (gateway))
+      break;    // gateway has gone
+
+    uint32_t connection;
+    tGatewayMessageType type;
+    string text;
+    while (shared->toGame.Get (connection, type, text))
+      {
+      if (type == eGatewayConnect)
+        pending [connection] += "Echo game - connection from " + text + "\n" + PROMPT;
+      else if (type == eGatewayDisconnect)
+        {
+        inbufs.erase (connection);
+        pending.erase (connection);
+        }
+      else if (type == eGatewayData)
+        {
+        string & inbuf = inbufs [connection];
+        inbuf += text;
+        string::size_type i;
+        while ((i = inbuf.find ('\n')) != string::npos)
+          {
+          pending [connection] += inbuf.substr (0, i + 1) + PROMPT;
+          inbuf.erase (0, i + 1);
+          ++lines;
+          }
+        }
+      } // end of each message
+
+    // send what will fit - the gateway rings again when there is room for the rest
+    bool sent = false;
+    for (map<uint32_t, string>::iterator i = pending.begin (); i != pending.end (); )
+      if (shared->toGateway.Put (i->first, eGatewayData, i->second.c_str (), i->second.size ()))
+        {
+        sent = true;
+        pending.erase (i++);
+        }
+      else
+        ++i;
+
+    if (sent || shared->toGame.TakeWantSpace ())
+      RingDoorbell (gateway);
+    } // end of main loop
+
+  UnmapGatewayMemory (shared);
+  close (gateway);
+  cout << "Echoed " << lines << " line(s)" << endl;
+  return 0;
+} // end of main
@@ -0,0 +1,230 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std; 
+
+#include "editdistance.h"
+
+tEditDistance::tEditDistance (const string & word)
+  : length (0), maxDistance (0), bestDistance (1)
+{
+  memset (peq, 0, sizeof peq);
+  
+  // one bit per character, so the word has to fit in a machine word
+  if (word.empty () || word.size () > 64)
+    return;
+    
+  length = word.size ();
+  for (int i = 0; i < length; ++i)
+    peq [tolower ((unsigned char) word [i])] |= uint64_t (1) << i;
+  
+  // "x" is one typo away from half the commands, so don't guess at those
+  if (length >= 3)
+    maxDistance = min (MAX_SUGGEST_DISTANCE, length / 2);
+  bestDistance = maxDistance + 1;
+} // end of tEditDistance::tEditDistance
+
+int tEditDistance::Distance (const string & text, const int limit) const
+{
+  const int n = text.size ();
+  
+  // each character inserted or deleted costs one
+  if (length == 0 || abs (n - length) > limit)
+    return limit + 1;
+  
+  const uint64_t last = uint64_t (1) << (length - 1);
+  uint64_t pv = length == 64 ? ~uint64_t (0) : (last << 1) - 1;   // vertical +1 deltas
+  uint64_t mv = 0;                                                  // vertical -1 deltas
+  int score = length;
+  
+  for (int j = 0; j < n; ++j)
+    {
+    const uint64_t eq = peq [tolower ((unsigned char) text [j])];
+    const uint64_t xv = eq | mv;
+    const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+    
+    if (ph & last)
+      score++;
+    else if (mh & last)
+      score--;
+    
+    // the score can only come down by one per remaining character
+    if (score - (n - j - 1) > limit)
+      return limit + 1;
+    
+    ph = (ph << 1) | 1;   // comparing whole words, so the top row counts up
+    mh <<= 1;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    }
+    
+  return score > limit ? limit + 1 : score;
+} // end of tEditDistance::Distance
+
+void tEditDistance::Consider (const string & text)
+{
+  if (bestDistance == 0 || maxDistance == 0)
+    return;   // can't do better than that, or not guessing
+    
+  // only interested in beating what we have
+  const int d = Distance (text, bestDistance - 1);
+  if (d < bestDistance)
+    {
+    best = text;
+    bestDistance = d;
+    }
+} // end of tEditDistance::Consider
+
+string DidYouMean (const tEditDistance & e)
+{
+  if (e.Best ().empty ())
+    return "";
+  return " Did you mean: " + e.Best () + "?";
+} // end of DidYouMean
+
+int tNameIndex::Find (const string & name) const
+{
+  if (nodes.empty ())
+    return -1;
+  
+  const tEditDistance e (name);
+  int node = 0;
+  while (true)
+    {
+    const int d = e.Distance (nodes [node].name, MAX_INDEXED_LENGTH);
+    if (d == 0)
+      return node;
+    
+    // the only place it could be
+    vector<pair<int, int> >::const_iterator i;
+    const vector<pair<int, int> > & children = nodes [node].children;
+    for (i = children.begin (); i != children.end (); ++i)
+      if (i->first == d)
+        break;
+    if (i == children.end ())
+      return -1;
+    node = i->second;
+    }
+} // end of tNameIndex::Find
+
+void tNameIndex::Insert (const string & name)
+{
+  count++;
+  if (nodes.empty ())
+    {
+    nodes.push_back (tNode (name));
+    return;
+    }
+    
+  const tEditDistance e (name);
+  int node = 0;
+  while (true)
+    {
+    const int d = e.Distance (nodes [node].name, MAX_INDEXED_LENGTH);
+    
+    vector<pair<int, int> >::const_iterator i;
+    const vector<pair<int, int> > & children = nodes [node].children;
+    for (i = children.begin (); i != children.end (); ++i)
+      if (i->first == d)
+        break;
+    if (i == children.end ())
+      {
+      nodes [node].children.push_back (make_pair (d, int (nodes.size ())));
+      nodes.push_back (tNode (name));
+      return;
+      }
+    node = i->second;
+    }
+} // end of tNameIndex::Insert
+
+void tNameIndex::Add (const string & name)
+{
+  if (name.empty () || name.size () > size_t (MAX_INDEXED_LENGTH))
+    return;
+  
+  const int node = Find (name);
+  if (node < 0)
+    Insert (name);
+  else if (!nodes [node].live)
+    {
+    nodes [node].live = true;   // back again
+    nodes [node].name = name;
+    count++;
+    dead--;
+    }
+} // end of tNameIndex::Add
+
+void tNameIndex::Remove (const string & name)
+{
+  const int node = Find (name);
+  if (node < 0 || !nodes [node].live)
+    return;
+  
+  nodes [node].live = false;
+  count--;
+  dead++;
+  
+  // once most of the tree is removed names, start again with the live ones
+  if (dead > count && dead >= 64)
+    {
+    vector<string> names;
+    for (vector<tNode>::const_iterator i = nodes.begin (); i != nodes.end (); ++i)
+      if (i->live)
+        names.push_back (i->name);
+    nodes.clear ();
+    count = dead = 0;
+    for (vector<string>::const_iterator i = names.begin (); i != names.end (); ++i)
+      Insert (*i);
+    }
+} // end of tNameIndex::Remove
+
+void tNameIndex::Suggest (tEditDistance & e) const
+{
+  int limit = e.MaxDistance ();
+  if (nodes.empty () || limit == 0)
+    return;   // nothing to suggest, or not guessing
+    
+  vector<int> todo (1, 0);
+  for (int checks = 0; !todo.empty () && checks < MAX_SUGGEST_CHECKS; ++checks)
+    {
+    const tNode & node = nodes [todo.back ()];
+    todo.pop_back ();
+    
+    const int d = e.Distance (node.name, MAX_INDEXED_LENGTH);
+    if (node.live && d <= limit)
+      {
+      e.Consider (node.name);
+      if (d == 0)
+        return;     // can't do better
+      limit = d - 1;  // only interested in closer ones now
+      }
+    
+    // anything within limit of the word is within limit of d from here
+    for (vector<pair<int, int> >::const_iterator i = node.children.begin (); 
+         i != node.children.end (); ++i)
+      if (abs (i->first - d) <= limit)
+        todo.push_back (i->second);
+    }
+} // end of tNameIndex::Suggest
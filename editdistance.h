@@ -0,0 +1,85 @@
+#ifndef TINYMUDSERVER_EDITDISTANCE_H
+#define TINYMUDSERVER_EDITDISTANCE_H
+
+#include <stdint.h>
+#include <vector>
+#include <utility>
+
+/*---------------------------------------------- */
+/*  Edit distance - "did you mean" suggestions    */
+/*---------------------------------------------- */
+
+/*
+ Myers' bit-parallel algorithm: the word being looked up is turned into
+ one bitmask per character once, then each candidate costs a few machine
+ operations per character. Comparisons are case-independent.
+*/
+
+static const int MAX_SUGGEST_DISTANCE = 2;  // further away than this is not a typo
+static const int MAX_INDEXED_LENGTH = 64;   // longer names are not suggested
+static const int MAX_SUGGEST_CHECKS = 100;  // most names compared in one lookup
+
+class tEditDistance
+  {
+  uint64_t peq [256];       // character -> positions in the word where it appears
+  int length;               // of the word (0 = too long, never matches)
+  int maxDistance;          // short words get fewer typos
+  
+  string best;              // closest candidate so far
+  int bestDistance;
+  
+  public:
+  
+  tEditDistance (const string & word);
+  
+  // edit distance to text, or limit + 1 if it is more than limit
+  int Distance (const string & text, const int limit = MAX_SUGGEST_DISTANCE) const;
+  
+  // remember text if it is the closest candidate so far
+  void Consider (const string & text);
+  
+  // closest candidate within the allowed distance, or empty
+  const string & Best () const { return best; }
+  bool Exact () const { return bestDistance == 0; }
+  int MaxDistance () const { return maxDistance; }
+  };  // end of class tEditDistance
+
+/*
+ A BK-tree of names: each child hangs off its parent by their edit distance,
+ so (by the triangle inequality) a lookup only needs to visit children whose
+ distance is within MaxDistance of the parent's distance to the word.
+ Removed names stay in the tree to keep it connected until it is rebuilt.
+*/
+
+class tNameIndex
+  {
+  struct tNode
+    {
+    string name;
+    bool live;    // false once removed
+    std::vector<std::pair<int, int> > children;  // distance -> node
+    tNode (const string & s) : name (s), live (true) {}
+    };  // end of tNode
+    
+  std::vector<tNode> nodes;   // node 0 is the root
+  int count;                  // live names
+  int dead;                   // removed names still in the tree
+  
+  int Find (const string & name) const;   // node, or -1 if not there
+  void Insert (const string & name);
+  
+  public:
+  
+  tNameIndex () : count (0), dead (0) {}
+  
+  void Add (const string & name);
+  void Remove (const string & name);
+  
+  // offer e the names close enough to its word (at most MAX_SUGGEST_CHECKS of them)
+  void Suggest (tEditDistance & e) const;
+  };  // end of class tNameIndex
+
+// eg. " Did you mean: look?" - or nothing if there is no suggestion
+string DidYouMean (const tEditDistance & e);
+
+#endif // TINYMUDSERVER_EDITDISTANCE_H
@@ -0,0 +1,46 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <sys/time.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "gameclock.h"
+
+static bool clockSet = false;   // true once SetGameTime is called
+static int64_t gameclock = 0;   // the time it was set to (usec)
+
+void GetGameTime (struct timeval & tv)
+{
+  if (!clockSet)
+    {
+    gettimeofday (&tv, NULL);
+    return;
+    }
+  tv.tv_sec  = gameclock / 1000000;
+  tv.tv_usec = gameclock % 1000000;
+} // end of GetGameTime
+
+time_t GameTime ()
+{
+  if (!clockSet)
+    return time (NULL);
+  return gameclock / 1000000;
+} // end of GameTime
+
+void SetGameTime (const int64_t usec)
+{
+  gameclock = usec;
+  clockSet = true;
+} // end of SetGameTime
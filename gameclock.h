@@ -0,0 +1,24 @@
+#ifndef TINYMUDSERVER_GAMECLOCK_H
+#define TINYMUDSERVER_GAMECLOCK_H
+
+#include <sys/time.h>
+#include <time.h>
+#include <stdint.h>
+
+/*---------------------------------------------- */
+/*  game clock - what the game thinks the time is */
+/*---------------------------------------------- */
+
+/*
+ Normally the real time. Replaying a journal, or running the simulation,
+ sets it instead, so that things that happen on a timer (mobiles, the
+ periodic message, login deadlines) happen at the same points every run.
+*/
+
+void GetGameTime (struct timeval & tv);
+time_t GameTime ();
+
+// from now on the clock only moves when this is called (usec since the epoch)
+void SetGameTime (const int64_t usec);
+
+#endif // TINYMUDSERVER_GAMECLOCK_H
@@ -0,0 +1,425 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+/*
+
+ gateway - holds the players' connections for the game (see gatewayipc.h)
+
+ Accepts players on PORT, and passes their input to whichever game is
+ attached to GATEWAY_SOCKET, and the game's output back to them. While no
+ game is attached, players stay connected and are told to wait.
+
+*/
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+#include "utils.h"
+#include "constants.h"
+#include "gatewayipc.h"
+
+// one player's connection
+struct tClient
+  {
+  int s;              // socket
+  string address;     // "<address> <port>", as the game is told it
+  string outbuf;      // from the game, not yet sent
+  bool closing;       // the game has closed it - close once outbuf is sent
+  bool announced;     // the attached game knows about it
+
+  tClient () : s (NO_SOCKET), closing (false), announced (false) {}
+  };  // end of tClient
+
+typedef map<uint32_t, tClient> tClients;
+
+static tClients clients;                    // by connection number
+static deque<uint32_t> announces;           // connections to tell the game about, when there is room
+static uint32_t lastConnection = 0;         // connection numbers given out so far
+static int listener = NO_SOCKET;            // players connect here
+static int gameListener = NO_SOCKET;        // the game attaches here
+static int game = NO_SOCKET;                // the attached game's doorbell
+static tGatewayShared * shared = NULL;      // the rings
+static bool ringGame = false;               // something for the game since its doorbell last rang
+static bool bStop = false;
+
+static const string WAIT_MESSAGE = "\n** The game is restarting - please wait. **\n";
+
+static void bailout (int sig)
+{
+  bStop = true;
+} // end of bailout
+
+// send what we can to a player, and close them if the game has finished with them
+static void SendToClient (const tClients::iterator & i)
+{
+  tClient & c = i->second;
+  while (!c.outbuf.empty ())
+    {
+    const int nWrite = write (c.s, c.outbuf.c_str (), c.outbuf.size ());
+    if (nWrite <= 0)
+      {
+      if (nWrite == -1 && errno == EWOULDBLOCK)
+        return;   // try again when poll says we can
+      c.outbuf.clear ();  // they have gone - we will see that when we read
+      break;
+      }
+    c.outbuf.erase (0, nWrite);
+    }
+
+  if (c.closing)
+    {
+    close (c.s);
+    clients.erase (i);
+    }
+} // end of SendToClient
+
+// tell the game about a connection - in order, so after any still waiting for room
+static void AnnounceClient (const uint32_t connection, tClient & c)
+{
+  if (announces.empty () && 
+      shared->toGame.Put (connection, eGatewayConnect, c.address.c_str (), c.address.size ()))
+    {
+    c.announced = true;
+    ringGame = true;
+    }
+  else
+    announces.push_back (connection);
+} // end of AnnounceClient
+
+// announces that didn't fit before
+static void AnnouncePending ()
+{
+  while (!announces.empty ())
+    {
+    tClients::iterator i = clients.find (announces.front ());
+    if (i != clients.end () && !i->second.closing)
+      {
+      tClient & c = i->second;
+      if (!shared->toGame.Put (i->first, eGatewayConnect, c.address.c_str (), c.address.size ()))
+        return;   // the game rings when it has read some
+      c.announced = true;
+      ringGame = true;
+      }
+    announces.pop_front ();
+    }
+} // end of AnnouncePending
+
+static void AttachGame (const int s)
+{
+  if (game != NO_SOCKET)
+    {
+    close (s);    // one game at a time
+    return;
+    }
+
+  fcntl (s, F_SETFL, O_NONBLOCK);
+  game = s;
+  shared->toGame.Reset ();
+  shared->toGateway.Reset ();
+
+  // the new game gets everyone, as new connections
+  announces.clear ();
+  for (tClients::iterator i = clients.begin (); i != clients.end (); ++i)
+    if (!i->second.closing)
+      AnnounceClient (i->first, i->second);
+
+  cout << "Game attached, " << clients.size () << " connection(s)" << endl;
+} // end of AttachGame
+
+static void DetachGame ()
+{
+  close (game);
+  game = NO_SOCKET;
+  ringGame = false;
+  announces.clear ();
+
+  for (tClients::iterator i = clients.begin (); i != clients.end (); ++i)
+    {
+    i->second.announced = false;
+    if (!i->second.closing)
+      i->second.outbuf += WAIT_MESSAGE;
+    }
+
+  cout << "Game detached, " << clients.size () << " connection(s) waiting" << endl;
+} // end of DetachGame
+
+// the game rang - take what it sent (its last words, if it has gone)
+static void ProcessGame ()
+{
+  const bool attached = AnswerDoorbell (game);
+
+  uint32_t connection;
+  tGatewayMessageType type;
+  string text;
+  vector<uint32_t> touched;   // players to send to, once the ring is empty
+  while (shared->toGateway.Get (connection, type, text))
+    {
+    tClients::iterator i = clients.find (connection);
+    if (i == clients.end ())
+      continue;   // gone already
+    if (i->second.outbuf.empty ())
+      touched.push_back (connection);
+    if (type == eGatewayData)
+      i->second.outbuf += text;
+    else if (type == eGatewayClose)
+      {
+      i->second.closing = true;
+      touched.push_back (connection);   // even with nothing to send
+      }
+    }
+
+  if (!attached)
+    DetachGame ();
+  // the game is waiting for room to write more
+  else if (shared->toGateway.TakeWantSpace ())
+    RingDoorbell (game);
+
+  for (vector<uint32_t>::const_iterator t = touched.begin (); t != touched.end (); ++t)
+    {
+    tClients::iterator i = clients.find (*t);
+    if (i != clients.end ())
+      SendToClient (i);
+    }
+} // end of ProcessGame
+
+static void ProcessNewConnections ()
+{
+  struct sockaddr_in sa;
+  socklen_t sa_len = sizeof sa;
+  int s;
+  while ((s = accept (listener, (struct sockaddr *) &sa, &sa_len)) != NO_SOCKET)
+    {
+    fcntl (s, F_SETFL, O_NONBLOCK);
+    const uint32_t connection = ++lastConnection;
+    tClient & c = clients [connection];
+    c.s = s;
+    c.address = MAKE_STRING (inet_ntoa (sa.sin_addr) << " " << ntohs (sa.sin_port));
+    if (game != NO_SOCKET)
+      AnnounceClient (connection, c);
+    else
+      {
+      c.outbuf = WAIT_MESSAGE;
+      SendToClient (clients.find (connection));
+      }
+    sa_len = sizeof sa;
+    }
+} // end of ProcessNewConnections
+
+// a player sent something (or hung up)
+static void ProcessClientRead (const tClients::iterator & i)
+{
+  static char buf [GATEWAY_READ_SIZE];
+  const int nRead = read (i->second.s, buf, sizeof buf);
+  if (nRead == -1 && (errno == EWOULDBLOCK || errno == EINTR))
+    return;
+
+  if (nRead <= 0)
+    {
+    if (game != NO_SOCKET && shared->toGame.Put (i->first, eGatewayDisconnect))
+      ringGame = true;
+    close (i->second.s);
+    clients.erase (i);
+    return;
+    }
+
+  // what they type while there is no game goes nowhere
+  if (game != NO_SOCKET && !i->second.closing)
+    {
+    shared->toGame.Put (i->first, eGatewayData, buf, nRead);  // there is room (see MainLoop)
+    ringGame = true;
+    }
+} // end of ProcessClientRead
+
+static void OpenListeners ()
+{
+  // players
+  if ((listener = socket (AF_INET, SOCK_STREAM, 0)) == -1)
+    throw runtime_error ("creating player socket");
+  int x = 1;
+  setsockopt (listener, SOL_SOCKET, SO_REUSEADDR, (char *) &x, sizeof x);
+  struct sockaddr_in sa = sockaddr_in ();
+  sa.sin_family       = AF_INET;
+  sa.sin_port         = htons (PORT);
+  sa.sin_addr.s_addr  = INADDR_ANY;
+  if (bind (listener, (struct sockaddr *) &sa, sizeof sa) == -1)
+    throw runtime_error ("bind to player port");
+  if (listen (listener, SOMAXCONN) == -1)
+    throw runtime_error ("listen on player port");
+  fcntl (listener, F_SETFL, O_NONBLOCK);
+
+  // the game
+  if ((gameListener = socket (AF_UNIX, SOCK_STREAM, 0)) == -1)
+    throw runtime_error ("creating game socket");
+  struct sockaddr_un su;
+  const socklen_t su_len = GatewayAddress (su);
+  unlink (GATEWAY_SOCKET);    // left over from last time
+  if (bind (gameListener, (struct sockaddr *) &su, su_len) == -1)
+    throw runtime_error (GATEWAY_SOCKET);
+  if (listen (gameListener, 1) == -1)
+    throw runtime_error ("listen on game socket");
+  fcntl (gameListener, F_SETFL, O_NONBLOCK);
+} // end of OpenListeners
+
+static void MainLoop ()
+{
+  vector<struct pollfd> pollfds;
+  vector<uint32_t> pollclients;   // connection for each player entry
+
+  while (!bStop)
+    {
+    pollfds.clear ();
+    pollclients.clear ();
+
+    // only read from players if what they send will fit
+    const bool room = game == NO_SOCKET || shared->toGame.HasRoom (GATEWAY_READ_SIZE);
+
+    struct pollfd pfd;
+    pfd.revents = 0;
+    pfd.events = POLLIN;
+    pfd.fd = room ? listener : NO_SOCKET;
+    pollfds.push_back (pfd);
+    pfd.fd = gameListener;
+    pollfds.push_back (pfd);
+    pfd.fd = game;
+    pollfds.push_back (pfd);
+    for (tClients::const_iterator i = clients.begin (); i != clients.end (); ++i)
+      {
+      // leave them be until the game knows about them, or their input would go nowhere
+      pfd.fd = game == NO_SOCKET || i->second.announced ? i->second.s : NO_SOCKET;
+      pfd.events = (room ? POLLIN : 0) | (i->second.outbuf.empty () ? 0 : POLLOUT);
+      pollfds.push_back (pfd);
+      pollclients.push_back (i->first);
+      }
+
+    if (poll (&pollfds [0], pollfds.size (), 1000) <= 0)
+      continue;
+
+    if (pollfds [1].revents)
+      {
+      const int s = accept (gameListener, NULL, NULL);
+      if (s != NO_SOCKET)
+        AttachGame (s);
+      }
+
+    if (game != NO_SOCKET && pollfds [2].revents)
+      ProcessGame ();
+
+    if (game != NO_SOCKET)
+      AnnouncePending ();
+
+    if (pollfds [0].revents)
+      ProcessNewConnections ();
+
+    // players - each read is at most GATEWAY_READ_SIZE, so check there is room for the next
+    const struct pollfd * p = &pollfds [3];
+    for (vector<uint32_t>::const_iterator c = pollclients.begin (); c != pollclients.end (); ++c, ++p)
+      {
+      if (!p->revents)
+        continue;
+      tClients::iterator i = clients.find (*c);
+      if (i == clients.end () || i->second.s != p->fd)
+        continue;   // closed meanwhile
+      if (p->revents & POLLOUT)
+        SendToClient (i);
+      i = clients.find (*c);
+      if (i != clients.end () && (p->revents & (POLLIN | POLLHUP | POLLERR)) &&
+          (game == NO_SOCKET || shared->toGame.HasRoom (GATEWAY_READ_SIZE)))
+        ProcessClientRead (i);
+      }
+
+    // one doorbell for everything this time around
+    if (ringGame)
+      {
+      RingDoorbell (game);
+      ringGame = false;
+      }
+    } // end of main loop
+} // end of MainLoop
+
+int main (int argc, char * argv [])
+{
+  if (argc > 1)
+    {
+    cerr << "Usage: " << argv [0] << "  (then run: tinymudserver --gateway)" << endl;
+    return 1;
+    }
+
+  shared = MapGatewayMemory (true);
+  if (shared == NULL)
+    {
+    perror (GATEWAY_MEMORY);
+    return 1;
+    }
+
+  try
+    {
+    OpenListeners ();
+    }
+  catch (runtime_error & e)
+    {
+    perror (e.what ());
+    return 1;
+    }
+
+  // as many players as we are allowed
+  struct rlimit rl;
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit (RLIMIT_NOFILE, &rl);
+    }
+
+  signal (SIGINT,  bailout);
+  signal (SIGTERM, bailout);
+  signal (SIGPIPE, SIG_IGN);  // a player gone while we write to them
+
+  cout << "Gateway accepting connections from port " << PORT
+       << ", game attaches at " << GATEWAY_SOCKET << endl;
+
+  MainLoop ();
+
+  for (tClients::const_iterator i = clients.begin (); i != clients.end (); ++i)
+    close (i->second.s);
+  if (game != NO_SOCKET)
+    close (game);
+  close (listener);
+  close (gameListener);
+  unlink (GATEWAY_SOCKET);
+  UnmapGatewayMemory (shared);
+  shm_unlink (GATEWAY_MEMORY);
+
+  cout << "Gateway stopped." << endl;
+  return 0;
+} // end of main
@@ -0,0 +1,202 @@
+#ifndef TINYMUDSERVER_GATEWAYIPC_H
+#define TINYMUDSERVER_GATEWAYIPC_H
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <algorithm>
+
+#include "constants.h"  // for GATEWAY_RING_SIZE etc.
+
+/*---------------------------------------------- */
+/*  gateway - players' connections held by another process */
+/*---------------------------------------------- */
+
+/*
+ With the gateway running (./gateway), the game (./tinymudserver --gateway)
+ doesn't listen for players itself. The gateway accepts them, and passes
+ what they type to the game, and what the game sends back to them, through
+ two rings in shared memory. If the game stops - it crashed, or is being
+ replaced by a new version - the gateway keeps their connections open and
+ tells them to wait, and when a game attaches again they are greeted again.
+
+ The game attaches by connecting to GATEWAY_SOCKET, which after that is only
+ a doorbell: whoever puts a batch of messages in a ring writes a byte to it,
+ so one wakeup covers many players' traffic. Each ring has one writer and
+ one reader, so needs no locks. A message is a tGatewayMessage followed by
+ <length> bytes of data, wrapping around the end of the ring if need be.
+*/
+
+typedef enum
+  {
+  eGatewayConnect,      // to the game: a new connection, data is "<address> <port>"
+  eGatewayData,         // either way: what they typed, or what to send them
+  eGatewayDisconnect,   // to the game: they closed the connection
+  eGatewayClose         // to the gateway: close it, once what was sent has gone
+  } tGatewayMessageType;
+
+struct tGatewayMessage
+  {
+  uint32_t connection;  // numbered by the gateway, from 1
+  uint32_t type;        // tGatewayMessageType
+  uint32_t length;      // of the data after this
+  };  // end of tGatewayMessage
+
+// one direction - lives in shared memory, so no pointers or constructors
+class tGatewayRing
+  {
+  uint64_t head;        // bytes ever written - only the writer changes it
+  char pad1 [56];       // (each on its own cache line, as the two processes share them)
+  uint64_t tail;        // bytes ever read - only the reader changes it
+  char pad2 [56];
+  uint32_t wantSpace;   // the writer found it full, and wants the doorbell when there is room
+  char pad3 [60];
+  char data [GATEWAY_RING_SIZE];
+
+  void CopyIn (const uint64_t position, const void * from, const size_t length)
+    {
+    const size_t offset = position & (GATEWAY_RING_SIZE - 1);
+    const size_t first = std::min<size_t> (length, GATEWAY_RING_SIZE - offset);
+    memcpy (&data [offset], from, first);
+    memcpy (&data [0], (const char *) from + first, length - first);
+    }
+
+  void CopyOut (const uint64_t position, void * to, const size_t length) const
+    {
+    const size_t offset = position & (GATEWAY_RING_SIZE - 1);
+    const size_t first = std::min<size_t> (length, GATEWAY_RING_SIZE - offset);
+    memcpy (to, &data [offset], first);
+    memcpy ((char *) to + first, &data [0], length - first);
+    }
+
+  public:
+
+  // empty it - only while nobody is attached
+  void Reset () { head = tail = 0; wantSpace = 0; }
+
+  // writer: bytes free, less a message header
+  size_t Space () const
+    {
+    const uint64_t used = head - __atomic_load_n (&tail, __ATOMIC_ACQUIRE);
+    const size_t space = GATEWAY_RING_SIZE - used;
+    return space > sizeof (tGatewayMessage) ? space - sizeof (tGatewayMessage) : 0;
+    }
+
+  // writer: true if a message of this length would fit - if not, the reader rings when it does
+  bool HasRoom (const size_t length)
+    {
+    if (Space () >= length)
+      return true;
+    // each side stores one of wantSpace and tail, then loads the other - without
+    // a full fence either store could pass the load, and both would miss the other's
+    __atomic_store_n (&wantSpace, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    return Space () >= length;  // they might have read it all just before seeing wantSpace
+    }
+
+  // writer: false if there isn't room (nothing is written)
+  bool Put (const uint32_t connection, const tGatewayMessageType type,
+            const char * text = NULL, const uint32_t length = 0)
+    {
+    if (!HasRoom (length))
+      return false;
+    const tGatewayMessage m = { connection, uint32_t (type), length };
+    CopyIn (head, &m, sizeof m);
+    if (length > 0)
+      CopyIn (head + sizeof m, text, length);   // (header-only messages have no text at all)
+    __atomic_store_n (&head, head + sizeof m + length, __ATOMIC_RELEASE);
+    return true;
+    }
+
+  // reader: the next message, or false if there isn't one
+  bool Get (uint32_t & connection, tGatewayMessageType & type, std::string & text)
+    {
+    if (__atomic_load_n (&head, __ATOMIC_ACQUIRE) == tail)
+      return false;
+    tGatewayMessage m;
+    CopyOut (tail, &m, sizeof m);
+    text.resize (m.length);
+    if (m.length)
+      CopyOut (tail + sizeof m, &text [0], m.length);
+    connection = m.connection;
+    type = tGatewayMessageType (m.type);
+    __atomic_store_n (&tail, tail + sizeof m + m.length, __ATOMIC_RELEASE);
+    return true;
+    }
+
+  // reader: true if the writer is waiting for room (and forget that it is)
+  // (after storing tail in Get - see HasRoom for the fence)
+  bool TakeWantSpace () 
+    { 
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    return __atomic_exchange_n (&wantSpace, 0, __ATOMIC_SEQ_CST) != 0; 
+    }
+
+  };  // end of class tGatewayRing
+
+// the shared memory
+struct tGatewayShared
+  {
+  tGatewayRing toGame;      // written by the gateway
+  tGatewayRing toGateway;   // written by the game
+  };  // end of tGatewayShared
+
+// create it (the gateway) or open it (the game) - NULL on failure, with errno set
+inline tGatewayShared * MapGatewayMemory (const bool create)
+{
+  if (create)
+    shm_unlink (GATEWAY_MEMORY);    // left over from last time
+  const int fd = shm_open (GATEWAY_MEMORY, create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+  if (fd == -1)
+    return NULL;
+  if (create && ftruncate (fd, sizeof (tGatewayShared)) == -1)
+    {
+    close (fd);
+    return NULL;
+    }
+  void * p = mmap (NULL, sizeof (tGatewayShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);   // the mapping keeps it
+  return p == MAP_FAILED ? NULL : (tGatewayShared *) p;
+} // end of MapGatewayMemory
+
+inline void UnmapGatewayMemory (tGatewayShared * shared)
+{
+  munmap (shared, sizeof (tGatewayShared));
+} // end of UnmapGatewayMemory
+
+// the address of GATEWAY_SOCKET
+inline socklen_t GatewayAddress (struct sockaddr_un & sa)
+{
+  memset (&sa, 0, sizeof sa);
+  sa.sun_family = AF_UNIX;
+  strncpy (sa.sun_path, GATEWAY_SOCKET, sizeof sa.sun_path - 1);
+  return sizeof sa;
+} // end of GatewayAddress
+
+// after putting messages - if the socket is full, a ring is waiting to be answered anyway
+inline void RingDoorbell (const int s)
+{
+  const char bell = 0;
+  send (s, &bell, 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+} // end of RingDoorbell
+
+// before reading messages - false if the other end has gone
+inline bool AnswerDoorbell (const int s)
+{
+  char bells [256];
+  while (true)
+    {
+    const int n = recv (s, bells, sizeof bells, MSG_DONTWAIT);
+    if (n > 0)
+      continue;
+    return n == -1 && (errno == EWOULDBLOCK || errno == EINTR);
+    }
+} // end of AnswerDoorbell
+
+#endif // TINYMUDSERVER_GATEWAYIPC_H
@@ -0,0 +1,305 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+
+// standard library includes ...
+
+#include <string>
+#include <map>
+#include <deque>
+#include <iostream>
+
+using namespace std;
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "globals.h"
+#include "preauth.h"
+#include "metrics.h"
+#include "journal.h"
+#include "log.h"
+#include "gatewayipc.h"
+#include "gatewaylink.h"
+
+static int gateway = NO_SOCKET;             // doorbell
+static tGatewayShared * shared = NULL;      // the rings
+static map<uint32_t, tPlayer*> gatewayplayers;  // by the gateway's connection number
+static map<uint32_t, tPendingConnection*> gatewaypending;  // ones that haven't sent their name yet
+static deque<uint32_t> closes;              // connections to close, when there is room
+static bool ringGateway = false;            // something for the gateway since its doorbell last rang
+
+// ask the gateway to close one
+static void QueueClose (const uint32_t connection)
+{
+  if (closes.empty () && shared->toGateway.Put (connection, eGatewayClose))
+    ringGateway = true;
+  else
+    closes.push_back (connection);
+} // end of QueueClose
+
+// a player's connection, held by the gateway
+class tGatewayConnection : public tConnection
+  {
+  uint32_t connection;
+
+  public:
+  tGatewayConnection (const uint32_t c) : connection (c) {}
+
+  // the gateway closes it - unless it is the gateway that told us they had gone
+  ~tGatewayConnection ()
+    {
+    if (gatewayplayers.erase (connection) && shared)
+      QueueClose (connection);
+    }
+
+  int Read (char * buf, const int size) { errno = EWOULDBLOCK; return -1; }  // input arrives by ProcessGateway
+
+  int Write (const char * buf, const int size)
+    {
+    if (shared == NULL)
+      {
+      errno = EPIPE;
+      return -1;
+      }
+    if (!shared->toGateway.Put (connection, eGatewayData, buf, size))
+      {
+      errno = EWOULDBLOCK;    // the gateway rings when there is room
+      return -1;
+      }
+    ringGateway = true;
+    return size;
+    }
+  };  // end of class tGatewayConnection
+
+tConnection * NewGatewayConnection (const uint32_t connection)
+{
+  return new tGatewayConnection (connection);
+} // end of NewGatewayConnection
+
+void SendToGateway (const uint32_t connection, const string & text)
+{
+  if (shared && shared->toGateway.Put (connection, eGatewayData, text.c_str (), text.size ()))
+    ringGateway = true;
+} // end of SendToGateway
+
+void CloseGatewayConnection (const uint32_t connection)
+{
+  if (gatewaypending.erase (connection) && shared)
+    QueueClose (connection);
+} // end of CloseGatewayConnection
+
+bool AttachGateway ()
+{
+  struct sockaddr_un sa;
+  const socklen_t sa_len = GatewayAddress (sa);
+  gateway = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (gateway == NO_SOCKET || connect (gateway, (struct sockaddr *) &sa, sa_len) == -1)
+    {
+    perror (GATEWAY_SOCKET);
+    DetachGateway ();
+    return false;
+    }
+
+  shared = MapGatewayMemory (false);
+  if (shared == NULL)
+    {
+    perror (GATEWAY_MEMORY);
+    DetachGateway ();
+    return false;
+    }
+
+  cout << "Attached to the gateway at " << GATEWAY_SOCKET << endl;
+  return true;
+} // end of AttachGateway
+
+void DetachGateway ()
+{
+  if (gateway != NO_SOCKET)
+    close (gateway);
+  gateway = NO_SOCKET;
+  if (shared)
+    UnmapGatewayMemory (shared);
+  shared = NULL;
+  gatewayplayers.clear ();    // so deleting them doesn't close them
+  gatewaypending.clear ();
+  closes.clear ();
+} // end of DetachGateway
+
+int GatewaySocket ()
+{
+  return gateway;
+} // end of GatewaySocket
+
+// a new connection - "<address> <port>"
+static void NewConnection (const uint32_t connection, const string & from)
+{
+  istringstream is (from);
+  string address;
+  int port = 0;
+  is >> address >> port;
+
+  tIPAddress a;
+  int prefix;
+  if (!ParseAddressRange (address, a, prefix))
+    return;
+
+  // the same checks as ProcessNewConnection
+  if (blockedIP.Contains (a))
+    {
+    Count (eBlocked);
+    Log (eLogWarning, "Rejected connection from " + address);
+    closes.push_back (connection);
+    return;
+    }
+  if (!throttle.AllowConnect (a))
+    {
+    Count (eThrottled);
+    closes.push_back (connection);
+    return;
+    }
+
+  struct in_addr in;
+  if (inet_aton (address.c_str (), &in) == 0)
+    {
+    closes.push_back (connection);
+    return;
+    }
+
+  Count (eAccepts);
+  Log (eLogInfo, MAKE_STRING ("New player accepted from the gateway, connection " << connection
+                              << ", from address " << address << ", port " << port));
+
+  // they wait for their name like everyone else
+  tPendingConnection * c = AddGatewayPending (connection, in, port);
+  if (c == NULL)
+    closes.push_back (connection);
+  else
+    gatewaypending [connection] = c;
+} // end of NewConnection
+
+// input or a hangup from one who hasn't sent their name yet
+static void PendingMessage (map<uint32_t, tPendingConnection*>::iterator i,
+                            const tGatewayMessageType type, const string & text)
+{
+  const uint32_t connection = i->first;
+  tPendingConnection * c = i->second;
+
+  if (type == eGatewayDisconnect)
+    {
+    gatewaypending.erase (i);   // already closed
+    ClosePending (c);
+    return;
+    }
+
+  if (type != eGatewayData)
+    return;
+
+  tPlayer * p = ProcessGatewayPendingInput (c, text);
+  if (p)
+    gatewayplayers [connection] = p;
+  if (!c->Open ())
+    gatewaypending.erase (connection);   // a player now, or closed
+} // end of PendingMessage
+
+// lost the gateway - and so, everyone
+static void LostGateway ()
+{
+  Log (eLogError, "Lost the gateway - shutting down");
+  map<uint32_t, tPlayer*> gone;
+  gone.swap (gatewayplayers);
+  DetachGateway ();
+  for (map<uint32_t, tPlayer*>::const_iterator i = gone.begin (); i != gone.end (); ++i)
+    if (i->second->Connected ())
+      i->second->LostConnection ();
+  bStopNow = true;
+} // end of LostGateway
+
+void ProcessGateway ()
+{
+  if (!AnswerDoorbell (gateway))
+    {
+    LostGateway ();
+    return;
+    }
+
+  uint32_t connection;
+  tGatewayMessageType type;
+  string text;
+  while (shared->toGame.Get (connection, type, text))
+    {
+    if (type == eGatewayConnect)
+      {
+      NewConnection (connection, text);
+      continue;
+      }
+
+    map<uint32_t, tPendingConnection*>::iterator pending = gatewaypending.find (connection);
+    if (pending != gatewaypending.end ())
+      {
+      PendingMessage (pending, type, text);
+      continue;
+      }
+
+    map<uint32_t, tPlayer*>::iterator i = gatewayplayers.find (connection);
+    if (i == gatewayplayers.end ())
+      continue;   // we closed it meanwhile
+    tPlayer * p = i->second;
+
+    if (type == eGatewayData)
+      {
+      Count (eBytesIn, text.size ());
+      p->AddInput (text);
+      }
+    else if (type == eGatewayDisconnect)
+      {
+      gatewayplayers.erase (i);   // already closed
+      JournalDisconnect (p);
+      p->LostConnection ();
+      }
+    } // end of each message
+
+  // it is waiting for room to send more
+  if (shared->toGame.TakeWantSpace ())
+    ringGateway = true;
+} // end of ProcessGateway
+
+void FlushGateway ()
+{
+  if (shared == NULL)
+    return;
+
+  // closes that didn't fit before
+  while (!closes.empty () && shared->toGateway.Put (closes.front (), eGatewayClose))
+    {
+    closes.pop_front ();
+    ringGateway = true;
+    }
+
+  for (map<uint32_t, tPlayer*>::const_iterator i = gatewayplayers.begin ();
+       i != gatewayplayers.end (); ++i)
+    if (i->second->PendingOutput ())
+      i->second->ProcessWrite ();
+
+  // one doorbell for everything this tick
+  if (ringGateway)
+    RingDoorbell (gateway);
+  ringGateway = false;
+} // end of FlushGateway
@@ -0,0 +1,27 @@
+#ifndef TINYMUDSERVER_GATEWAYLINK_H
+#define TINYMUDSERVER_GATEWAYLINK_H
+
+/*---------------------------------------------- */
+/*  the game's side of the gateway (see gatewayipc.h) */
+/*---------------------------------------------- */
+
+/*
+ With --gateway the game doesn't listen on PORT: each connection the
+ gateway tells us about waits in preauth.h until it sends its name (with the
+ same limits as our own), then gets a tPlayer whose output goes into the ring
+ at the end of each tick. If the gateway goes away, so have the players,
+ and the game shuts down.
+*/
+
+bool AttachGateway ();    // false if the gateway isn't running
+void DetachGateway ();    // players stay connected to the gateway
+int GatewaySocket ();     // to poll - NO_SOCKET if not attached
+void ProcessGateway ();   // the doorbell rang - new connections, input, hangups
+void FlushGateway ();     // end of the tick - send what players have waiting
+
+// for preauth.cpp - connections that haven't logged in yet
+tConnection * NewGatewayConnection (const uint32_t connection);       // for their tPlayer
+void SendToGateway (const uint32_t connection, const string & text);  // now or not at all
+void CloseGatewayConnection (const uint32_t connection);
+
+#endif // TINYMUDSERVER_GATEWAYLINK_H
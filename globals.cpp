@@ -21,10 +21,19 @@ using namespace std;
 // global variables
 bool   bStopNow = false;      // when set, the MUD shuts down
 time_t tLastMessage = 0;      // time we last sent a periodic message 
+bool   bCopyover = false;     // with bStopNow, restart it instead (see copyover.h)
+bool   bSavePlayers = true;   // when clear, player files aren't written (eg. replaying)
+bool   bParallelInput = true;  // when clear, room commands aren't run in parallel (eg. to compare)
 int    iControl = NO_SOCKET;  // socket for accepting new connections 
 
 // list of all connected players
 tPlayerList playerlist;   
+// players in the game, by name
+tPlayerNameMap playernamemap;
+// the same names, for "did you mean" suggestions
+tNameIndex playernameindex;
+// players in the game, by room
+tRoomPlayersMap roomplayersmap;
 // map of all rooms
 tRoomMap roommap;
 // map of known commands (eg. look, quit, north etc.)
@@ -35,7 +44,20 @@ map<tConnectionStates, tHandler> statemap;
 map<string, string, ciLess> messagemap;
 // directions
 set<string, ciLess> directionset;
+// chat channels
+tChannelMap channelmap;
+// kinds of objects
+tObjectPrototypeMap objectprotomap;
+// all the mobiles
+tMobiles mobiles;
+tPlayerCache playercache (PLAYER_CACHE_SIZE);
+tPendingConnections pendingconnections;
+// threads for work done off the main thread (eg. room commands)
+tWorkerPool workerpool;
+tWorkerPool backgroundpool;
 // bad player names
 set<string, ciLess> badnameset;
-// blocked IP addresses
-set<string> blockedIP;
+// blocked IP address ranges
+tAddressTrie blockedIP;
+// connection and login rates, by address
+tThrottle throttle;
@@ -4,13 +4,28 @@
 
 #include "player.h"   // for player list
 #include "room.h"     // for rooms and exits
+#include "channel.h"  // for chat channels
+#include "workers.h"  // for worker threads
+#include "mobile.h"   // for mobiles
+#include "playercache.h"  // for player files
+#include "preauth.h"  // for connections before login
+#include "ipfilter.h" // for blocked addresses
+#include "editdistance.h"  // for player name suggestions
 
 // bad player names
 extern std::set<std::string, ciLess> badnameset;
-// blocked IP addresses
-extern std::set<std::string> blockedIP;
+// blocked IP address ranges
+extern tAddressTrie blockedIP;
+// connection and login rates, by address
+extern tThrottle throttle;
 // list of all connected players
 extern tPlayerList playerlist;   
+// players in the game, by name
+extern tPlayerNameMap playernamemap;
+// the same names, for "did you mean" suggestions
+extern tNameIndex playernameindex;
+// players in the game, by room
+extern tRoomPlayersMap roomplayersmap;
 // map of all rooms
 extern tRoomMap roommap;
 // map of known commands (eg. look, quit, north etc.)
@@ -21,8 +36,25 @@ extern std::map<tConnectionStates, tHandler> statemap;
 extern std::map<std::string, string, ciLess> messagemap;
 // directions
 extern std::set<std::string, ciLess> directionset;
+// chat channels
+extern tChannelMap channelmap;
+// kinds of objects
+extern tObjectPrototypeMap objectprotomap;
+// connections waiting for their name
+extern tPendingConnections pendingconnections;
+// recently used player files
+extern tPlayerCache playercache;
+// all the mobiles
+extern tMobiles mobiles;
+// threads for work done off the main thread (eg. room commands)
+extern tWorkerPool workerpool;
+// threads for slow work finished later on the main thread (eg. password hashing)
+extern tWorkerPool backgroundpool;
 
 // global variables
 extern bool   bStopNow;      // when set, the MUD shuts down
 extern time_t tLastMessage;      // time we last sent a periodic message 
+extern bool   bCopyover;     // with bStopNow, restart it instead (see copyover.h)
+extern bool   bSavePlayers;  // when clear, player files aren't written (eg. replaying)
+extern bool   bParallelInput;  // when clear, room commands aren't run in parallel (eg. to compare)
 extern int    iControl;  // socket for accepting new connections 
@@ -0,0 +1,174 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+using namespace std; 
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "globals.h"
+#include "inputqueue.h"
+#include "strings.h"
+
+/*
+
+ Commands are normally processed one at a time, in the order they arrived.
+ However some commands only affect the room the player is in (eg. say, look):
+ they only send to players in that room, and change nothing else. A run of
+ those commands can be split up by room, and each room's commands done on a 
+ different worker thread, with the same result as doing them one by one.
+ Anything else (eg. moving, tell, chat) waits until the run before it is done.
+
+*/
+
+// a line of input from a player
+struct tQueuedInput
+  {
+  tPlayer * player;
+  string line;
+  tQueuedInput (tPlayer * p, const string & s) : player (p), line (s) {}
+  };  // end of tQueuedInput
+
+typedef vector<tQueuedInput> tInputQueue;
+
+// input received so far this tick
+static tInputQueue inputqueue;
+
+// commands which only affect the player's room
+static set<string, ciLess> roomcommands;
+
+void QueuePlayerInput (tPlayer * p, const string & s)
+{
+  inputqueue.push_back (tQueuedInput (p, s));
+} // end of QueuePlayerInput
+
+// does this line of input only affect the player's room?
+static bool IsRoomCommand (const tQueuedInput & input)
+{
+  if (!input.player->IsPlaying ())
+    return false;
+    
+  if (roomcommands.empty ())
+    {
+    roomcommands.insert ("say");
+    roomcommands.insert ("\"");
+    roomcommands.insert ("emote");
+    roomcommands.insert ("look");
+    roomcommands.insert ("l");
+    }
+  
+  // every command on the line must be one of them (eg. say hi;look)
+  const string & line = input.line;
+  string::size_type start = 0;
+  while (start <= line.size ())
+    {
+    string::size_type end = line.find (COMMAND_SEPARATOR, start);
+    if (end == string::npos)
+      end = line.size ();
+      
+    // its first word (found in place - this is done for every line, every tick)
+    string::size_type first = min (line.find_first_not_of (SPACES, start), end);
+    string::size_type last = min (line.find_first_of (SPACES, first), end);
+    start = end + 1;
+    
+    const string command (line, first, last - first);
+    if (roomcommands.find (command) == roomcommands.end () ||
+        input.player->aliases.Find (command))   // an alias could do anything
+      return false;
+      
+    // the rest of the line is what they say (eg. say hi; how are you)
+    if (TakesRestOfLine (command))
+      break;
+    } // end of each command
+    
+  return true;
+} // end of IsRoomCommand
+
+// job for a worker thread - the commands for one room, in order
+class tRoomInputJob : public tJob
+  {
+  public:
+  vector<const tQueuedInput *, tArenaAllocator<const tQueuedInput *> > inputs;
+  
+  void Run () 
+    { 
+    for (vector<const tQueuedInput *, tArenaAllocator<const tQueuedInput *> >::const_iterator i = inputs.begin ();
+         i != inputs.end (); ++i)
+      ProcessPlayerInput ((*i)->player, (*i)->line);
+    }
+  };  // end of class tRoomInputJob
+
+// process a run of room commands, one job per room
+static void RunRoomCommands (tInputQueue::const_iterator first, 
+                             tInputQueue::const_iterator last)
+{
+  typedef map<int, tRoomInputJob, less<int>, tArenaAllocator<pair<const int, tRoomInputJob> > > tRoomJobs;
+  tRoomJobs roomjobs;
+  for (tInputQueue::const_iterator i = first; i != last; ++i)
+    roomjobs [i->player->room].inputs.push_back (&*i);
+    
+  // not worth the threads for just a few rooms
+  if (roomjobs.size () < PARALLEL_INPUT_ROOMS)
+    {
+    for (tInputQueue::const_iterator i = first; i != last; ++i)
+      ProcessPlayerInput (i->player, i->line);
+    return;
+    }
+    
+  vector<tJob*> jobs;
+  for (tRoomJobs::iterator i = roomjobs.begin (); i != roomjobs.end (); ++i)
+    jobs.push_back (&i->second);
+  workerpool.RunAll (jobs);
+} // end of RunRoomCommands
+
+void RunQueuedInput ()
+{
+  // commands might queue more input (eg. from a disconnect), so take what we have now
+  tInputQueue queue;
+  queue.swap (inputqueue);
+  
+  tInputQueue::const_iterator i = queue.begin ();
+  while (i != queue.end ())
+    {
+    // once they are leaving, ignore anything else they typed
+    if (i->player->closing)
+      {
+      ++i;
+      continue;
+      }
+      
+    if (!bParallelInput || !IsRoomCommand (*i))
+      {
+      ProcessPlayerInput (i->player, i->line);
+      ++i;
+      continue;
+      }
+      
+    // find the end of this run of room commands
+    tInputQueue::const_iterator last = i + 1;
+    while (last != queue.end () && !last->player->closing && IsRoomCommand (*last))
+      ++last;
+      
+    RunRoomCommands (i, last);
+    i = last;
+    } // end of processing queue
+    
+} // end of RunQueuedInput
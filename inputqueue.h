@@ -0,0 +1,12 @@
+#ifndef TINYMUDSERVER_INPUTQUEUE_H
+#define TINYMUDSERVER_INPUTQUEUE_H
+
+// inputqueue.h - player input collected during a tick and processed together
+
+// save a line of input to be processed at the end of this tick
+void QueuePlayerInput (tPlayer * p, const string & s);
+
+// process everything queued this tick, in the order it arrived
+void RunQueuedInput ();
+
+#endif // TINYMUDSERVER_INPUTQUEUE_H
@@ -0,0 +1,316 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <string.h>
+#include <stdlib.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std; 
+
+#include "constants.h"
+#include "gameclock.h"
+#include "ipfilter.h"
+
+tIPAddress IPv4Address (const struct in_addr & a)
+{
+  tIPAddress address;
+  memset (address.bytes, 0, 10);
+  address.bytes [10] = address.bytes [11] = 0xFF;
+  memcpy (&address.bytes [12], &a.s_addr, 4);   // already in network order
+  return address;
+} // end of IPv4Address
+
+bool ParseAddressRange (const string & text, tIPAddress & address, int & prefix)
+{
+  const string::size_type slash = text.find ('/');
+  const string host = text.substr (0, slash);
+  
+  struct in_addr a4;
+  struct in6_addr a6;
+  int most;   // longest prefix they can ask for
+  if (inet_pton (AF_INET, host.c_str (), &a4) == 1)
+    {
+    address = IPv4Address (a4);
+    most = 32;
+    }
+  else if (inet_pton (AF_INET6, host.c_str (), &a6) == 1)
+    {
+    memcpy (address.bytes, a6.s6_addr, sizeof address.bytes);
+    most = 128;
+    }
+  else
+    return false;
+    
+  prefix = most;
+  if (slash != string::npos)
+    {
+    const string bits = text.substr (slash + 1);
+    char * end;
+    prefix = strtol (bits.c_str (), &end, 10);
+    if (bits.empty () || *end || prefix < 0 || prefix > most)
+      return false;
+    }
+    
+  // IPv4 prefixes are after the 96 bits of ::ffff:
+  if (most == 32)
+    prefix += 96;
+  return true;
+} // end of ParseAddressRange
+
+// bit n of an address (0 is the top bit of the first byte)
+static inline int Bit (const tIPAddress & a, const int n)
+{
+  return (a.bytes [n >> 3] >> (7 - (n & 7))) & 1;
+} // end of Bit
+
+// do the first "bits" bits of a and b match?
+static inline bool PrefixMatches (const tIPAddress & a, const tIPAddress & b, const int bits)
+{
+  const int whole = bits >> 3;
+  if (memcmp (a.bytes, b.bytes, whole) != 0)
+    return false;
+  const int rest = bits & 7;
+  if (rest == 0)
+    return true;
+  const unsigned char mask = 0xFF << (8 - rest);
+  return ((a.bytes [whole] ^ b.bytes [whole]) & mask) == 0;
+} // end of PrefixMatches
+
+// how many leading bits a and b have in common, up to limit
+static int CommonBits (const tIPAddress & a, const tIPAddress & b, const int limit)
+{
+  for (int byte = 0; byte * 8 < limit; ++byte)
+    {
+    const unsigned char diff = a.bytes [byte] ^ b.bytes [byte];
+    if (diff)
+      return min (limit, byte * 8 + __builtin_clz (diff) - 24);
+    }
+  return limit;
+} // end of CommonBits
+
+// the address with everything after the prefix cleared
+static tIPAddress Masked (const tIPAddress & a, const int bits)
+{
+  tIPAddress result = a;
+  const int whole = bits >> 3;
+  if (whole < 16)
+    {
+    result.bytes [whole] &= (unsigned char) (0xFF << (8 - (bits & 7)));
+    memset (&result.bytes [whole + 1], 0, 15 - whole);
+    }
+  return result;
+} // end of Masked
+
+/*---------------------------------------------- */
+/*  tAddressTrie                                  */
+/*---------------------------------------------- */
+
+tAddressTrie::tNode::tNode (const tIPAddress & k, const int b, const bool m)
+  : key (Masked (k, b)), bits (b), member (m)
+{
+  child [0] = child [1] = NULL;
+} // end of tAddressTrie::tNode::tNode
+
+void tAddressTrie::Add (const tIPAddress & address, const int prefix)
+{
+  tNode ** link = &root;
+  while (true)
+    {
+    tNode * n = *link;
+    if (n == NULL)
+      {
+      *link = new tNode (address, prefix, true);
+      return;
+      }
+      
+    // where do they part company?
+    const int common = CommonBits (n->key, address, min (n->bits, prefix));
+    if (common < n->bits)
+      {
+      // a new branch point (or the new range itself) goes above this node
+      tNode * branch = new tNode (address, common, common == prefix);
+      branch->child [Bit (n->key, common)] = n;
+      if (common < prefix)
+        branch->child [Bit (address, common)] = new tNode (address, prefix, true);
+      *link = branch;
+      return;
+      }
+      
+    // this node's prefix covers the new one
+    if (n->bits == prefix)
+      {
+      n->member = true;
+      return;
+      }
+    link = &n->child [Bit (address, n->bits)];
+    } // end of walking down
+} // end of tAddressTrie::Add
+
+bool tAddressTrie::Contains (const tIPAddress & address) const
+{
+  for (const tNode * n = root; n && PrefixMatches (n->key, address, n->bits); )
+    {
+    if (n->member)
+      return true;  // the shortest range containing it is enough
+    n = n->child [Bit (address, n->bits)];   // a node that isn't a member always has bits < 128
+    }
+  return false;
+} // end of tAddressTrie::Contains
+
+/*---------------------------------------------- */
+/*  tThrottle                                     */
+/*---------------------------------------------- */
+
+static int64_t NowUsec ()
+{
+  struct timeval tv;
+  GetGameTime (tv);
+  return int64_t (tv.tv_sec) * 1000000 + tv.tv_usec;
+} // end of NowUsec
+
+// every bit of the input affects every bit of the output (MurmurHash3's finaliser)
+static inline uint64_t Mix (uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+} // end of Mix
+
+// (IPv4 addresses are all in the second half, and mostly differ in their last byte)
+static size_t Hash (const tIPAddress & a)
+{
+  uint64_t x, y;
+  memcpy (&x, &a.bytes [0], 8);
+  memcpy (&y, &a.bytes [8], 8);
+  return Mix (x ^ Mix (y));
+} // end of Hash
+
+// top the bucket up for the time since we last looked
+void tThrottle::Refill (tBucket & b, const double rate, const double burst, const int64_t now)
+{
+  if (now > b.last)
+    b.tokens = min (burst, b.tokens + (now - b.last) * rate / 1e6);
+  b.last = now;
+} // end of tThrottle::Refill
+
+// take a token if there is one
+bool tThrottle::Take (tBucket & b, const double rate, const double burst, const int64_t now)
+{
+  Refill (b, rate, burst, now);
+  if (b.tokens < 1)
+    return false;
+  b.tokens -= 1;
+  return true;
+} // end of tThrottle::Take
+
+tThrottle::tThrottle () : table (THROTTLE_TABLE_SIZE), count (0)
+{
+  // this machine (eg. load tests)
+  tIPAddress address;
+  int prefix;
+  if (ParseAddressRange ("127.0.0.0/8", address, prefix))
+    exempt.Add (address, prefix);
+  if (ParseAddressRange ("::1", address, prefix))
+    exempt.Add (address, prefix);
+} // end of tThrottle::tThrottle
+
+// forget addresses that have been quiet long enough to have full buckets again, and grow if we still need to
+void tThrottle::Grow (const int64_t now)
+{
+  vector<tEntry> old (table.size ());
+  old.swap (table);
+  
+  size_t active = 0;
+  for (vector<tEntry>::iterator i = old.begin (); i != old.end (); ++i)
+    if (i->used)
+      {
+      Refill (i->connects, CONNECT_RATE, CONNECT_BURST, now);
+      Refill (i->logins, LOGIN_RATE, LOGIN_BURST, now);
+      if (i->connects.tokens >= CONNECT_BURST && i->logins.tokens >= LOGIN_BURST)
+        i->used = false;    // same as if we had never seen them
+      else
+        ++active;
+      }
+      
+  // still more than a quarter full? twice the size, so we don't do this again soon
+  if (active * 4 > table.size ())
+    table.resize (table.size () * 2);
+    
+  count = 0;
+  for (vector<tEntry>::const_iterator i = old.begin (); i != old.end (); ++i)
+    if (i->used)
+      {
+      size_t slot = Hash (i->address) & (table.size () - 1);
+      while (table [slot].used)
+        slot = (slot + 1) & (table.size () - 1);
+      table [slot] = *i;
+      ++count;
+      }
+} // end of tThrottle::Grow
+
+tThrottle::tEntry & tThrottle::Find (const tIPAddress & address, const int64_t now)
+{
+  size_t slot = Hash (address) & (table.size () - 1);
+  while (table [slot].used)
+    {
+    if (table [slot].address == address)
+      return table [slot];
+    slot = (slot + 1) & (table.size () - 1);
+    }
+    
+  // someone new - keep the table no more than half full, so searches are short
+  if ((count + 1) * 2 > table.size ())
+    {
+    Grow (now);
+    return Find (address, now);
+    }
+    
+  tEntry & e = table [slot];
+  e.address = address;
+  e.used = true;
+  e.connects.tokens = CONNECT_BURST;
+  e.logins.tokens = LOGIN_BURST;
+  e.connects.last = e.logins.last = now;
+  ++count;
+  return e;
+} // end of tThrottle::Find
+
+bool tThrottle::AllowConnect (const tIPAddress & address)
+{
+  if (exempt.Contains (address))
+    return true;
+    
+  const int64_t now = NowUsec ();
+  return Take (Find (address, now).connects, CONNECT_RATE, CONNECT_BURST, now);
+} // end of tThrottle::AllowConnect
+
+bool tThrottle::AllowLogin (const tIPAddress & address)
+{
+  if (exempt.Contains (address))
+    return true;
+    
+  const int64_t now = NowUsec ();
+  return Take (Find (address, now).logins, LOGIN_RATE, LOGIN_BURST, now);
+} // end of tThrottle::AllowLogin
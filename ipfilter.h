@@ -0,0 +1,115 @@
+#ifndef TINYMUDSERVER_IPFILTER_H
+#define TINYMUDSERVER_IPFILTER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <netinet/in.h>
+
+/*---------------------------------------------- */
+/*  IP filtering - blocked ranges, and throttling */
+/*---------------------------------------------- */
+
+/*
+ Addresses are kept as 16 bytes, with IPv4 mapped into IPv6 (::ffff:a.b.c.d),
+ so one trie handles both and "10.0.0.0/8" is just a 104 bit prefix.
+
+ Blocked ranges (eg. 10.0.0.0/8 192.168.1.7 2001:db8::/32 in the control
+ file) go into a path-compressed binary trie: checking an address follows
+ at most one node per distinct branch point, not one per bit.
+
+ Throttling gives each address two token buckets, one for connecting and
+ one for logging in (sending a name), in an open-addressed hash table, so
+ someone opening thousands of connections is turned away at accept time
+ without costing more than a table lookup.
+*/
+
+// an IPv4 or IPv6 address
+struct tIPAddress
+  {
+  unsigned char bytes [16];
+  
+  bool operator== (const tIPAddress & rhs) const 
+    { return memcmp (bytes, rhs.bytes, sizeof bytes) == 0; }
+  };  // end of tIPAddress
+
+// from an accepted IPv4 connection
+tIPAddress IPv4Address (const struct in_addr & a);
+
+// parse "1.2.3.4", "1.2.3.0/24", "2001:db8::/32" - prefix is in bits, out of 128 - false if bad
+bool ParseAddressRange (const string & text, tIPAddress & address, int & prefix);
+
+/*---------------------------------------------- */
+/*  address ranges                                */
+/*---------------------------------------------- */
+
+class tAddressTrie
+  {
+  struct tNode
+    {
+    tIPAddress key;     // the prefix, with the bits after it zero
+    int bits;           // how long it is
+    bool member;        // true if the prefix itself was added (not just a branch point)
+    tNode * child [2];  // by the next bit
+    
+    tNode (const tIPAddress & k, const int b, const bool m);
+    ~tNode () { delete child [0]; delete child [1]; }
+    };  // end of tNode
+    
+  tNode * root;
+  
+  // no copying
+  tAddressTrie (const tAddressTrie &);
+  tAddressTrie & operator= (const tAddressTrie &);
+  
+  public:
+  
+  tAddressTrie () : root (NULL) {}
+  ~tAddressTrie () { delete root; }
+  
+  void Add (const tIPAddress & address, const int prefix);
+  bool Contains (const tIPAddress & address) const;   // in any range we have?
+  void Clear () { delete root; root = NULL; }
+  bool Empty () const { return root == NULL; }
+  };  // end of class tAddressTrie
+
+/*---------------------------------------------- */
+/*  throttling                                    */
+/*---------------------------------------------- */
+
+class tThrottle
+  {
+  // tokens build up at a steady rate, to a limit, and each connection takes one
+  struct tBucket
+    {
+    double tokens;
+    int64_t last;     // when tokens was worked out (usec)
+    };  // end of tBucket
+    
+  struct tEntry
+    {
+    tIPAddress address;
+    bool used;
+    tBucket connects;
+    tBucket logins;
+    };  // end of tEntry
+    
+  std::vector<tEntry> table;  // a power of 2 in size, never more than half full
+  size_t count;               // entries used
+  tAddressTrie exempt;        // never throttled (eg. this machine)
+  
+  static void Refill (tBucket & b, const double rate, const double burst, const int64_t now);
+  static bool Take (tBucket & b, const double rate, const double burst, const int64_t now);
+  tEntry & Find (const tIPAddress & address, const int64_t now);
+  void Grow (const int64_t now);
+  
+  public:
+  
+  tThrottle ();
+  
+  // take a token - false if they have run out
+  bool AllowConnect (const tIPAddress & address);
+  bool AllowLogin (const tIPAddress & address);
+  };  // end of class tThrottle
+
+#endif // TINYMUDSERVER_IPFILTER_H
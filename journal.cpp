@@ -0,0 +1,365 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "globals.h"
+#include "broadcast.h"
+#include "inputqueue.h"
+#include "journal.h"
+#include "gameclock.h"
+#include "arena.h"
+
+void PeriodicUpdates ();
+void RemoveInactivePlayers ();
+void CloseComms ();
+
+static const char JOURNAL_MAGIC [] = "TMJ1";
+
+// recording
+static FILE * journal = NULL;           // where we are recording to
+static int64_t lastRecorded = 0;        // time of the last record (usec)
+static unsigned long lastConnection = 0;  // connection numbers given out so far
+
+// one record from the journal
+struct tJournalEntry
+  {
+  int64_t time;               // usec since the epoch
+  tJournalEvent event;
+  unsigned long connection;
+  string data;
+  };  // end of tJournalEntry
+
+static int64_t journalStart = 0;        // when recording started (usec)
+static vector<tJournalEntry> entries;   // the whole journal, when replaying
+
+// output hash for each connection (FNV-1a), so the order players are written to doesn't matter
+static map<unsigned long, uint64_t> outputhashes;
+static uint64_t outputBytes = 0;
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME  = 1099511628211ULL;
+
+static int64_t Microseconds (const struct timeval & tv)
+{
+  return int64_t (tv.tv_sec) * 1000000 + tv.tv_usec;
+} // end of Microseconds
+
+static int64_t RealTime ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return Microseconds (tv);
+} // end of RealTime
+
+/* ---------------- recording ---------------- */
+
+static void PutVarint (uint64_t n)
+{
+  while (n >= 0x80)
+    {
+    putc (int (n & 0x7F) | 0x80, journal);
+    n >>= 7;
+    }
+  putc (int (n), journal);
+} // end of PutVarint
+
+static void PutRecord (const tJournalEvent event, const unsigned long connection,
+                       const string & data = "")
+{
+  if (journal == NULL)
+    return;
+
+  const int64_t now = RealTime ();
+  PutVarint (now > lastRecorded ? now - lastRecorded : 0);  // the clock might go backwards
+  lastRecorded = max (now, lastRecorded);
+  putc (event, journal);
+  PutVarint (connection);
+  if (event != eJournalDisconnect)
+    {
+    PutVarint (data.size ());
+    fwrite (data.data (), 1, data.size (), journal);
+    }
+} // end of PutRecord
+
+bool StartRecording (const string & filename)
+{
+  journal = fopen (filename.c_str (), "wb");
+  if (journal == NULL)
+    {
+    perror (filename.c_str ());
+    return false;
+    }
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  lastRecorded = Microseconds (tv);
+
+  fwrite (JOURNAL_MAGIC, 1, sizeof JOURNAL_MAGIC - 1, journal);
+  PutVarint (tv.tv_sec);
+  PutVarint (tv.tv_usec);
+  return true;
+} // end of StartRecording
+
+void StopRecording ()
+{
+  if (journal == NULL)
+    return;
+  if (fclose (journal) != 0)
+    perror ("journal");
+  journal = NULL;
+} // end of StopRecording
+
+bool Recording ()
+{
+  return journal != NULL;
+} // end of Recording
+
+void FlushJournal ()
+{
+  if (journal != NULL)
+    fflush (journal);
+} // end of FlushJournal
+
+void JournalConnect (tPlayer * p)
+{
+  if (journal == NULL)
+    return;
+  p->journalId = ++lastConnection;
+  PutRecord (eJournalConnect, p->journalId, p->GetAddress ());
+} // end of JournalConnect
+
+void JournalLine (const tPlayer * p, const string & line)
+{
+  if (p->journalId)
+    PutRecord (eJournalLine, p->journalId, line);
+} // end of JournalLine
+
+void JournalDisconnect (const tPlayer * p)
+{
+  if (p->journalId)
+    PutRecord (eJournalDisconnect, p->journalId);
+} // end of JournalDisconnect
+
+/* ---------------- replaying ---------------- */
+
+static bool GetVarint (FILE * f, uint64_t & n)
+{
+  n = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+    {
+    const int c = getc (f);
+    if (c == EOF)
+      return false;
+    n |= uint64_t (c & 0x7F) << shift;
+    if ((c & 0x80) == 0)
+      return true;
+    }
+  return false;   // too long - not a journal
+} // end of GetVarint
+
+bool LoadJournal (const string & filename)
+{
+  FILE * f = fopen (filename.c_str (), "rb");
+  if (f == NULL)
+    {
+    perror (filename.c_str ());
+    return false;
+    }
+
+  char magic [sizeof JOURNAL_MAGIC - 1];
+  uint64_t sec, usec;
+  if (fread (magic, 1, sizeof magic, f) != sizeof magic ||
+      string (magic, sizeof magic) != JOURNAL_MAGIC ||
+      !GetVarint (f, sec) || !GetVarint (f, usec))
+    {
+    cerr << filename << " is not a journal" << endl;
+    fclose (f);
+    return false;
+    }
+
+  journalStart = int64_t (sec) * 1000000 + usec;
+  int64_t now = journalStart;
+
+  // read to the end - a journal cut short by a crash is still good up to there
+  uint64_t delta, connection, length;
+  while (GetVarint (f, delta))
+    {
+    const int event = getc (f);
+    if (event < eJournalConnect || event > eJournalDisconnect || !GetVarint (f, connection))
+      break;
+
+    tJournalEntry entry;
+    now += delta;
+    entry.time = now;
+    entry.event = tJournalEvent (event);
+    entry.connection = connection;
+    if (event != eJournalDisconnect)
+      {
+      if (!GetVarint (f, length) || length > 1000000)
+        break;
+      entry.data.resize (length);
+      if (length && fread (&entry.data [0], 1, length, f) != length)
+        break;
+      }
+    entries.push_back (entry);
+    } // end of reading records
+
+  fclose (f);
+
+  cout << "Loaded " << entries.size () << " journal entries from " << filename << endl;
+
+  // from now on the game's clock is the journal's, and the player files stay as they are
+  SetGameTime (journalStart);
+  bSavePlayers = false;
+  return true;
+} // end of LoadJournal
+
+// a replayed connection - what they are sent is added to their hash
+class tReplayConnection : public tConnection
+  {
+  uint64_t & hash;
+
+  public:
+  tReplayConnection (const unsigned long connection)
+    : hash (outputhashes.insert (make_pair (connection, FNV_OFFSET)).first->second) {}
+  int Read (char * buf, const int size) { errno = EWOULDBLOCK; return -1; }
+  int Write (const char * buf, const int size)
+    {
+    for (int i = 0; i < size; ++i)
+      hash = (hash ^ (unsigned char) buf [i]) * FNV_PRIME;
+    outputBytes += size;
+    return size;
+    }
+  };  // end of class tReplayConnection
+
+// do what the socket would have told us
+static void ReplayEntry (const tJournalEntry & entry, map<unsigned long, tPlayer*> & connections)
+{
+  if (entry.event == eJournalConnect)
+    {
+    tPlayer * p = new tPlayer (new tReplayConnection (entry.connection), 0, entry.data);
+    p->journalId = entry.connection;
+    playerlist.push_back (p);
+    StartLoginTimer (p);
+    *p << Greeting ();
+    connections [entry.connection] = p;
+    return;
+    }
+
+  // they might have gone already (eg. they quit)
+  map<unsigned long, tPlayer*>::iterator i = connections.find (entry.connection);
+  if (i == connections.end ())
+    return;
+
+  if (entry.event == eJournalLine)
+    i->second->AddInput (entry.data + "\n");
+  else
+    i->second->LostConnection ();
+} // end of ReplayEntry
+
+int Replay (const bool fast)
+{
+  map<unsigned long, tPlayer*> connections;   // players by connection number
+  vector<tJournalEntry>::const_iterator next = entries.begin ();
+  const int64_t realStart = RealTime ();
+  const int64_t tick = COMMS_WAIT_SEC * 1000000 + COMMS_WAIT_USEC;
+  int64_t now = journalStart;               // the game's clock
+  bool finishing = false;
+
+  // the same as MainLoop, except that the journal takes the place of poll
+  while (!bStopNow)
+    {
+    PeriodicUpdates ();
+    CheckLoginDeadlines ();
+
+    // forget players who are about to be deleted
+    for (map<unsigned long, tPlayer*>::iterator i = connections.begin (); i != connections.end (); )
+      if (!i->second->Connected () || i->second->closing)
+        connections.erase (i++);
+      else
+        ++i;
+    RemoveInactivePlayers ();
+
+    // once it has all happened, go around once more for background work to finish
+    if (next == entries.end ())
+      {
+      if (finishing)
+        break;
+      finishing = true;
+      }
+
+    // wait for the next thing to happen, or the poll timeout
+    int64_t wake = now + tick;
+    if (next != entries.end () && next->time < wake)
+      wake = max (next->time, now);
+    if (!fast)
+      {
+      const int64_t delay = (wake - journalStart) - (RealTime () - realStart);
+      if (delay > 0)
+        usleep (delay);
+      }
+    now = wake;
+    SetGameTime (now);
+
+    backgroundpool.FinishJobs ();
+    for ( ; next != entries.end () && next->time <= now; ++next)
+      ReplayEntry (*next, connections);
+
+    RunQueuedInput ();
+    FlushRoomEvents ();
+
+    // "send" their output
+    for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); ++i)
+      (*i)->ProcessWrite ();
+      
+    ResetArenas ();
+    } // end of replay loop
+
+  // as at the end of main
+  SendToAll ("\n\n** Game shut down. **\n\n");
+  CloseComms ();
+
+  const double elapsed = (RealTime () - realStart) / 1e6;
+
+  // combine the connections' hashes, in connection order
+  uint64_t hash = FNV_OFFSET;
+  for (map<unsigned long, uint64_t>::const_iterator i = outputhashes.begin ();
+       i != outputhashes.end (); ++i)
+    for (int shift = 0; shift < 64; shift += 8)
+      hash = (hash ^ ((i->second >> shift) & 0xFF)) * FNV_PRIME;
+
+  cout << "Replayed " << (next - entries.begin ()) << " journal entries in "
+       << fixed << setprecision (3) << elapsed << " seconds" << endl;
+  cout << "Output: " << outputhashes.size () << " connection(s), " << outputBytes
+       << " bytes, hash " << hex << setw (16) << setfill ('0') << hash << dec << endl;
+  return 0;
+} // end of Replay
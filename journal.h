@@ -0,0 +1,54 @@
+#ifndef TINYMUDSERVER_JOURNAL_H
+#define TINYMUDSERVER_JOURNAL_H
+
+class tPlayer;
+
+/*---------------------------------------------- */
+/*  session journal - record and replay input     */
+/*---------------------------------------------- */
+
+/*
+ When recording (./tinymudserver --record <file>) every line a player sends
+ is written to a journal, with the time it arrived and which connection it
+ came on. The journal can then be replayed (./tinymudserver --replay <file>)
+ without any sockets: the lines go through the same ProcessPlayerInput path,
+ and the output is hashed instead of sent.
+
+ While replaying, the game's clock (see gameclock.h) follows the journal
+ rather than the real time, and background jobs run in the order they were
+ submitted, so replaying the same journal against the same player files
+ gives the same hash every time - with or without --fast, which doesn't wait
+ between events. Player files are not written while replaying.
+
+ The journal has passwords in it, so treat it like the player files.
+
+ Format: "TMJ1", then the start time (seconds, microseconds), then records of
+  <microseconds since the last record> <event> <connection> [<length> <data>]
+ with the numbers as varints (7 bits a byte, low bits first).
+*/
+
+// what happened on a connection
+typedef enum
+  {
+  eJournalConnect,      // data is their address
+  eJournalLine,         // data is a line of input (no newline)
+  eJournalDisconnect    // they closed the connection
+  } tJournalEvent;
+
+// start recording - false if the file can't be created
+bool StartRecording (const string & filename);
+void StopRecording ();
+void FlushJournal ();   // once a tick, so a crash loses little
+bool Recording ();
+
+// things to record (nothing happens unless we are recording)
+void JournalConnect (tPlayer * p);    // gives them their connection number
+void JournalLine (const tPlayer * p, const string & line);
+void JournalDisconnect (const tPlayer * p);
+
+// read a journal, and set the game's clock to when it started - false if it can't be read
+bool LoadJournal (const string & filename);
+// play it through the game, at the original speed or as fast as possible - returns exit code
+int Replay (const bool fast);
+
+#endif // TINYMUDSERVER_JOURNAL_H
@@ -0,0 +1,330 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std; 
+
+#include "constants.h"
+#include "kdf.h"
+
+static const string HASH_PREFIX = "$scrypt$";   // start of a hashed password
+static const unsigned int SALT_LENGTH = 16;     // bytes of random salt
+static const unsigned int HASH_LENGTH = 32;     // bytes of scrypt output
+
+/*---------------------------------------------- */
+/*  SHA-256 (FIPS 180-4)                          */
+/*---------------------------------------------- */
+
+static const uint32_t K [64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+static inline uint32_t ror (const uint32_t x, const int n) { return (x >> n) | (x << (32 - n)); }
+static inline uint32_t rol (const uint32_t x, const int n) { return (x << n) | (x >> (32 - n)); }
+
+// mix one 64-byte block into the hash state
+static void SHA256Block (uint32_t h [8], const unsigned char * block)
+{
+  uint32_t w [64];
+  for (int i = 0; i < 16; ++i)
+    w [i] = (uint32_t (block [i * 4]) << 24) | (uint32_t (block [i * 4 + 1]) << 16) |
+            (uint32_t (block [i * 4 + 2]) << 8) | uint32_t (block [i * 4 + 3]);
+  for (int i = 16; i < 64; ++i)
+    {
+    const uint32_t s0 = ror (w [i - 15], 7) ^ ror (w [i - 15], 18) ^ (w [i - 15] >> 3);
+    const uint32_t s1 = ror (w [i - 2], 17) ^ ror (w [i - 2], 19) ^ (w [i - 2] >> 10);
+    w [i] = w [i - 16] + s0 + w [i - 7] + s1;
+    }
+    
+  uint32_t a = h [0], b = h [1], c = h [2], d = h [3], e = h [4], f = h [5], g = h [6], k = h [7];
+  for (int i = 0; i < 64; ++i)
+    {
+    const uint32_t t1 = k + (ror (e, 6) ^ ror (e, 11) ^ ror (e, 25)) + ((e & f) ^ (~e & g)) + K [i] + w [i];
+    const uint32_t t2 = (ror (a, 2) ^ ror (a, 13) ^ ror (a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    k = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+    }
+    
+  h [0] += a; h [1] += b; h [2] += c; h [3] += d;
+  h [4] += e; h [5] += f; h [6] += g; h [7] += k;
+} // end of SHA256Block
+
+string SHA256 (const string & data)
+{
+  uint32_t h [8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  
+  // whole blocks first
+  const unsigned char * p = reinterpret_cast<const unsigned char *> (data.data ());
+  const size_t whole = data.size () & ~size_t (63);
+  for (size_t i = 0; i < whole; i += 64)
+    SHA256Block (h, p + i);
+    
+  // then the rest, padded with 0x80, zeroes and the length in bits
+  unsigned char tail [128];
+  memset (tail, 0, sizeof tail);
+  const size_t left = data.size () - whole;
+  memcpy (tail, p + whole, left);
+  tail [left] = 0x80;
+  const size_t tailLength = left < 56 ? 64 : 128;
+  const uint64_t bits = uint64_t (data.size ()) * 8;
+  for (int i = 0; i < 8; ++i)
+    tail [tailLength - 1 - i] = (unsigned char) (bits >> (i * 8));
+  for (size_t i = 0; i < tailLength; i += 64)
+    SHA256Block (h, tail + i);
+    
+  string result (32, 0);
+  for (int i = 0; i < 8; ++i)
+    for (int j = 0; j < 4; ++j)
+      result [i * 4 + j] = (char) (h [i] >> (24 - j * 8));
+  return result;
+} // end of SHA256
+
+/*---------------------------------------------- */
+/*  HMAC and PBKDF2                               */
+/*---------------------------------------------- */
+
+static string HMAC_SHA256 (const string & key, const string & message)
+{
+  string k = key.size () > 64 ? SHA256 (key) : key;
+  k.resize (64, 0);
+  
+  string inner (k), outer (k);
+  for (int i = 0; i < 64; ++i)
+    {
+    inner [i] ^= 0x36;
+    outer [i] ^= 0x5c;
+    }
+  return SHA256 (outer + SHA256 (inner + message));
+} // end of HMAC_SHA256
+
+string PBKDF2_SHA256 (const string & password, const string & salt,
+                      const unsigned int iterations, const unsigned int length)
+{
+  string result;
+  for (uint32_t block = 1; result.size () < length; ++block)
+    {
+    string count (4, 0);
+    for (int i = 0; i < 4; ++i)
+      count [i] = (char) (block >> (24 - i * 8));
+      
+    string u = HMAC_SHA256 (password, salt + count);
+    string t = u;
+    for (unsigned int i = 1; i < iterations; ++i)
+      {
+      u = HMAC_SHA256 (password, u);
+      for (size_t j = 0; j < t.size (); ++j)
+        t [j] ^= u [j];
+      }
+    result += t;
+    }
+  result.resize (length);
+  return result;
+} // end of PBKDF2_SHA256
+
+/*---------------------------------------------- */
+/*  scrypt (RFC 7914)                             */
+/*---------------------------------------------- */
+
+// Salsa20/8 core, in place on 16 words
+static void Salsa20_8 (uint32_t b [16])
+{
+  uint32_t x [16];
+  memcpy (x, b, sizeof x);
+  for (int i = 0; i < 8; i += 2)
+    {
+    // columns
+    x [ 4] ^= rol (x [ 0] + x [12],  7);  x [ 8] ^= rol (x [ 4] + x [ 0],  9);
+    x [12] ^= rol (x [ 8] + x [ 4], 13);  x [ 0] ^= rol (x [12] + x [ 8], 18);
+    x [ 9] ^= rol (x [ 5] + x [ 1],  7);  x [13] ^= rol (x [ 9] + x [ 5],  9);
+    x [ 1] ^= rol (x [13] + x [ 9], 13);  x [ 5] ^= rol (x [ 1] + x [13], 18);
+    x [14] ^= rol (x [10] + x [ 6],  7);  x [ 2] ^= rol (x [14] + x [10],  9);
+    x [ 6] ^= rol (x [ 2] + x [14], 13);  x [10] ^= rol (x [ 6] + x [ 2], 18);
+    x [ 3] ^= rol (x [15] + x [11],  7);  x [ 7] ^= rol (x [ 3] + x [15],  9);
+    x [11] ^= rol (x [ 7] + x [ 3], 13);  x [15] ^= rol (x [11] + x [ 7], 18);
+    // rows
+    x [ 1] ^= rol (x [ 0] + x [ 3],  7);  x [ 2] ^= rol (x [ 1] + x [ 0],  9);
+    x [ 3] ^= rol (x [ 2] + x [ 1], 13);  x [ 0] ^= rol (x [ 3] + x [ 2], 18);
+    x [ 6] ^= rol (x [ 5] + x [ 4],  7);  x [ 7] ^= rol (x [ 6] + x [ 5],  9);
+    x [ 4] ^= rol (x [ 7] + x [ 6], 13);  x [ 5] ^= rol (x [ 4] + x [ 7], 18);
+    x [11] ^= rol (x [10] + x [ 9],  7);  x [ 8] ^= rol (x [11] + x [10],  9);
+    x [ 9] ^= rol (x [ 8] + x [11], 13);  x [10] ^= rol (x [ 9] + x [ 8], 18);
+    x [12] ^= rol (x [15] + x [14],  7);  x [13] ^= rol (x [12] + x [15],  9);
+    x [14] ^= rol (x [13] + x [12], 13);  x [15] ^= rol (x [14] + x [13], 18);
+    }
+  for (int i = 0; i < 16; ++i)
+    b [i] += x [i];
+} // end of Salsa20_8
+
+// BlockMix: b is 2 * r blocks of 16 words, y is scratch the same size
+static void BlockMix (uint32_t * b, uint32_t * y, const unsigned int r)
+{
+  uint32_t x [16];
+  memcpy (x, &b [(2 * r - 1) * 16], sizeof x);
+  
+  for (unsigned int i = 0; i < 2 * r; ++i)
+    {
+    for (int j = 0; j < 16; ++j)
+      x [j] ^= b [i * 16 + j];
+    Salsa20_8 (x);
+    // even blocks go to the first half, odd ones to the second
+    memcpy (&y [((i & 1) * r + i / 2) * 16], x, sizeof x);
+    }
+    
+  memcpy (b, y, 2 * r * 16 * sizeof (uint32_t));
+} // end of BlockMix
+
+// ROMix: mix one 128 * r byte block, using N of them as scratch memory
+static void ROMix (unsigned char * block, const unsigned int r, const uint32_t n)
+{
+  const size_t words = 32 * r;
+  vector<uint32_t> x (words), y (words), v (words * n);
+  
+  for (size_t i = 0; i < words; ++i)
+    x [i] = uint32_t (block [i * 4]) | (uint32_t (block [i * 4 + 1]) << 8) |
+            (uint32_t (block [i * 4 + 2]) << 16) | (uint32_t (block [i * 4 + 3]) << 24);
+  
+  // fill the scratch memory ...
+  for (uint32_t i = 0; i < n; ++i)
+    {
+    memcpy (&v [i * words], &x [0], words * sizeof (uint32_t));
+    BlockMix (&x [0], &y [0], r);
+    }
+    
+  // ... then read it back in an order that depends on the data
+  for (uint32_t i = 0; i < n; ++i)
+    {
+    const uint32_t j = x [words - 16] & (n - 1);
+    for (size_t k = 0; k < words; ++k)
+      x [k] ^= v [j * words + k];
+    BlockMix (&x [0], &y [0], r);
+    }
+    
+  for (size_t i = 0; i < words; ++i)
+    for (int j = 0; j < 4; ++j)
+      block [i * 4 + j] = (unsigned char) (x [i] >> (j * 8));
+} // end of ROMix
+
+string Scrypt (const string & password, const string & salt,
+               const unsigned int log2N, const unsigned int r, const unsigned int p,
+               const unsigned int length)
+{
+  if (log2N < 1 || log2N > 20 || r < 1 || r > 32 || p < 1 || p > 16)
+    throw runtime_error ("Bad scrypt parameters.");
+    
+  const size_t blockSize = 128 * r;
+  string b = PBKDF2_SHA256 (password, salt, 1, p * blockSize);
+  for (unsigned int i = 0; i < p; ++i)
+    ROMix (reinterpret_cast<unsigned char *> (&b [i * blockSize]), r, uint32_t (1) << log2N);
+  return PBKDF2_SHA256 (password, b, 1, length);
+} // end of Scrypt
+
+/*---------------------------------------------- */
+/*  saved passwords                               */
+/*---------------------------------------------- */
+
+static string ToHex (const string & s)
+{
+  static const char digits [] = "0123456789abcdef";
+  string result;
+  for (string::const_iterator i = s.begin (); i != s.end (); ++i)
+    {
+    result += digits [(unsigned char) *i >> 4];
+    result += digits [(unsigned char) *i & 0xF];
+    }
+  return result;
+} // end of ToHex
+
+static string FromHex (const string & s)
+{
+  if (s.size () % 2 || s.find_first_not_of ("0123456789abcdef") != string::npos)
+    throw runtime_error ("Bad hex string.");
+  string result;
+  for (size_t i = 0; i < s.size (); i += 2)
+    result += (char) strtol (s.substr (i, 2).c_str (), NULL, 16);
+  return result;
+} // end of FromHex
+
+// compare in constant time, so the time taken doesn't say how much matched
+static bool SameBytes (const string & a, const string & b)
+{
+  if (a.size () != b.size ())
+    return false;
+  unsigned char diff = 0;
+  for (size_t i = 0; i < a.size (); ++i)
+    diff |= a [i] ^ b [i];
+  return diff == 0;
+} // end of SameBytes
+
+bool IsHashedPassword (const string & saved)
+{
+  return saved.compare (0, HASH_PREFIX.size (), HASH_PREFIX) == 0;
+} // end of IsHashedPassword
+
+string HashPassword (const string & password)
+{
+  ifstream f ("/dev/urandom", ios::in | ios::binary);
+  string salt (SALT_LENGTH, 0);
+  if (!f.read (&salt [0], SALT_LENGTH))
+    throw runtime_error ("Cannot get random numbers for password salt.");
+    
+  ostringstream os;
+  os << HASH_PREFIX << SCRYPT_LOG2_N << "$" << SCRYPT_R << "$" << SCRYPT_P << "$" 
+     << ToHex (salt) << "$" 
+     << ToHex (Scrypt (password, salt, SCRYPT_LOG2_N, SCRYPT_R, SCRYPT_P, HASH_LENGTH));
+  return os.str ();
+} // end of HashPassword
+
+bool VerifyPassword (const string & password, const string & saved)
+{
+  if (!IsHashedPassword (saved))
+    return SameBytes (password, saved);   // older player file
+    
+  // $scrypt$<log2 N>$<r>$<p>$<salt>$<hash>
+  istringstream is (saved.substr (HASH_PREFIX.size ()));
+  unsigned int log2N = 0, r = 0, p = 0;
+  char d1 = 0, d2 = 0, d3 = 0;
+  string salt, hash;
+  is >> log2N >> d1 >> r >> d2 >> p >> d3;
+  getline (is, salt, '$');
+  getline (is, hash);
+  if (!is || d1 != '$' || d2 != '$' || d3 != '$' || hash.empty ())
+    return false;   // damaged - nothing will match it
+    
+  try
+    {
+    const string expected = FromHex (hash);
+    return SameBytes (Scrypt (password, FromHex (salt), log2N, r, p, expected.size ()), expected);
+    }
+  catch (runtime_error &)
+    {
+    return false;
+    }
+} // end of VerifyPassword
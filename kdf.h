@@ -0,0 +1,41 @@
+#ifndef TINYMUDSERVER_KDF_H
+#define TINYMUDSERVER_KDF_H
+
+#include <string>
+#include <stdint.h>
+
+/*---------------------------------------------- */
+/*  password hashing (SHA-256, PBKDF2, scrypt)    */
+/*---------------------------------------------- */
+
+/*
+ scrypt deliberately uses a lot of memory and time (see SCRYPT_LOG2_N),
+ so stolen player files can't be cracked quickly. That also means hashing
+ a password takes tens of milliseconds - call these from a worker thread.
+ They don't touch any shared state.
+
+ A hashed password is stored as: $scrypt$<log2 N>$<r>$<p>$<salt>$<hash>
+*/
+
+// SHA-256 of some bytes, 32 bytes of result
+std::string SHA256 (const std::string & data);
+
+// PBKDF2 with HMAC-SHA-256, length bytes of result
+std::string PBKDF2_SHA256 (const std::string & password, const std::string & salt,
+                           const unsigned int iterations, const unsigned int length);
+
+// scrypt (RFC 7914), length bytes of result
+std::string Scrypt (const std::string & password, const std::string & salt,
+                    const unsigned int log2N, const unsigned int r, const unsigned int p,
+                    const unsigned int length);
+
+// hash a password with a new random salt, ready to save
+std::string HashPassword (const std::string & password);
+
+// true if the password matches what was saved (hashed, or plain text from older player files)
+bool VerifyPassword (const std::string & password, const std::string & saved);
+
+// true if saved in the hashed format (older player files have plain text)
+bool IsHashedPassword (const std::string & saved);
+
+#endif // TINYMUDSERVER_KDF_H
@@ -15,16 +15,21 @@ warranty, and with no claim as to its suitability for any purpose.
 // standard library includes ...
 
 #include <limits>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 using namespace std;
 
 #include "utils.h"
 #include "globals.h"
+#include "trigger.h"
+#include "gameclock.h"
 
 void LoadCommands (); // in commands.cpp
 void LoadStates (); // in states.cpp
+void LoadTriggerHandlers (); // in trigger.cpp
 
 // load things from the control file (directions, prohibited names, blocked addresses)
 void LoadControlFile ()
@@ -39,7 +44,27 @@ void LoadControlFile ()
 
   LoadSet (fControl, directionset); // possible directions, eg. n, s, e, w
   LoadSet (fControl, badnameset);   // bad names for new players, eg. new, quit, look, admin
-  LoadSet (fControl, blockedIP);    // blocked IP addresses
+  
+  // blocked IP addresses, or ranges (eg. 10.0.0.0/8)
+  set<string> blocked;
+  LoadSet (fControl, blocked);
+  blockedIP.Clear ();
+  for (set<string>::const_iterator i = blocked.begin (); i != blocked.end (); ++i)
+    {
+    tIPAddress address;
+    int prefix;
+    if (ParseAddressRange (*i, address, prefix))
+      blockedIP.Add (address, prefix);
+    else if (!i->empty ())
+      cerr << "Bad blocked address in control file: " << *i << endl;
+    }
+  
+  set<string, ciLess> channelnames;
+  LoadSet (fControl, channelnames); // chat channels, eg. newbie, trade
+  for (set<string, ciLess>::const_iterator i = channelnames.begin (); 
+       i != channelnames.end (); ++i)
+    if (!i->empty ())
+      channelmap [*i] = new tChannel (*i);
 } // end of LoadControlFile
 
 // load messages stored on messages file
@@ -136,23 +161,215 @@ void LoadRooms ()
       if (dir.empty () || dir_vnum == 0)
         break;
 
-      room->exits [dir] = dir_vnum;   // add exit
+      room->AddExit (dir, dir_vnum);   // add exit
 
       } // end of getting each direction
     } // end of read loop
 
 } // end of LoadRooms
 
+// load mobiles
+void LoadMobiles ()
+{
+  // load mobiles file
+  ifstream fMobiles (MOBILES_FILE, ios::in);
+  if (!fMobiles)
+    {
+    cerr << "Could not open mobiles file: " << MOBILES_FILE << endl;
+    return;
+    }
+
+  // format is: <home vnum> <how many> <hit points> [ <flags> ]
+  //            <name>
+  //  eg. 1003 2 10 wander
+  //      a large rat
+  while (!(fMobiles.eof ()))
+    {
+    tMobilePrototype prototype;
+    int count = 0, hp = 0;
+    prototype.home = 0;
+    prototype.flags = 0;
+    
+    fMobiles >> prototype.home >> count >> hp;
+    string sFlags;
+    getline (fMobiles, sFlags);
+    getline (fMobiles, prototype.name);
+    prototype.name = Trim (prototype.name);
+    prototype.maxhp = hp;
+
+    // give up if no room or name
+    if (prototype.home == 0 || prototype.name.empty ())
+      break;
+      
+    if (roommap.find (prototype.home) == roommap.end ())
+      {
+      cerr << "Mobile " << prototype.name << " has home room " << prototype.home
+           << " which does not exist" << endl;
+      continue;
+      }
+      
+    istringstream is (sFlags);
+    string flag;
+    while (is >> flag)
+      {
+      if (ciStringEqual (flag, "wander"))
+        prototype.flags |= MOB_WANDER;
+      else if (ciStringEqual (flag, "aggressive"))
+        prototype.flags |= MOB_AGGRESSIVE;
+      else
+        cerr << "Unknown flag " << flag << " for mobile " << prototype.name << endl;
+      }
+      
+    mobiles.prototypes.push_back (prototype);
+    for (int i = 0; i < count; ++i)
+      mobiles.Create (mobiles.prototypes.size () - 1);
+    } // end of read loop
+
+} // end of LoadMobiles
+
+// load object prototypes, and put objects in rooms
+void LoadObjectsFile ()
+{
+  // load objects file
+  ifstream fObjects (OBJECTS_FILE, ios::in);
+  if (!fObjects)
+    {
+    cerr << "Could not open objects file: " << OBJECTS_FILE << endl;
+    return;
+    }
+
+  // format is: <vnum> <room> <how many> [ <flags> ]
+  //            <name>
+  //            <description>
+  //  eg. 1 1000 1 container
+  //      a leather bag
+  //      It is a small bag, with a drawstring.
+  while (!(fObjects.eof ()))
+    {
+    int vnum = 0, room = 0, count = 0;
+    string sFlags, name, description;
+    
+    fObjects >> vnum >> room >> count;
+    getline (fObjects, sFlags);
+    getline (fObjects, name);
+    getline (fObjects, description);
+    name = Trim (name);
+
+    // give up if no vnum or name
+    if (vnum == 0 || name.empty ())
+      break;
+      
+    // don't have duplicate objects
+    if (objectprotomap [vnum] != 0)
+      {
+      cerr << "Object " << vnum << " appears more than once in objects file" << endl;
+      continue;
+      }
+      
+    tObjectPrototype * proto = new tObjectPrototype;
+    proto->vnum = vnum;
+    proto->name = name;
+    proto->description = FindAndReplace (description, "%r", "\n") + "\n";
+    proto->flags = 0;
+    objectprotomap [vnum] = proto;
+      
+    istringstream is (sFlags);
+    string flag;
+    while (is >> flag)
+      {
+      if (ciStringEqual (flag, "container"))
+        proto->flags |= OBJ_CONTAINER;
+      else
+        cerr << "Unknown flag " << flag << " for object " << vnum << endl;
+      }
+    
+    // objects which start off in a room
+    if (room == 0)
+      continue;
+      
+    tRoomMapIterator roomiter = roommap.find (room);
+    if (roomiter == roommap.end ())
+      {
+      cerr << "Object " << vnum << " is in room " << room << " which does not exist" << endl;
+      continue;
+      }
+      
+    for (int i = 0; i < count; ++i)
+      CreateObject (proto, roomiter->second->contents);
+    } // end of read loop
+
+} // end of LoadObjectsFile
+
+// load room triggers (eg. saying open sesame opens a door)
+void LoadTriggers ()
+{
+  // load triggers file
+  ifstream fTriggers (TRIGGERS_FILE, ios::in);
+  if (!fTriggers)
+    {
+    cerr << "Could not open triggers file: " << TRIGGERS_FILE << endl;
+    return;
+    }
+
+  // format is: <room> <action> [ <arguments> ]
+  //            <what they say>
+  //            <message to room>
+  //  eg. 1003 openexit n 1004
+  //      open sesame
+  //      A door slides open!
+  while (!(fTriggers.eof ()))
+    {
+    tTrigger trigger;
+    trigger.room = 0;
+    
+    fTriggers >> trigger.room >> trigger.action >> ws;
+    getline (fTriggers, trigger.args);
+    getline (fTriggers, trigger.pattern);
+    getline (fTriggers, trigger.message);
+    trigger.pattern = Trim (trigger.pattern);
+
+    // give up if no room or pattern
+    if (trigger.room == 0 || trigger.pattern.empty ())
+      break;
+      
+    if (roommap.find (trigger.room) == roommap.end ())
+      {
+      cerr << "Trigger '" << trigger.pattern << "' is for room " << trigger.room 
+           << " which does not exist" << endl;
+      continue;
+      }
+      
+    if (!trigger.message.empty ())
+      trigger.message = FindAndReplace (trigger.message, "%r", "\n") + "\n";
+      
+    try
+      {
+      AddTrigger (trigger);
+      }
+    catch (runtime_error & e)
+      {
+      cerr << e.what () << " for room " << trigger.room << endl;
+      }
+    } // end of read loop
+
+} // end of LoadTriggers
+
 // build up our commands map and connection states
 void LoadThings ()
 {
 
   LoadCommands ();
   LoadStates ();
+  LoadTriggerHandlers ();
 
   // load files
   LoadControlFile ();
   LoadMessages ();
   LoadRooms ();
+  LoadMobiles ();
+  LoadObjectsFile ();
+  LoadTriggers ();
+  
+  tLastMessage = GameTime ();   // first periodic message is MESSAGE_INTERVAL from now
 
 } // end of LoadThings
@@ -0,0 +1,537 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+/*
+
+ loadgen - a closed-loop load generator for tinymudserver
+ 
+ Opens lots of connections to the server on this machine, logs each one in
+ (creating the character if there isn't one), then has each send a mix of
+ commands. Each bot waits for its prompt before thinking about its next
+ command, so the time from sending a command to getting the prompt back
+ is the latency a player would see.
+ 
+ Bots log in as <prefix><number> with the same password, so the second
+ run against the same server uses the player files the first run made.
+
+*/
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std; 
+
+static const char * PROMPT = "> ";   // the server's prompt once playing
+
+// what we are up to with each connection
+typedef enum
+  {
+  eConnecting,        // waiting for the connect to finish
+  eGreeting,          // waiting for "Enter your name"
+  eSentName,          // waiting for the password prompt (or "does not exist")
+  eSentNew,           // waiting for "choose a name"
+  eSentNewName,       // waiting for "Choose a password"
+  eSentNewPassword,   // waiting for "Re-enter password"
+  eSentPassword,      // waiting to get into the game
+  ePlaying,           // sending commands
+  eFailed             // gave up on this one
+  } tBotState;
+
+// one simulated player
+struct tBot
+  {
+  int s;              // socket
+  string name;
+  tBotState state;
+  string inbuf;       // received, not yet acted on
+  string lastLine;    // last thing sent during the login (to retry if busy)
+  double startedAt;   // when we connected
+  double nextSend;    // when to send the next command (or retry)
+  double sentAt;      // when the command we are waiting for was sent (0 = not waiting)
+  
+  tBot () : s (-1), state (eConnecting), startedAt (0), nextSend (0), sentAt (0) {}
+  };  // end of tBot
+
+// settings (see Usage)
+static int connections = 100;
+static double connectRate = 50;     // new connections a second
+static double commandRate = 1;      // commands a second, per bot
+static double duration = 30;        // seconds of commands
+static int port = 4000;
+static string prefix = "Bot";
+static string password = "loadgen";
+static int serverPid = 0;
+static map<string, int> mix;        // command kind -> weight
+
+static vector<tBot> bots;
+static vector<double> latencies;    // seconds, each command
+static vector<double> logintimes;   // seconds, connect to playing
+static int failed = 0;
+static long busyRetries = 0;
+
+static double Now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+} // end of Now
+
+static void Usage ()
+{
+  cerr << "Usage: loadgen [options]\n"
+          "  -c n       connections (default 100)\n"
+          "  -C n       new connections a second (default 50)\n"
+          "  -r n       commands a second, per connection (default 1)\n"
+          "  -d n       seconds to send commands for, once all are connected (default 30)\n"
+          "  -p n       server port (default 4000)\n"
+          "  -x name    player name prefix (default Bot)\n"
+          "  -w word    password (default loadgen)\n"
+          "  -s pid     server process, to report its CPU use\n"
+          "  -m mix     command weights (default look=30,move=20,say=20,tell=10,who=10,chat=10)\n";
+  exit (1);
+} // end of Usage
+
+// eg. look=30,move=20
+static void ParseMix (const string & s)
+{
+  mix.clear ();
+  istringstream is (s);
+  string item;
+  while (getline (is, item, ','))
+    {
+    string::size_type eq = item.find ('=');
+    if (eq == string::npos)
+      Usage ();
+    mix [item.substr (0, eq)] = atoi (item.substr (eq + 1).c_str ());
+    }
+} // end of ParseMix
+
+// server CPU time so far, in seconds (0 if we don't know the server)
+static double ServerCPU ()
+{
+  if (serverPid == 0)
+    return 0;
+  ostringstream fn;
+  fn << "/proc/" << serverPid << "/stat";
+  ifstream f (fn.str ().c_str ());
+  string stat;
+  getline (f, stat);
+  
+  // fields after the command name (which is in brackets): utime and stime are 12th and 13th
+  string::size_type close = stat.rfind (')');
+  if (close == string::npos)
+    return 0;
+  istringstream is (stat.substr (close + 2));
+  string field;
+  double utime = 0, stime = 0;
+  for (int i = 0; i < 13 && is >> field; ++i)
+    {
+    if (i == 11) utime = atof (field.c_str ());
+    if (i == 12) stime = atof (field.c_str ());
+    }
+  return (utime + stime) / sysconf (_SC_CLK_TCK);
+} // end of ServerCPU
+
+static void Send (tBot & b, const string & line)
+{
+  string data = line + "\n";
+  if (write (b.s, data.c_str (), data.size ()) != (int) data.size ())
+    {
+    b.state = eFailed;
+    ++failed;
+    }
+} // end of Send
+
+// send the next line of the login, remembering it in case the server is busy
+static void SendLogin (tBot & b, const string & line, const tBotState next)
+{
+  b.lastLine = line;
+  b.inbuf.clear ();
+  b.state = next;
+  Send (b, line);
+} // end of SendLogin
+
+// pick a command from the mix
+static string NextCommand (const tBot & b)
+{
+  int total = 0;
+  for (map<string, int>::const_iterator i = mix.begin (); i != mix.end (); ++i)
+    total += i->second;
+  int pick = total > 0 ? rand () % total : 0;
+  string kind = "look";
+  for (map<string, int>::const_iterator i = mix.begin (); i != mix.end (); ++i)
+    {
+    if (pick < i->second)
+      {
+      kind = i->first;
+      break;
+      }
+    pick -= i->second;
+    }
+    
+  static const char * directions [] = { "n", "s", "e", "w" };
+  ostringstream os;
+  if (kind == "move")
+    os << directions [rand () % 4];
+  else if (kind == "say")
+    os << "say hello from " << b.name;
+  else if (kind == "tell")
+    os << "tell " << prefix << (rand () % connections + 1) << " hi there";
+  else if (kind == "chat")
+    os << "chat load test";
+  else
+    os << kind;   // eg. look, who
+  return os.str ();
+} // end of NextCommand
+
+// think time between commands - random, averaging 1 / commandRate
+static double ThinkTime ()
+{
+  return commandRate > 0 ? (rand () / (double) RAND_MAX) * 2 / commandRate : 1e9;
+} // end of ThinkTime
+
+static bool Has (const tBot & b, const char * s)
+{
+  return b.inbuf.find (s) != string::npos;
+} // end of Has
+
+// act on what the server has sent
+static void ProcessInput (tBot & b, const double now)
+{
+  // the server was too busy to check the password - try again shortly
+  if (Has (b, "server is busy"))
+    {
+    b.inbuf.clear ();
+    b.nextSend = now + 1;
+    ++busyRetries;
+    return;
+    }
+    
+  switch (b.state)
+    {
+    case eGreeting:
+      if (Has (b, "Enter your name"))
+        SendLogin (b, b.name, eSentName);
+      break;
+      
+    case eSentName:
+      if (Has (b, "does not exist"))
+        SendLogin (b, "new", eSentNew);
+      else if (Has (b, "Enter your password"))
+        SendLogin (b, password, eSentPassword);
+      else if (Has (b, "already connected"))
+        {
+        b.state = eFailed;
+        ++failed;
+        }
+      break;
+      
+    case eSentNew:
+      if (Has (b, "choose a name"))
+        SendLogin (b, b.name, eSentNewName);
+      break;
+      
+    case eSentNewName:
+      if (Has (b, "Choose a password"))
+        SendLogin (b, password, eSentNewPassword);
+      else if (Has (b, "already exists"))
+        {
+        b.state = eFailed;
+        ++failed;
+        }
+      break;
+      
+    case eSentNewPassword:
+      if (Has (b, "Re-enter password"))
+        SendLogin (b, password, eSentPassword);
+      break;
+      
+    case eSentPassword:
+      if (Has (b, "incorrect") || Has (b, "not permitted"))
+        {
+        b.state = eFailed;
+        ++failed;
+        }
+      else if (Has (b, "Welcome, ") && 
+               b.inbuf.find (PROMPT, b.inbuf.find ("Welcome, ")) != string::npos)
+        {
+        logintimes.push_back (now - b.startedAt);
+        b.state = ePlaying;
+        b.inbuf.clear ();
+        b.nextSend = now + ThinkTime ();
+        }
+      break;
+      
+    case ePlaying:
+      // the prompt means our command is done (other output just gets thrown away)
+      if (b.sentAt > 0 && Has (b, PROMPT))
+        {
+        latencies.push_back (now - b.sentAt);
+        b.sentAt = 0;
+        b.nextSend = now + ThinkTime ();
+        }
+      b.inbuf.clear ();
+      break;
+      
+    default:
+      break;
+    }
+} // end of ProcessInput
+
+static bool Connect (tBot & b)
+{
+  b.s = socket (AF_INET, SOCK_STREAM, 0);
+  if (b.s == -1)
+    return false;
+  fcntl (b.s, F_SETFL, O_NONBLOCK);
+  int x = 1;
+  setsockopt (b.s, IPPROTO_TCP, TCP_NODELAY, (char *) &x, sizeof x);
+  
+  struct sockaddr_in sa;
+  memset (&sa, 0, sizeof sa);
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons (port);
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (connect (b.s, (struct sockaddr *) &sa, sizeof sa) == -1 && errno != EINPROGRESS)
+    return false;
+  b.startedAt = Now ();
+  return true;
+} // end of Connect
+
+// p50 etc. of some times, in milliseconds
+static void ReportTimes (const string & title, vector<double> & times)
+{
+  if (times.empty ())
+    {
+    cout << title << ": none" << endl;
+    return;
+    }
+  sort (times.begin (), times.end ());
+  const double fractions [] = { 0.5, 0.99, 0.999 };
+  const char * names [] = { "p50", "p99", "p999" };
+  cout << title << " (ms, " << times.size () << "):";
+  for (int i = 0; i < 3; ++i)
+    cout << " " << names [i] << " " 
+         << times [min (times.size () - 1, size_t (times.size () * fractions [i]))] * 1000;
+  cout << " max " << times.back () * 1000 << endl;
+} // end of ReportTimes
+
+int main (int argc, char * argv [])
+{
+  ParseMix ("look=30,move=20,say=20,tell=10,who=10,chat=10");
+  
+  int c;
+  while ((c = getopt (argc, argv, "c:C:r:d:p:x:w:s:m:")) != -1)
+    switch (c)
+      {
+      case 'c': connections = atoi (optarg); break;
+      case 'C': connectRate = atof (optarg); break;
+      case 'r': commandRate = atof (optarg); break;
+      case 'd': duration = atof (optarg); break;
+      case 'p': port = atoi (optarg); break;
+      case 'x': prefix = optarg; break;
+      case 'w': password = optarg; break;
+      case 's': serverPid = atoi (optarg); break;
+      case 'm': ParseMix (optarg); break;
+      default: Usage ();
+      }
+  if (connections < 1 || connectRate <= 0)
+    Usage ();
+      
+  // we want lots of sockets
+  struct rlimit rl;
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0)
+    {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit (RLIMIT_NOFILE, &rl);
+    }
+  srand (time (NULL));
+  
+  bots.resize (connections);
+  for (int i = 0; i < connections; ++i)
+    {
+    ostringstream os;
+    os << prefix << (i + 1);
+    bots [i].name = os.str ();
+    }
+    
+  cout << "Connecting " << connections << " players to port " << port << " ..." << endl;
+  
+  const double start = Now ();
+  const double cpuStart = ServerCPU ();
+  int connected = 0;          // connects started
+  double measureStart = 0;    // when everyone was in (or had failed)
+  double cpuMeasureStart = 0;
+  size_t latenciesBefore = 0; // commands done before measuring
+  
+  vector<struct pollfd> pollfds;
+  vector<int> pollbots;
+  
+  while (true)
+    {
+    double now = Now ();
+    
+    // start more connections, at connectRate
+    while (connected < connections && connected < (now - start) * connectRate + 1)
+      {
+      if (!Connect (bots [connected]))
+        {
+        perror ("connect");
+        bots [connected].state = eFailed;
+        ++failed;
+        }
+      ++connected;
+      }
+      
+    // is everyone playing yet?
+    if (measureStart == 0 && connected == connections)
+      {
+      int ready = 0;
+      for (vector<tBot>::const_iterator i = bots.begin (); i != bots.end (); ++i)
+        if (i->state == ePlaying || i->state == eFailed)
+          ++ready;
+      if (ready == connections)
+        {
+        measureStart = now;
+        cpuMeasureStart = ServerCPU ();
+        latenciesBefore = latencies.size ();
+        cout << "All logged in after " << now - start << " seconds, sending commands ..." << endl;
+        }
+      }
+    if (measureStart > 0 && now - measureStart >= duration)
+      break;
+      
+    // send commands (or retry a busy login) that are due
+    for (vector<tBot>::iterator i = bots.begin (); i != bots.end (); ++i)
+      {
+      if (i->state == eFailed || i->state == eConnecting || i->nextSend == 0 || i->nextSend > now)
+        continue;
+      i->nextSend = 0;
+      if (i->state == ePlaying && i->sentAt == 0)
+        {
+        i->sentAt = now;
+        i->inbuf.clear ();    // so any prompt from now on is for this command
+        Send (*i, NextCommand (*i));
+        }
+      else if (i->state != ePlaying)
+        Send (*i, i->lastLine);   // the server was busy
+      }
+      
+    pollfds.clear ();
+    pollbots.clear ();
+    for (size_t i = 0; i < bots.size (); ++i)
+      {
+      if (bots [i].s == -1 || bots [i].state == eFailed)
+        continue;
+      struct pollfd pfd;
+      pfd.fd = bots [i].s;
+      pfd.events = bots [i].state == eConnecting ? POLLOUT : POLLIN;
+      pfd.revents = 0;
+      pollfds.push_back (pfd);
+      pollbots.push_back (i);
+      }
+      
+    if (pollfds.empty ())
+      {
+      usleep (1000);
+      continue;
+      }
+    if (poll (&pollfds [0], pollfds.size (), 1) <= 0)
+      continue;
+      
+    now = Now ();
+    char buf [8192];
+    for (size_t i = 0; i < pollfds.size (); ++i)
+      {
+      if (pollfds [i].revents == 0)
+        continue;
+      tBot & b = bots [pollbots [i]];
+      
+      if (b.state == eConnecting)
+        {
+        int err = 0;
+        socklen_t len = sizeof err;
+        getsockopt (b.s, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err)
+          {
+          b.state = eFailed;
+          ++failed;
+          }
+        else
+          b.state = eGreeting;
+        continue;
+        }
+        
+      int nRead = read (b.s, buf, sizeof buf);
+      if (nRead <= 0)
+        {
+        if (nRead == -1 && errno == EWOULDBLOCK)
+          continue;
+        b.state = eFailed;    // server hung up
+        ++failed;
+        continue;
+        }
+      b.inbuf.append (buf, nRead);
+      ProcessInput (b, now);
+      }
+    } // end of main loop
+    
+  const double elapsed = Now () - measureStart;
+  const double cpu = ServerCPU () - cpuMeasureStart;
+  
+  // we are done - quit, so they get saved for next time
+  for (vector<tBot>::iterator i = bots.begin (); i != bots.end (); ++i)
+    if (i->state == ePlaying)
+      Send (*i, "quit");
+  usleep (500000);
+  for (vector<tBot>::iterator i = bots.begin (); i != bots.end (); ++i)
+    if (i->s != -1)
+      close (i->s);
+  
+  vector<double> measured (latencies.begin () + latenciesBefore, latencies.end ());
+  
+  cout << "\nConnections: " << connections << ", failed: " << failed 
+       << ", busy retries: " << busyRetries << endl;
+  ReportTimes ("Login", logintimes);
+  ReportTimes ("Command", measured);
+  cout << "Throughput: " << fixed << setprecision (1) << measured.size () / elapsed 
+       << " commands/sec over " << elapsed << " seconds" << endl;
+  if (serverPid)
+    cout << "Server CPU: " << cpu / elapsed * 100 << "% (" << cpu << " sec), " 
+         << (ServerCPU () - cpuStart) << " sec including logins" << endl;
+  return 0;
+} // end of main
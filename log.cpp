@@ -0,0 +1,276 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+using namespace std; 
+
+#include "utils.h"
+#include "constants.h"
+#include "metrics.h"
+#include "log.h"
+
+// one message
+struct tLogRecord
+  {
+  int64_t time;                 // usec since the epoch
+  unsigned short length;        // bytes in text
+  unsigned char level;          // tLogLevel
+  unsigned char thread;         // which thread logged it (for the log)
+  char text [LOG_TEXT_SIZE];
+  };  // end of tLogRecord
+
+// records from one thread - that thread only moves head, the log thread only moves tail
+struct tLogRing
+  {
+  tLogRecord records [LOG_RING_SIZE];
+  uint64_t head;      // next record to write
+  uint64_t tail;      // next record to read
+  uint64_t dropped;   // records that didn't fit
+  };  // end of tLogRing
+
+static const char * levelnames [] = { "INFO ", "WARN ", "ERROR" };
+
+static vector<tLogRing*> rings;   // every thread that has logged something
+static pthread_mutex_t ringslock = PTHREAD_MUTEX_INITIALIZER;
+static __thread tLogRing * myring = NULL;
+
+// the log thread
+static pthread_t logthread;
+static bool logging = false;      // true while the log thread is running
+static bool stopping = false;     // tells the log thread to finish
+static int logfd = NO_SOCKET;     // where it writes
+static string logfilename;        // empty for stdout
+static long logbytes = 0;         // written to the current file
+
+// this thread's ring, made the first time it logs something
+static tLogRing * MyRing ()
+{
+  if (myring == NULL)
+    {
+    myring = new tLogRing;
+    myring->head = myring->tail = myring->dropped = 0;
+    pthread_mutex_lock (&ringslock);
+    rings.push_back (myring);
+    pthread_mutex_unlock (&ringslock);
+    }
+  return myring;
+} // end of MyRing
+
+void Log (const tLogLevel level, const string & message)
+{
+  tLogRing * ring = MyRing ();
+  const uint64_t head = ring->head;
+  
+  // full? the log thread is behind - better to lose this than to wait for it
+  if (head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE)
+    {
+    __atomic_store_n (&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+    Count (eLogDropped);
+    return;
+    }
+    
+  tLogRecord & r = ring->records [head & (LOG_RING_SIZE - 1)];
+  struct timeval tv;
+  gettimeofday (&tv, NULL);   // not a system call on Linux
+  r.time = int64_t (tv.tv_sec) * 1000000 + tv.tv_usec;
+  r.level = level;
+  r.length = min<size_t> (message.size (), LOG_TEXT_SIZE);
+  memcpy (r.text, message.data (), r.length);
+  
+  // now the log thread can have it
+  __atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+} // end of Log
+
+void LogError (const string & what)
+{
+  char buf [128];
+  Log (eLogError, what + ": " + strerror_r (errno, buf, sizeof buf));
+} // end of LogError
+
+// sort records into the order they were logged
+struct recordEarlier
+{
+  bool operator() (const tLogRecord & r1, const tLogRecord & r2) const
+    {
+    return r1.time < r2.time;
+    }
+};  // end of recordEarlier
+
+static bool OpenLog ()
+{
+  logbytes = 0;
+  if (logfilename.empty ())
+    {
+    logfd = STDOUT_FILENO;
+    return true;
+    }
+  logfd = open (logfilename.c_str (), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (logfd == -1)
+    {
+    perror (logfilename.c_str ());
+    return false;
+    }
+  logbytes = lseek (logfd, 0, SEEK_END);
+  return true;
+} // end of OpenLog
+
+// start a new file, keeping the last few
+static void RotateLog ()
+{
+  close (logfd);
+  for (int i = LOG_KEEP_FILES - 1; i >= 1; --i)
+    rename (MAKE_STRING (logfilename << "." << i).c_str (), 
+            MAKE_STRING (logfilename << "." << i + 1).c_str ());
+  rename (logfilename.c_str (), (logfilename + ".1").c_str ());
+  OpenLog ();
+} // end of RotateLog
+
+static void WriteLog (const string & text)
+{
+  string::size_type done = 0;
+  while (logfd != -1 && done < text.size ())
+    {
+    const ssize_t n = write (logfd, text.data () + done, text.size () - done);
+    if (n == -1)
+      {
+      if (errno == EINTR)
+        continue;
+      return;   // nowhere to complain to
+      }
+    done += n;
+    }
+  logbytes += done;
+  
+  if (!logfilename.empty () && logbytes >= LOG_ROTATE_BYTES)
+    RotateLog ();
+} // end of WriteLog
+
+// take everything waiting in the rings, and write it - returns true if a ring was full
+static bool DrainLog (vector<tLogRecord> & batch, uint64_t & dropped)
+{
+  vector<tLogRing*> current;
+  pthread_mutex_lock (&ringslock);
+  current = rings;
+  pthread_mutex_unlock (&ringslock);
+  
+  batch.clear ();
+  bool full = false;
+  uint64_t nowDropped = 0;
+  for (size_t i = 0; i < current.size (); ++i)
+    {
+    tLogRing * ring = current [i];
+    const uint64_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+    full |= head - ring->tail >= LOG_RING_SIZE;
+    for (uint64_t t = ring->tail; t != head; ++t)
+      {
+      batch.push_back (ring->records [t & (LOG_RING_SIZE - 1)]);
+      batch.back ().thread = i;
+      }
+    // they can reuse those records now
+    __atomic_store_n (&ring->tail, head, __ATOMIC_RELEASE);
+    nowDropped += __atomic_load_n (&ring->dropped, __ATOMIC_RELAXED);
+    }
+    
+  stable_sort (batch.begin (), batch.end (), recordEarlier ());
+  
+  string text;
+  for (vector<tLogRecord>::const_iterator r = batch.begin (); r != batch.end (); ++r)
+    {
+    const time_t secs = r->time / 1000000;
+    struct tm tm;
+    localtime_r (&secs, &tm);
+    char stamp [32];
+    strftime (stamp, sizeof stamp, "%Y-%m-%d %H:%M:%S", &tm);
+    char prefix [64];
+    snprintf (prefix, sizeof prefix, "%s.%03d [%d] %s ", 
+              stamp, int (r->time / 1000 % 1000), r->thread, levelnames [r->level]);
+    text += prefix;
+    text.append (r->text, r->length);
+    text += '\n';
+    }
+    
+  if (nowDropped != dropped)
+    {
+    text += MAKE_STRING ("*** " << nowDropped - dropped << " log record(s) dropped ***\n");
+    dropped = nowDropped;
+    }
+    
+  if (!text.empty ())
+    WriteLog (text);
+  return full;
+} // end of DrainLog
+
+static void * LogThread (void * arg)
+{
+  vector<tLogRecord> batch;
+  uint64_t dropped = 0;
+  
+  // a full ring means we are behind, so go again straight away
+  while (!__atomic_load_n (&stopping, __ATOMIC_ACQUIRE))
+    if (!DrainLog (batch, dropped))
+      usleep (LOG_DRAIN_USEC);
+  
+  // whatever was logged before we were told to stop
+  DrainLog (batch, dropped);
+  return NULL;
+} // end of LogThread
+
+bool StartLogging (const string & filename)
+{
+  logfilename = filename;
+  if (!OpenLog ())
+    return false;
+    
+  stopping = false;
+  if (pthread_create (&logthread, NULL, LogThread, NULL) != 0)
+    {
+    cerr << "Could not start log thread" << endl;
+    return false;
+    }
+  logging = true;
+  return true;
+} // end of StartLogging
+
+void StopLogging ()
+{
+  if (!logging)
+    return;
+  __atomic_store_n (&stopping, true, __ATOMIC_RELEASE);
+  pthread_join (logthread, NULL);
+  logging = false;
+  if (!logfilename.empty () && logfd != -1)
+    close (logfd);
+  logfd = NO_SOCKET;
+} // end of StopLogging
+
+bool RestartLogging ()
+{
+  const string filename = logfilename;
+  return StartLogging (filename);
+} // end of RestartLogging
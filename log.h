@@ -0,0 +1,45 @@
+#ifndef TINYMUDSERVER_LOG_H
+#define TINYMUDSERVER_LOG_H
+
+#include <stdint.h>
+
+/*---------------------------------------------- */
+/*  log - messages written by a background thread */
+/*---------------------------------------------- */
+
+/*
+ Log copies the message into a fixed-size record in a ring belonging to the
+ calling thread, and that is all - no locks and no system calls. A log
+ thread collects the records from every ring, puts them in time order, and
+ writes them out in batches. If the output can't keep up (eg. stdout is a
+ pipe to something slow) the rings fill up, and further records are
+ dropped and counted rather than holding up the game.
+
+ Logging to a file (./tinymudserver --log <file>) starts a new file when it
+ reaches LOG_ROTATE_BYTES, keeping the last LOG_KEEP_FILES as <file>.1,
+ <file>.2 and so on.
+*/
+
+typedef enum
+  {
+  eLogInfo,         // connections, logins etc.
+  eLogWarning,      // something odd, but we carry on
+  eLogError         // something failed
+  } tLogLevel;
+
+// log a message (longer than LOG_TEXT_SIZE is cut short)
+void Log (const tLogLevel level, const string & message);
+
+// log a failed system call, like perror (eg. LogError ("accept"))
+void LogError (const string & what);
+
+// start the log thread, writing to the file, or stdout if it is empty - false if it can't be opened
+bool StartLogging (const string & filename);
+
+// write whatever is waiting, and stop the log thread
+void StopLogging ();
+
+// start it again, with the same file as last time (eg. after a copyover that failed)
+bool RestartLogging ();
+
+#endif // TINYMUDSERVER_LOG_H
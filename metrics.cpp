@@ -0,0 +1,459 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std; 
+
+#include "constants.h"
+#include "metrics.h"
+#include "log.h"
+
+// what the counters are called (same order as tCounter)
+static const char * counternames [COUNTER_COUNT] = 
+  {
+  "bytes_in",
+  "bytes_out",
+  "lines_in",
+  "accepts",
+  "disconnects",
+  "blocked",
+  "throttled",
+  "unknown_commands",
+  "log_dropped",
+  };
+
+// one histogram, for one thread
+struct tHistogram
+  {
+  uint64_t buckets [HISTOGRAM_BUCKETS];
+  uint64_t sum;     // usec
+  uint64_t max;     // usec
+  };  // end of tHistogram
+
+// everything one thread records
+struct tThreadMetrics
+  {
+  uint64_t counters [COUNTER_COUNT];
+  tHistogram histograms [MAX_HISTOGRAMS];
+  };  // end of tThreadMetrics
+
+static vector<pair<string, string> > histogramnames;   // family, label - by id
+
+static vector<tThreadMetrics*> threadmetrics;   // every thread that has recorded something
+static pthread_mutex_t threadmetricslock = PTHREAD_MUTEX_INITIALIZER;
+static __thread tThreadMetrics * mymetrics = NULL;
+
+// this thread's metrics, made the first time it records something
+static tThreadMetrics * MyMetrics ()
+{
+  if (mymetrics == NULL)
+    {
+    mymetrics = new tThreadMetrics;
+    memset (mymetrics, 0, sizeof *mymetrics);
+    pthread_mutex_lock (&threadmetricslock);
+    threadmetrics.push_back (mymetrics);
+    pthread_mutex_unlock (&threadmetricslock);
+    }
+  return mymetrics;
+} // end of MyMetrics
+
+// only this thread writes it, but reports read it from the main thread
+static inline void Add (uint64_t & x, const uint64_t n)
+{
+  __atomic_store_n (&x, __atomic_load_n (&x, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+} // end of Add
+
+static inline uint64_t Get (const uint64_t & x)
+{
+  return __atomic_load_n (&x, __ATOMIC_RELAXED);
+} // end of Get
+
+void Count (const tCounter counter, const uint64_t amount)
+{
+  Add (MyMetrics ()->counters [counter], amount);
+} // end of Count
+
+int AddHistogram (const string & family, const string & label)
+{
+  if (histogramnames.size () >= (size_t) MAX_HISTOGRAMS)
+    return -1;
+  histogramnames.push_back (make_pair (family, label));
+  return histogramnames.size () - 1;
+} // end of AddHistogram
+
+// which bucket a time goes in: exact below 8, then 8 per power of two
+static int BucketFor (uint64_t usec)
+{
+  const uint64_t SUB = 1 << HISTOGRAM_SUB_BITS;
+  if (usec < SUB)
+    return usec;
+  const uint64_t most = (uint64_t (1) << (HISTOGRAM_BUCKETS / SUB + HISTOGRAM_SUB_BITS - 1)) - 1;
+  if (usec > most)
+    usec = most;
+  const int power = 63 - __builtin_clzll (usec);
+  const int sub = (usec >> (power - HISTOGRAM_SUB_BITS)) & (SUB - 1);
+  return ((power - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + sub;
+} // end of BucketFor
+
+// the largest time that goes in a bucket
+static uint64_t BucketTop (const int bucket)
+{
+  const int SUB = 1 << HISTOGRAM_SUB_BITS;
+  if (bucket < SUB)
+    return bucket;
+  const int power = bucket / SUB + HISTOGRAM_SUB_BITS - 1;
+  const uint64_t width = uint64_t (1) << (power - HISTOGRAM_SUB_BITS);
+  return (SUB + bucket % SUB) * width + width - 1;
+} // end of BucketTop
+
+void Record (const int histogram, const uint64_t usec)
+{
+  if (histogram < 0)
+    return;
+  tHistogram & h = MyMetrics ()->histograms [histogram];
+  Add (h.buckets [BucketFor (usec)], 1);
+  Add (h.sum, usec);
+  if (usec > Get (h.max))
+    __atomic_store_n (&h.max, usec, __ATOMIC_RELAXED);
+} // end of Record
+
+tTimer::~tTimer ()
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  Record (histogram, (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000);
+} // end of tTimer::~tTimer
+
+/*---------------------------------------------- */
+/*  reports                                       */
+/*---------------------------------------------- */
+
+// all threads added together
+struct tTotals
+  {
+  uint64_t counters [COUNTER_COUNT];
+  vector<tHistogram> histograms;
+  
+  tTotals () : histograms (histogramnames.size ())
+    {
+    memset (counters, 0, sizeof counters);
+    if (!histograms.empty ())
+      memset (&histograms [0], 0, histograms.size () * sizeof (tHistogram));
+      
+    pthread_mutex_lock (&threadmetricslock);
+    for (vector<tThreadMetrics*>::const_iterator t = threadmetrics.begin (); 
+         t != threadmetrics.end (); ++t)
+      {
+      for (int i = 0; i < COUNTER_COUNT; ++i)
+        counters [i] += Get ((*t)->counters [i]);
+      for (size_t i = 0; i < histograms.size (); ++i)
+        {
+        const tHistogram & from = (*t)->histograms [i];
+        tHistogram & to = histograms [i];
+        for (int b = 0; b < HISTOGRAM_BUCKETS; ++b)
+          to.buckets [b] += Get (from.buckets [b]);
+        to.sum += Get (from.sum);
+        to.max = max (to.max, Get (from.max));
+        }
+      }
+    pthread_mutex_unlock (&threadmetricslock);
+    }
+  };  // end of tTotals
+
+static uint64_t HistogramCount (const tHistogram & h)
+{
+  uint64_t count = 0;
+  for (int b = 0; b < HISTOGRAM_BUCKETS; ++b)
+    count += h.buckets [b];
+  return count;
+} // end of HistogramCount
+
+// time that fraction (eg. 0.99) of the samples are no slower than
+static uint64_t Percentile (const tHistogram & h, const uint64_t count, const double fraction)
+{
+  const uint64_t wanted = uint64_t (count * fraction + 0.5);
+  uint64_t seen = 0;
+  for (int b = 0; b < HISTOGRAM_BUCKETS; ++b)
+    {
+    seen += h.buckets [b];
+    if (seen >= wanted && seen > 0)
+      return min (BucketTop (b), h.max);
+    }
+  return h.max;
+} // end of Percentile
+
+string MetricsReport ()
+{
+  tTotals totals;
+  ostringstream os;
+  
+  os << "Counters:\n";
+  for (int i = 0; i < COUNTER_COUNT; ++i)
+    os << "  " << setw (32) << left << counternames [i] << totals.counters [i] << "\n";
+    
+  os << "\nTimes (usec):\n";
+  os << "  " << setw (32) << left << "" << right 
+     << setw (9) << "count" << setw (9) << "mean" << setw (9) << "p50" 
+     << setw (9) << "p90" << setw (9) << "p99" << setw (9) << "max" << "\n";
+  for (size_t i = 0; i < totals.histograms.size (); ++i)
+    {
+    const tHistogram & h = totals.histograms [i];
+    const uint64_t count = HistogramCount (h);
+    if (count == 0)
+      continue;   // not used yet
+    os << "  " << setw (32) << left << (histogramnames [i].first + " " + histogramnames [i].second) 
+       << right << setw (9) << count << setw (9) << h.sum / count 
+       << setw (9) << Percentile (h, count, 0.5) << setw (9) << Percentile (h, count, 0.9)
+       << setw (9) << Percentile (h, count, 0.99) << setw (9) << h.max << "\n";
+    }
+  return os.str ();
+} // end of MetricsReport
+
+// label values are in quotes, so quotes (eg. the " command) need escaping
+static string EscapeLabel (const string & s)
+{
+  string result;
+  for (string::const_iterator i = s.begin (); i != s.end (); ++i)
+    {
+    if (*i == '"' || *i == '\\')
+      result += '\\';
+    result += *i;
+    }
+  return result;
+} // end of EscapeLabel
+
+string MetricsPrometheus ()
+{
+  tTotals totals;
+  ostringstream os;
+  
+  for (int i = 0; i < COUNTER_COUNT; ++i)
+    os << "# TYPE tinymud_" << counternames [i] << "_total counter\n"
+       << "tinymud_" << counternames [i] << "_total " << totals.counters [i] << "\n";
+       
+  // one summary per family (eg. tinymud_command_seconds), labelled by the rest (eg. command="look")
+  string family;
+  for (size_t i = 0; i < totals.histograms.size (); ++i)
+    {
+    const tHistogram & h = totals.histograms [i];
+    const string & name = histogramnames [i].first;
+    const string label = name + "=\"" + EscapeLabel (histogramnames [i].second) + "\"";
+    const uint64_t count = HistogramCount (h);
+    
+    if (name != family)
+      {
+      family = name;
+      os << "# TYPE tinymud_" << family << "_seconds summary\n";
+      }
+      
+    static const double quantiles [] = { 0.5, 0.9, 0.99 };
+    for (int q = 0; q < 3; ++q)
+      os << "tinymud_" << family << "_seconds{" << label << ",quantile=\"" << quantiles [q] << "\"} " 
+         << Percentile (h, count, quantiles [q]) / 1e6 << "\n";
+    os << "tinymud_" << family << "_seconds_sum{" << label << "} " << h.sum / 1e6 << "\n"
+       << "tinymud_" << family << "_seconds_count{" << label << "} " << count << "\n";
+    }
+  return os.str ();
+} // end of MetricsPrometheus
+
+/*---------------------------------------------- */
+/*  Prometheus port                               */
+/*---------------------------------------------- */
+
+// someone scraping the metrics - we wait for their request, then answer and hang up
+struct tScraper
+  {
+  int s;
+  string request;
+  string response;    // what we have yet to send them (once they have asked)
+  time_t deadline;    // hang up if no request (or no progress sending the answer) by then
+  };  // end of tScraper
+
+static int metricsControl = NO_SOCKET;   // listening socket
+static vector<tScraper> scrapers;
+
+int InitMetricsPort ()
+{
+  metricsControl = socket (AF_INET, SOCK_STREAM, 0);
+  if (metricsControl == NO_SOCKET)
+    {
+    perror ("metrics socket");
+    return 1;
+    }
+  
+  int x = 1;
+  setsockopt (metricsControl, SOL_SOCKET, SO_REUSEADDR, (char *) &x, sizeof x);
+  fcntl (metricsControl, F_SETFL, O_NONBLOCK);
+  
+  // only from this machine
+  struct sockaddr_in sa;
+  memset (&sa, 0, sizeof sa);
+  sa.sin_family       = AF_INET;
+  sa.sin_port         = htons (METRICS_PORT);
+  sa.sin_addr.s_addr  = htonl (INADDR_LOOPBACK);
+  
+  if (bind (metricsControl, (struct sockaddr *) &sa, sizeof sa) == -1 ||
+      listen (metricsControl, SOMAXCONN) == -1)
+    {
+    perror ("metrics port");
+    close (metricsControl);
+    metricsControl = NO_SOCKET;
+    return 1;
+    }
+  return 0;
+} // end of InitMetricsPort
+
+void CloseMetricsPort ()
+{
+  for (vector<tScraper>::const_iterator i = scrapers.begin (); i != scrapers.end (); ++i)
+    close (i->s);
+  scrapers.clear ();
+  
+  if (metricsControl != NO_SOCKET)
+    close (metricsControl);
+  metricsControl = NO_SOCKET;
+} // end of CloseMetricsPort
+
+int MetricsSocket ()
+{
+  return metricsControl;
+} // end of MetricsSocket
+
+void ProcessMetricsConnection ()
+{
+  int s;
+  while ((s = accept (metricsControl, NULL, NULL)) != NO_SOCKET)
+    {
+    if (scrapers.size () >= MAX_SCRAPERS)
+      {
+      close (s);
+      continue;
+      }
+    fcntl (s, F_SETFL, O_NONBLOCK);
+    tScraper scraper;
+    scraper.s = s;
+    scraper.deadline = time (NULL) + SCRAPE_TIMEOUT;
+    scrapers.push_back (scraper);
+    }
+} // end of ProcessMetricsConnection
+
+void GetScraperSockets (vector<int> & reading, vector<int> & writing)
+{
+  const time_t now = time (NULL);
+  for (vector<tScraper>::iterator i = scrapers.begin (); i != scrapers.end (); )
+    {
+    if (i->deadline <= now)
+      {
+      close (i->s);   // never asked, or stopped taking the answer
+      i = scrapers.erase (i);
+      }
+    else
+      {
+      if (i->response.empty ())
+        reading.push_back (i->s);
+      else
+        writing.push_back (i->s);
+      ++i;
+      }
+    }
+} // end of GetScraperSockets
+
+// the one using this socket
+static vector<tScraper>::iterator FindScraper (const int s)
+{
+  vector<tScraper>::iterator i = scrapers.begin ();
+  while (i != scrapers.end () && i->s != s)
+    ++i;
+  return i;
+} // end of FindScraper
+
+// send what we can of the answer - they are hung up on once it has all gone
+static void SendScraper (vector<tScraper>::iterator i)
+{
+  const int nWrite = write (i->s, i->response.c_str (), i->response.size ());
+  if (nWrite == -1 && errno == EWOULDBLOCK)
+    return;   // try again when poll says there is room
+    
+  if (nWrite > 0 && nWrite < (int) i->response.size ())
+    {
+    i->response.erase (0, nWrite);
+    i->deadline = time (NULL) + SCRAPE_TIMEOUT;   // still taking it
+    return;
+    }
+    
+  if (nWrite == -1)
+    LogError ("write to metrics scraper");
+  close (i->s);
+  scrapers.erase (i);
+} // end of SendScraper
+
+void ProcessScraperRead (const int s)
+{
+  vector<tScraper>::iterator i = FindScraper (s);
+  if (i == scrapers.end ())
+    return;
+    
+  char buf [1024];
+  const int nRead = read (s, buf, sizeof buf);
+  if (nRead == -1 && errno == EWOULDBLOCK)
+    return;
+  if (nRead > 0)
+    i->request.append (buf, nRead);
+    
+  // wait for the end of the request headers (whatever it asked for, it gets the metrics)
+  if (nRead > 0 && i->request.find ("\r\n\r\n") == string::npos && i->request.size () < sizeof buf)
+    return;
+  
+  if (nRead <= 0)
+    {
+    close (s);
+    scrapers.erase (i);
+    return;
+    }
+    
+  const string body = MetricsPrometheus ();
+  ostringstream os;
+  os << "HTTP/1.0 200 OK\r\n"
+     << "Content-Type: text/plain; version=0.0.4\r\n"
+     << "Content-Length: " << body.size () << "\r\n"
+     << "Connection: close\r\n\r\n"
+     << body;
+  i->response = os.str ();
+  i->deadline = time (NULL) + SCRAPE_TIMEOUT;
+  SendScraper (i);
+} // end of ProcessScraperRead
+
+void ProcessScraperWrite (const int s)
+{
+  vector<tScraper>::iterator i = FindScraper (s);
+  if (i != scrapers.end ())
+    SendScraper (i);
+} // end of ProcessScraperWrite
@@ -0,0 +1,78 @@
+#ifndef TINYMUDSERVER_METRICS_H
+#define TINYMUDSERVER_METRICS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+/*---------------------------------------------- */
+/*  metrics - counters and latency histograms     */
+/*---------------------------------------------- */
+
+/*
+ Each thread adds to its own copy of every counter and histogram, so
+ recording something is a couple of memory writes and never takes a lock.
+ Reports add all the copies together.
+
+ Histograms are log-linear (like HDR histograms): 8 buckets between each
+ power of two, so any latency is known to within 12.5%.
+*/
+
+// things we count
+typedef enum
+  {
+  eBytesIn,           // read from sockets
+  eBytesOut,          // written to sockets
+  eLinesIn,           // lines of input
+  eAccepts,           // connections accepted
+  eDisconnects,       // connections closed
+  eBlocked,           // connections from blocked addresses
+  eThrottled,         // connections or logins refused for coming too fast
+  eUnknownCommands,   // Huh?
+  eLogDropped,        // log records dropped because the log thread was behind
+  
+  COUNTER_COUNT       // must be last
+  } tCounter;
+
+static const int MAX_HISTOGRAMS = 128;      // commands, states, loop phases ...
+static const int HISTOGRAM_SUB_BITS = 3;    // 2^3 buckets per power of two
+static const int HISTOGRAM_BUCKETS = (26 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS;  // up to 2^26 usec (67 s)
+
+// add to a counter
+void Count (const tCounter counter, const uint64_t amount = 1);
+
+// make a histogram - do this before other threads might use it
+// (eg. family "command", label "look") - returns its id, or -1 if there are too many
+int AddHistogram (const string & family, const string & label);
+
+// record a time, in microseconds
+void Record (const int histogram, const uint64_t usec);
+
+// time a block of code (eg. a command) - records how long it took when it goes out of scope
+class tTimer
+  {
+  int histogram;
+  struct timespec start;
+  
+  public:
+  tTimer (const int h) : histogram (h) { clock_gettime (CLOCK_MONOTONIC, &start); }
+  ~tTimer ();
+  };  // end of class tTimer
+
+// for the stats command
+string MetricsReport ();
+
+// Prometheus text format
+string MetricsPrometheus ();
+
+// the local port Prometheus scrapes (see METRICS_PORT)
+int InitMetricsPort ();
+void CloseMetricsPort ();
+int MetricsSocket ();                             // listening socket, or NO_SOCKET
+void ProcessMetricsConnection ();                 // accept scrapers
+// scrapers waiting to send their request, and ones still being sent the answer
+void GetScraperSockets (std::vector<int> & reading, std::vector<int> & writing);
+void ProcessScraperRead (const int s);            // read request, start sending the metrics
+void ProcessScraperWrite (const int s);           // send more of them
+
+#endif // TINYMUDSERVER_METRICS_H
@@ -0,0 +1,334 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <sys/time.h>
+
+#include <stdexcept>
+#include <iostream>
+
+using namespace std; 
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "room.h"
+#include "globals.h"
+#include "broadcast.h"
+#include "gameclock.h"
+#include "metrics.h"
+
+// new mobile from prototype, at home
+int tMobiles::Create (const int & p)
+{
+  const int m = proto.size ();
+  
+  proto.push_back (p);
+  room.push_back (0);
+  hp.push_back (prototypes [p].maxhp);
+  state.push_back (eMobIdle);
+  timer.push_back (WANDER_MIN_TICKS + Random (WANDER_MAX_TICKS - WANDER_MIN_TICKS + 1));
+  fighters.push_back (0);
+  nextInRoom.push_back (NO_MOBILE);
+  prevInRoom.push_back (NO_MOBILE);
+  
+  Link (m, prototypes [p].home);
+  return m;
+} // end of tMobiles::Create
+
+// put at the front of the room's list
+void tMobiles::Link (const int & m, const int & vnum)
+{
+  room [m] = vnum;
+  
+  map<int, int>::iterator i = roomFirst.find (vnum);
+  int first = (i == roomFirst.end ()) ? NO_MOBILE : i->second;
+  
+  prevInRoom [m] = NO_MOBILE;
+  nextInRoom [m] = first;
+  if (first != NO_MOBILE)
+    prevInRoom [first] = m;
+  roomFirst [vnum] = m;
+} // end of tMobiles::Link
+
+void tMobiles::Unlink (const int & m)
+{
+  if (prevInRoom [m] != NO_MOBILE)
+    nextInRoom [prevInRoom [m]] = nextInRoom [m];
+  else if (nextInRoom [m] != NO_MOBILE)
+    roomFirst [room [m]] = nextInRoom [m];
+  else
+    roomFirst.erase (room [m]);   // room is now empty
+    
+  if (nextInRoom [m] != NO_MOBILE)
+    prevInRoom [nextInRoom [m]] = prevInRoom [m];
+    
+  nextInRoom [m] = prevInRoom [m] = NO_MOBILE;
+} // end of tMobiles::Unlink
+
+int tMobiles::FirstInRoom (const int & vnum) const
+{
+  map<int, int>::const_iterator i = roomFirst.find (vnum);
+  return (i == roomFirst.end ()) ? NO_MOBILE : i->second;
+} // end of tMobiles::FirstInRoom
+
+// simple, fast, and gives the same sequence each time (xorshift)
+int tMobiles::Random (const int & n)
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 7;
+  seed ^= seed << 17;
+  return (seed & 0x7FFFFFFF) % n;
+} // end of tMobiles::Random
+
+// mobile is killed - it comes back at home later
+static void KillMobile (tMobiles & mobs, const int & m)
+{
+  // nobody is fighting it now
+  for (tPlayerNameMapIterator i = playernamemap.begin (); i != playernamemap.end (); ++i)
+    if (i->second->fighting == m)
+      i->second->fighting = NO_MOBILE;
+      
+  mobs.Unlink (m);
+  mobs.fighters [m] = 0;
+  mobs.state [m] = eMobDead;
+  mobs.timer [m] = RESPAWN_TICKS;
+} // end of KillMobile
+
+/* ---- systems - each one runs once per mobile tick ---- */
+
+// idle wandering mobiles go through a random exit from time to time
+static void WanderSystem (tMobiles & mobs)
+{
+  const int count = mobs.Count ();
+  for (int m = 0; m < count; ++m)
+    {
+    if (mobs.state [m] != eMobIdle || 
+        !(mobs.prototypes [mobs.proto [m]].flags & MOB_WANDER) ||
+        --mobs.timer [m] > 0)
+      continue;
+      
+    mobs.timer [m] = WANDER_MIN_TICKS + mobs.Random (WANDER_MAX_TICKS - WANDER_MIN_TICKS + 1);
+    
+    tRoomMapIterator roomiter = roommap.find (mobs.room [m]);
+    if (roomiter == roommap.end () || roomiter->second->exits.empty ())
+      continue;   // nowhere to go
+      
+    // pick an exit
+    const tExitMap & exits = roomiter->second->exits;
+    tExitMap::const_iterator exititer = exits.begin ();
+    advance (exititer, mobs.Random (exits.size ()));
+    
+    // don't wander into rooms that aren't there
+    const int from = mobs.room [m];
+    const int to = exititer->second;
+    if (roommap.find (to) == roommap.end ())
+      continue;
+    
+    mobs.Unlink (m);
+    mobs.Link (m, to);
+    
+    // only bother telling rooms with players in them
+    if (roomplayersmap.find (from) != roomplayersmap.end ())
+      QueueDeparture (mobs.Name (m), from, exititer->first);
+    if (roomplayersmap.find (to) != roomplayersmap.end ())
+      QueueArrival (mobs.Name (m), to, from);
+    } // end of each mobile
+} // end of WanderSystem
+
+// aggressive mobiles attack players in their room - only rooms with players are looked at
+static void AggressionSystem (tMobiles & mobs)
+{
+  for (tRoomPlayersMapIterator roomiter = roomplayersmap.begin ();
+       roomiter != roomplayersmap.end (); ++roomiter)
+    for (int m = mobs.FirstInRoom (roomiter->first); m != NO_MOBILE; m = mobs.NextInRoom (m))
+      {
+      if (mobs.state [m] != eMobIdle || 
+          !(mobs.prototypes [mobs.proto [m]].flags & MOB_AGGRESSIVE))
+        continue;
+        
+      // pick on the first player who isn't already busy
+      for (vector<tPlayer*>::const_iterator i = roomiter->second.begin ();
+           i != roomiter->second.end (); ++i)
+        {
+        tPlayer * p = *i;
+        if (!p->IsPlaying () || p->fighting != NO_MOBILE)
+          continue;
+          
+        StartFighting (p, m);
+        *p << tosentence (mobs.Name (m)) << " attacks you!\n";
+        SendToAll (tosentence (mobs.Name (m)) + " attacks " + p->playername + "!\n", 
+                   p, p->room);
+        break;
+        }
+      } // end of each mobile in room
+} // end of AggressionSystem
+
+// each player who is fighting does a round of combat
+static void CombatSystem (tMobiles & mobs)
+{
+  for (tPlayerNameMapIterator i = playernamemap.begin (); i != playernamemap.end (); ++i)
+    {
+    tPlayer * p = i->second;
+    const int m = p->fighting;
+    if (m == NO_MOBILE)
+      continue;
+      
+    // it might have died, or they might have left
+    if (mobs.state [m] == eMobDead || mobs.room [m] != p->room)
+      {
+      StopFighting (p);
+      continue;
+      }
+      
+    mobs.hp [m] -= 1 + mobs.Random (PLAYER_DAMAGE);
+    
+    if (mobs.hp [m] <= 0)
+      {
+      *p << "You kill " << mobs.Name (m) << "!\n";
+      SendToAll (p->playername + " kills " + mobs.Name (m) + ".\n", p, p->room);
+      KillMobile (mobs, m);
+      continue;
+      }
+      
+    *p << "You hit " << mobs.Name (m) << " (" << mobs.hp [m] << "/" 
+       << mobs.prototypes [mobs.proto [m]].maxhp << ").\n";
+    *p << tosentence (mobs.Name (m)) << " hits you.\n";
+    } // end of each player
+} // end of CombatSystem
+
+// dead mobiles come back at home when their time is up
+static void RespawnSystem (tMobiles & mobs)
+{
+  const int count = mobs.Count ();
+  for (int m = 0; m < count; ++m)
+    {
+    if (mobs.state [m] != eMobDead || --mobs.timer [m] > 0)
+      continue;
+      
+    const tMobilePrototype & prototype = mobs.prototypes [mobs.proto [m]];
+    mobs.hp [m] = prototype.maxhp;
+    mobs.state [m] = eMobIdle;
+    mobs.timer [m] = WANDER_MIN_TICKS + mobs.Random (WANDER_MAX_TICKS - WANDER_MIN_TICKS + 1);
+    mobs.Link (m, prototype.home);
+    
+    if (roomplayersmap.find (prototype.home) != roomplayersmap.end ())
+      QueueArrival (mobs.Name (m), prototype.home, 0);
+    } // end of each mobile
+} // end of RespawnSystem
+
+void tMobiles::Tick ()
+{
+  // how long each system takes (see the stats command)
+  static const int wanderhistogram     = AddHistogram ("mobile_system", "wander");
+  static const int aggressionhistogram = AddHistogram ("mobile_system", "aggression");
+  static const int combathistogram     = AddHistogram ("mobile_system", "combat");
+  static const int respawnhistogram    = AddHistogram ("mobile_system", "respawn");
+  
+  {
+  tTimer timer (wanderhistogram);
+  WanderSystem (*this);
+  }
+  {
+  tTimer timer (aggressionhistogram);
+  AggressionSystem (*this);
+  }
+  {
+  tTimer timer (combathistogram);
+  CombatSystem (*this);
+  }
+  {
+  tTimer timer (respawnhistogram);
+  RespawnSystem (*this);
+  }
+} // end of tMobiles::Tick
+
+/* ---- things players do to mobiles ---- */
+
+int FindMobileInRoom (const int & vnum, const string & name)
+{
+  for (int m = mobiles.FirstInRoom (vnum); m != NO_MOBILE; m = mobiles.NextInRoom (m))
+    {
+    // any word in its name will do (eg. rat for "a large rat")
+    if (NameMatches (mobiles.Name (m), name))
+      return m;
+    }
+    
+  return NO_MOBILE;
+} // end of FindMobileInRoom
+
+void StartFighting (tPlayer * p, const int & m)
+{
+  StopFighting (p);   // only one at a time
+  p->fighting = m;
+  ++mobiles.fighters [m];
+  mobiles.state [m] = eMobFighting;
+} // end of StartFighting
+
+void StopFighting (tPlayer * p)
+{
+  const int m = p->fighting;
+  if (m == NO_MOBILE)
+    return;
+    
+  p->fighting = NO_MOBILE;
+  if (--mobiles.fighters [m] == 0 && mobiles.state [m] == eMobFighting)
+    mobiles.state [m] = eMobIdle;
+} // end of StopFighting
+
+typedef pair<int, int> tKind;    // prototype, how many
+
+tTempString DescribeMobilesInRoom (const int & vnum)
+{
+  // count each kind, in the order we find them
+  vector<tKind, tArenaAllocator<tKind> > kinds;
+  for (int m = mobiles.FirstInRoom (vnum); m != NO_MOBILE; m = mobiles.NextInRoom (m))
+    {
+    vector<tKind, tArenaAllocator<tKind> >::iterator i = kinds.begin ();
+    while (i != kinds.end () && i->first != mobiles.proto [m])
+      ++i;
+    if (i == kinds.end ())
+      kinds.push_back (make_pair (mobiles.proto [m], 1));
+    else
+      ++i->second;
+    }
+    
+  tTempString result;
+  for (vector<tKind, tArenaAllocator<tKind> >::const_iterator i = kinds.begin (); i != kinds.end (); ++i)
+    {
+    result += tosentence (Temp (mobiles.prototypes [i->first].name));
+    if (i->second > 1)
+      result += MAKE_STRING (" (x" << i->second << ")").c_str ();
+    result += " is here.\n";
+    }
+    
+  return result;
+} // end of DescribeMobilesInRoom
+
+// called from PeriodicUpdates, which might be more often than we want
+void UpdateMobiles ()
+{
+  static struct timeval tLastTick = { 0, 0 };
+  struct timeval now;
+  GetGameTime (now);
+  
+  long elapsed = (now.tv_sec - tLastTick.tv_sec) * 1000000L + 
+                 (now.tv_usec - tLastTick.tv_usec);
+  if (elapsed < MOBILE_TICK_USEC)
+    return;
+    
+  tLastTick = now;
+  mobiles.Tick ();
+} // end of UpdateMobiles
@@ -0,0 +1,89 @@
+#ifndef TINYMUDSERVER_MOBILE_H
+#define TINYMUDSERVER_MOBILE_H
+
+#include <vector>
+#include <map>
+
+#include "arena.h"  // for tTempString
+
+// mobile (NPC) flags, from the mobiles file
+static const unsigned char MOB_WANDER     = 1;  // moves around by itself
+static const unsigned char MOB_AGGRESSIVE = 2;  // attacks players it sees
+
+// what a mobile is doing (its AI state)
+typedef enum
+{
+  eMobIdle,       // nothing in particular - might wander
+  eMobFighting,   // one or more players are fighting it
+  eMobDead        // waiting to respawn at home
+} tMobileStates;
+
+// a kind of mobile (eg. a rat), loaded from the mobiles file
+struct tMobilePrototype
+  {
+  string name;          // what players see (eg. a large rat)
+  int home;             // room they start in and respawn in
+  short maxhp;          // hit points when created
+  unsigned char flags;  // MOB_WANDER etc.
+  };  // end of tMobilePrototype
+
+/*---------------------------------------------- */
+/*  all the mobiles in the game */
+/*---------------------------------------------- */
+
+/* 
+ Mobiles are entities - just an index. Their components are kept in 
+ parallel vectors (structure of arrays) so that each system (wandering, 
+ combat etc.) only reads the vectors it needs, one after the other.
+*/
+
+class tMobiles
+  {
+  std::vector<int> nextInRoom;      // intrusive list of mobiles in each room
+  std::vector<int> prevInRoom;
+  std::map<int, int> roomFirst;     // first mobile in each room
+  unsigned long seed;               // random number state
+
+  public:
+  
+  std::vector<tMobilePrototype> prototypes;
+  
+  // components, one entry per mobile
+  std::vector<int>            proto;     // index into prototypes
+  std::vector<int>            room;      // where it is
+  std::vector<short>          hp;        // hit points left
+  std::vector<unsigned char>  state;     // tMobileStates
+  std::vector<int>            timer;     // ticks until it wanders, or respawns
+  std::vector<unsigned short> fighters;  // how many players are fighting it
+
+  tMobiles () : seed (1) {}
+  
+  int Create (const int & p);               // new mobile from prototype, at home
+  int Count () const { return proto.size (); }
+  const string & Name (const int & m) const { return prototypes [proto [m]].name; }
+  
+  void Link (const int & m, const int & vnum);  // put in room
+  void Unlink (const int & m);                  // take out of room
+  int FirstInRoom (const int & vnum) const;     // NO_MOBILE if none
+  int NextInRoom (const int & m) const { return nextInRoom [m]; }
+  
+  int Random (const int & n);   // 0 to n-1
+  
+  void Tick ();   // run all the systems once
+  };  // end of class tMobiles
+
+// find a mobile in the player's room by name (eg. rat), NO_MOBILE if none
+int FindMobileInRoom (const int & vnum, const string & name);
+
+// player starts fighting a mobile
+void StartFighting (tPlayer * p, const int & m);
+// player stops fighting (eg. leaves the room)
+void StopFighting (tPlayer * p);
+
+// what look shows for mobiles in a room (eg. A rat (x2) is here.)
+tTempString DescribeMobilesInRoom (const int & vnum);
+
+// run the mobile systems if it is time
+void UpdateMobiles ();
+
+#endif // TINYMUDSERVER_MOBILE_H
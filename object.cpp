@@ -0,0 +1,176 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+
+using namespace std; 
+
+#include "utils.h"
+#include "strings.h"
+#include "pool.h"
+#include "object.h"
+#include "globals.h"
+
+// all objects come from here
+static tPool<tObject> objectpool;
+
+void tObjectList::Add (tObject * o)
+{
+  o->owner = this;
+  o->next = NULL;
+  o->prev = last;
+  if (last)
+    last->next = o;
+  else
+    first = o;
+  last = o;
+} // end of tObjectList::Add
+
+void tObjectList::Remove (tObject * o)
+{
+  if (o->prev)
+    o->prev->next = o->next;
+  else
+    first = o->next;
+    
+  if (o->next)
+    o->next->prev = o->prev;
+  else
+    last = o->prev;
+    
+  o->next = o->prev = NULL;
+  o->owner = NULL;
+} // end of tObjectList::Remove
+
+tObject * tObjectList::Find (const string & name) const
+{
+  for (tObject * o = first; o; o = o->next)
+    if (NameMatches (o->proto->name, name))
+      return o;
+  return NULL;
+} // end of tObjectList::Find
+
+tObject * CreateObject (const tObjectPrototype * proto, tObjectList & where)
+{
+  tObject * o = objectpool.Allocate ();
+  o->proto = proto;
+  where.Add (o);
+  return o;
+} // end of CreateObject
+
+void DestroyObject (tObject * o)
+{
+  DestroyObjects (o->contents);
+  if (o->owner)
+    o->owner->Remove (o);
+  objectpool.Free (o);
+} // end of DestroyObject
+
+void DestroyObjects (tObjectList & where)
+{
+  while (!where.Empty ())
+    DestroyObject (where.first);
+} // end of DestroyObjects
+
+void MoveObject (tObject * o, tObjectList & to)
+{
+  if (o->owner)
+    o->owner->Remove (o);
+  to.Add (o);
+} // end of MoveObject
+
+long ObjectCount ()
+{
+  return objectpool.Count ();
+} // end of ObjectCount
+
+typedef pair<const tObjectPrototype *, int> tKind;   // how many of each
+
+tTempString DescribeObjects (const tObjectList & where, const bool inRoom)
+{
+  // count each kind, in the order we find them
+  vector<tKind, tArenaAllocator<tKind> > kinds;
+  for (tObject * o = where.first; o; o = o->next)
+    {
+    vector<tKind, tArenaAllocator<tKind> >::iterator i = kinds.begin ();
+    while (i != kinds.end () && i->first != o->proto)
+      ++i;
+    if (i == kinds.end ())
+      kinds.push_back (make_pair (o->proto, 1));
+    else
+      ++i->second;
+    }
+    
+  tTempString result;
+  for (vector<tKind, tArenaAllocator<tKind> >::const_iterator i = kinds.begin (); 
+       i != kinds.end (); ++i)
+    {
+    result += inRoom ? tosentence (Temp (i->first->name)) : "  " + Temp (i->first->name);
+    if (i->second > 1)
+      result += MAKE_STRING (" (x" << i->second << ")").c_str ();
+    result += inRoom ? " is here.\n" : "\n";
+    }
+    
+  return result;
+} // end of DescribeObjects
+
+void SaveObjects (ostream & os, const tObjectList & where)
+{
+  for (tObject * o = where.first; o; o = o->next)
+    {
+    os << o->proto->vnum << " ";
+    if (!o->contents.Empty ())
+      {
+      os << "{ ";
+      SaveObjects (os, o->contents);
+      os << "} ";
+      }
+    }
+} // end of SaveObjects
+
+void LoadObjects (istream & is, tObjectList & where)
+{
+  tObject * o = NULL;   // the last object loaded, for its contents
+  string word;
+  
+  while (is >> word)
+    {
+    if (word == "}")
+      return;   // end of a container's contents
+      
+    if (word == "{")
+      {
+      // contents of an object we don't know about go here instead
+      LoadObjects (is, o ? o->contents : where);
+      continue;
+      }
+      
+    int vnum = atoi (word.c_str ());
+    tObjectPrototypeMapIterator protoiter = objectprotomap.find (vnum);
+    if (protoiter == objectprotomap.end ())
+      {
+      cerr << "Object " << word << " does not exist" << endl;
+      o = NULL;
+      continue;
+      }
+      
+    o = CreateObject (protoiter->second, where);
+    } // end of reading objects
+    
+} // end of LoadObjects
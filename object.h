@@ -0,0 +1,73 @@
+#ifndef TINYMUDSERVER_OBJECT_H
+#define TINYMUDSERVER_OBJECT_H
+
+#include <map>
+
+#include "arena.h"  // for tTempString
+
+// object flags, from the objects file
+static const unsigned char OBJ_CONTAINER = 1;   // things can be put in it
+
+// a kind of object (eg. a rusty sword), loaded from the objects file
+struct tObjectPrototype
+  {
+  int vnum;             // its number, used in player files
+  string name;          // what players see (eg. a rusty sword)
+  string description;   // what look shows
+  unsigned char flags;  // OBJ_CONTAINER etc.
+  };  // end of tObjectPrototype
+
+// we will use a map of object prototypes, keyed by vnum
+typedef std::map <int, tObjectPrototype*> tObjectPrototypeMap;
+typedef tObjectPrototypeMap::const_iterator tObjectPrototypeMapIterator;
+
+struct tObject;
+
+// the objects in one place (a room, a player's inventory, a container)
+// - an intrusive list, so moving an object from one list to another is O(1)
+class tObjectList
+  {
+  public:
+  
+  tObject * first;
+  tObject * last;
+  
+  tObjectList () : first (NULL), last (NULL) {}
+  
+  bool Empty () const { return first == NULL; }
+  void Add (tObject * o);       // at the end
+  void Remove (tObject * o);
+  tObject * Find (const string & name) const;   // by any word in its name (eg. sword)
+  };  // end of class tObjectList
+
+// an actual object (there may be many of each prototype)
+struct tObject
+  {
+  const tObjectPrototype * proto;   // what sort of thing it is
+  tObject * next;                   // others in the same place
+  tObject * prev;
+  tObjectList * owner;              // the place it is in
+  tObjectList contents;             // things inside it (if a container)
+  
+  tObject () : proto (NULL), next (NULL), prev (NULL), owner (NULL) {}
+  };  // end of tObject
+
+// make a new object in a place
+tObject * CreateObject (const tObjectPrototype * proto, tObjectList & where);
+// get rid of an object, and anything in it
+void DestroyObject (tObject * o);
+// get rid of everything in a place
+void DestroyObjects (tObjectList & where);
+// move from one place to another
+void MoveObject (tObject * o, tObjectList & to);
+// how many objects exist
+long ObjectCount ();
+
+// eg. "A rusty sword (x2) is here.\n" or "  a rusty sword (x2)\n"
+tTempString DescribeObjects (const tObjectList & where, const bool inRoom);
+
+// write prototype numbers, with container contents in braces (eg. 1 3 { 2 2 })
+void SaveObjects (ostream & os, const tObjectList & where);
+void LoadObjects (istream & is, tObjectList & where);
+
+#endif // TINYMUDSERVER_OBJECT_H
@@ -30,22 +30,98 @@ using namespace std;
 #include "strings.h"
 #include "player.h"
 #include "room.h"
+#include "channel.h"
+#include "inputqueue.h"
+#include "editdistance.h"
+#include "playercache.h"
+#include "preauth.h"
+#include "metrics.h"
+#include "journal.h"
+#include "log.h"
 #include "globals.h"
 
+tPlayer::~tPlayer ()
+{
+  ProcessWrite ();    // send outstanding text
+  delete connection;  /* close connection if active */
+  if (connstate == ePlaying)
+    Save ();          // auto-save on close
+  if (waitingFor)
+    waitingFor->Cancel ();    // we won't be around for the result
+  StopLoginTimer (this);
+  Count (eDisconnects);
+  DestroyObjects (inventory);   // saved with the player
+  LeaveChannels (this);   // nobody can talk to us now
+  RemovePlayerFromIndex (this);   // or find us
+} // end of tPlayer::~tPlayer
+
 /* find a player by name */
 
 tPlayer * FindPlayer (const string & name)
 {
-  tPlayerListIterator i =
-    find_if (playerlist.begin (), playerlist.end (), findPlayerName (name));
+  tPlayerNameMapIterator i = playernamemap.find (name);
 
-  if (i == playerlist.end ())
+  if (i == playernamemap.end ())
     return NULL;
   else
-    return *i;
+    return i->second;
   
 } /* end of FindPlayer */
 
+// remove from a room's list of players
+static void RemoveFromRoom (tPlayer * p, const int & vnum)
+{
+  tRoomPlayersMap::iterator roomiter = roomplayersmap.find (vnum);
+  if (roomiter == roomplayersmap.end ())
+    return;
+  
+  vector<tPlayer*> & players = roomiter->second;
+  players.erase (remove (players.begin (), players.end (), p), players.end ());
+  if (players.empty ())
+    roomplayersmap.erase (roomiter);
+} // end of RemoveFromRoom
+
+// player has entered the game - can now be found by name and room
+void AddPlayerToIndex (tPlayer * p)
+{
+  playernamemap [p->playername] = p;
+  playernameindex.Add (p->playername);
+  roomplayersmap [p->room].push_back (p);
+  InvalidateWhoList ();
+} // end of AddPlayerToIndex
+
+// player is leaving - safe to call more than once
+void RemovePlayerFromIndex (tPlayer * p)
+{
+  tPlayerNameMap::iterator i = playernamemap.find (p->playername);
+  if (i == playernamemap.end () || i->second != p)
+    return;   // not in the game
+  
+  playernamemap.erase (i);
+  playernameindex.Remove (p->playername);
+  RemoveFromRoom (p, p->room);
+  StopFighting (p);
+  InvalidateWhoList ();
+} // end of RemovePlayerFromIndex
+
+void tPlayer::ClosePlayer ()
+{
+  closing = true;
+  RemovePlayerFromIndex (this);
+} // end of tPlayer::ClosePlayer
+
+void tPlayer::MoveTo (const int & vnum)
+{
+  tPlayerNameMapIterator i = playernamemap.find (playername);
+  if (i != playernamemap.end () && i->second == this)
+    {
+    RemoveFromRoom (this, room);
+    roomplayersmap [vnum].push_back (this);
+    InvalidateWhoList ();
+    }
+  room = vnum;
+} // end of tPlayer::MoveTo
+
 // member function to find another playing, including myself
 tPlayer * tPlayer::GetPlayer (istream & args, const string & noNameMessage, const bool & notme)
 {
@@ -59,7 +135,12 @@ tPlayer * tPlayer::GetPlayer (istream & args, const string & noNameMessage, cons
   else
     p = FindPlayer (name);
   if (p == NULL)
-    throw runtime_error (MAKE_STRING ("Player " << tocapitals (name) << " is not connected."));
+    {
+    tEditDistance e (name);
+    playernameindex.Suggest (e);
+    throw runtime_error (MAKE_STRING ("Player " << tocapitals (name) << " is not connected."
+                                      << DidYouMean (e)));
+    }
   if (notme && p == this)
     throw runtime_error ("You cannot do that to yourself.");
   return p;  
@@ -68,43 +149,73 @@ tPlayer * tPlayer::GetPlayer (istream & args, const string & noNameMessage, cons
 void tPlayer::ProcessException ()
 {
   /* signals can cause exceptions, don't get too excited. :) */
-  cerr << "Exception on socket " << s << endl;
+  Log (eLogWarning, MAKE_STRING ("Exception on socket " << GetSocket ()));
 } /* end of tPlayer::ProcessException */
 
-void tPlayer::Load ()
+void tPlayer::Load (istream & f)
 {
-  ifstream f ((PLAYER_DIR + playername + PLAYER_EXT).c_str (), ios::in);
-  if (!f)
-    throw runtime_error ("That player does not exist, type 'new' to create a new one.");
-  
   // read player details
   f >> password;
   f >> room;
   f.ignore (numeric_limits<int>::max(), '\n'); // skip rest of this line  
   LoadSet (f, flags);   // player flags (eg. can_shutdown) 
+  LoadSet (f, channels);  // chat channels (eg. newbie)
+  channels.erase ("");  // older player files don't have any
+  
+  // what they are carrying
+  string sLine;
+  getline (f, sLine);
+  istringstream is (sLine);
+  DestroyObjects (inventory);
+  LoadObjects (is, inventory);
+  
+  // aliases - how many, then one per line: <name> <expansion>
+  aliases.Clear ();
+  int count = 0;
+  f >> count;
+  f.ignore (numeric_limits<int>::max(), '\n'); // skip rest of this line  
+  for (int i = 0; i < count && getline (f, sLine); ++i)
+    {
+    pair<string, string> alias = GetWord (sLine);
+    if (!alias.first.empty ())
+      aliases.Add (alias.first, alias.second);
+    }
   
 } /* end of tPlayer::Load */
 
-void tPlayer::Save ()
+void tPlayer::Write (ostream & f) const
 {
-  ofstream f ((PLAYER_DIR + playername + PLAYER_EXT).c_str (), ios::out);
-  if (!f)
-  {
-  cerr << "Could not write to file for player " << playername << endl;
-  return;
-  }
-  
   // write player details
   f << password << endl;
   f << room << endl;
   copy (flags.begin (), flags.end (), ostream_iterator<string> (f, " "));
   f << endl;
+  copy (channels.begin (), channels.end (), ostream_iterator<string> (f, " "));
+  f << endl;
+  SaveObjects (f, inventory);
+  f << endl;
+  vector<pair<string, string> > aliaslist = aliases.List ();
+  f << aliaslist.size () << endl;
+  for (vector<pair<string, string> >::const_iterator i = aliaslist.begin (); 
+       i != aliaslist.end (); ++i)
+    f << i->first << " " << i->second << endl;
+  
+} /* end of tPlayer::Write */
+
+void tPlayer::Save ()
+{
+  ostringstream f;
+  Write (f);
+  
+  playercache.Put (playername, f.str ());   // so they can come back without reading it
+  if (bSavePlayers && !WritePlayerFile (playername, f.str ()))
+    Log (eLogError, "Could not write to file for player " + playername);
   
 } /* end of tPlayer::Save */
 
 void tPlayer::DoCommand (const string & command)
 {
-  istringstream is (command);
+  tTempStream is (Temp (command));
   ProcessCommand (this, is);
 } /* end of tPlayer::Load */
 
@@ -140,25 +251,38 @@ void tPlayer::ProcessRead ()
   // Hopefully this function won't be called recursively.
   static vector<char> buf (1000);  // reserve 1000 bytes for reading into
   
-  int nRead = read (s, &buf [0], buf.size ());
+  int nRead = connection->Read (&buf [0], buf.size ());
   
   if (nRead == -1)
     {
     if (errno != EWOULDBLOCK)
-      perror ("read from player");
+      LogError ("read from player");
     return;
     }
 
   if (nRead <= 0)
     {
-    close (s);
-    cerr << "Connection " << s << " closed" << endl;
-    s = NO_SOCKET;
-    DoCommand ("quit");  // tell others the s/he has left
+    JournalDisconnect (this);
+    LostConnection ();
     return;
     }
 
-  inbuf += string (&buf [0], nRead);    /* add to input buffer */
+  Count (eBytesIn, nRead);
+  AddInput (string (&buf [0], nRead));
+    
+} /* end of tPlayer::ProcessRead */
+
+void tPlayer::LostConnection ()
+{
+  Log (eLogInfo, MAKE_STRING ("Connection " << GetSocket () << " closed"));
+  delete connection;
+  connection = NULL;
+  DoCommand ("quit");  // tell others the s/he has left
+} /* end of tPlayer::LostConnection */
+
+void tPlayer::AddInput (const string & text)
+{
+  inbuf += text;    /* add to input buffer */
 
   /* try to extract lines from the input buffer */
   for ( ; ; )
@@ -170,10 +294,13 @@ void tPlayer::ProcessRead ()
     string sLine = inbuf.substr (0, i);  /* extract first line */
     inbuf = inbuf.substr (i + 1, string::npos); /* get rest of string */
 
-    ProcessPlayerInput (this, Trim (sLine));  /* now, do something with it */        
+    sLine = Trim (sLine);
+    JournalLine (this, sLine);
+    QueuePlayerInput (this, sLine);  /* do something with it at the end of the tick */
+    Count (eLinesIn);
     }
     
-} /* end of tPlayer::ProcessRead */
+} /* end of tPlayer::AddInput */
 
 /* Here when we can send stuff to the player. We are allowing for large
  volumes of output that might not be sent all at once, so whatever cannot
@@ -182,25 +309,26 @@ void tPlayer::ProcessRead ()
 void tPlayer::ProcessWrite ()
 {
   /* we will loop attempting to write all in buffer, until write blocks */
-  while (s != NO_SOCKET && !outbuf.empty ())
+  while (connection && !outbuf.empty ())
     {
 
     // send a maximum of 512 at a time
     int iLength = min<int> (outbuf.size (), 512);
 
     // send to player
-    int nWrite = write (s, outbuf.c_str (), iLength );
+    int nWrite = connection->Write (outbuf.c_str (), iLength );
 
     // check for bad write
     if (nWrite < 0)
       {
       if (errno != EWOULDBLOCK )
-        perror ("send to player");  /* some other error? */
+        LogError ("send to player");  /* some other error? */
       return;
       }
 
     // remove what we successfully sent from the buffer
     outbuf.erase (0, nWrite);
+    Count (eBytesOut, nWrite);
       
     // if partial write, exit
     if (nWrite < iLength)
@@ -210,15 +338,16 @@ void tPlayer::ProcessWrite ()
 
 }   /* end of tPlayer::ProcessWrite  */
 
-// functor for sending messages to all players
+// functor for sending messages to all players (any kind of string)
+template <typename S>
 struct sendToPlayer
 {
-  const string message;
+  const S & message;
   const tPlayer * except;
   const int room;
   
   // ctor
-  sendToPlayer (const string & m, const tPlayer * e = NULL, const int r = 0) 
+  sendToPlayer (const S & m, const tPlayer * e = NULL, const int r = 0) 
       : message (m), except (e), room (r) {}
   // send to this player
   void operator() (tPlayer * p) 
@@ -231,9 +360,35 @@ struct sendToPlayer
 // send message to all connected players
 // possibly excepting one (eg. the player who said something)
 // possibly only in one room (eg. for saying in a room)
-void SendToAll (const string & message, const tPlayer * ExceptThis, const int InRoom)
+template <typename S>
+static void SendToEveryone (const S & message, const tPlayer * ExceptThis, const int InRoom)
 {
+  // only one room? we know who is there
+  if (InRoom)
+    {
+    tRoomPlayersMapIterator roomiter = roomplayersmap.find (InRoom);
+    if (roomiter != roomplayersmap.end ())
+      for_each (roomiter->second.begin (), roomiter->second.end (), 
+                sendToPlayer<S> (message, ExceptThis, InRoom)); 
+    return;
+    }
+    
   for_each (playerlist.begin (), playerlist.end (), 
-            sendToPlayer (message, ExceptThis, InRoom)); 
+            sendToPlayer<S> (message, ExceptThis, InRoom)); 
+} /* end of SendToEveryone */
+
+void SendToAll (const string & message, const tPlayer * ExceptThis, const int InRoom)
+{
+  SendToEveryone (message, ExceptThis, InRoom);
+} /* end of SendToAll */
+
+void SendToAll (const tTempString & message, const tPlayer * ExceptThis, const int InRoom)
+{
+  SendToEveryone (message, ExceptThis, InRoom);
+} /* end of SendToAll */
+
+void SendToAll (const char * message, const tPlayer * ExceptThis, const int InRoom)
+{
+  SendToEveryone (message, ExceptThis, InRoom);
 } /* end of SendToAll */
 
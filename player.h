@@ -3,10 +3,18 @@
 
 #include <set>
 #include <list>
+#include <deque>
+#include <map>
+#include <vector>
 
-#include <unistd.h>   // for close
+#include <time.h>     // for time_t
 #include "strings.h"  // for ciLess
 #include "constants.h"  // for NO_SOCKET
+#include "connection.h" // for the player's connection
+#include "object.h"   // for inventory
+#include "alias.h"    // for aliases
+
+class tAsyncJob;
 
 // connection states - add more to have more complex connection dialogs 
 typedef enum
@@ -18,6 +26,9 @@ typedef enum
   eAwaitingNewPassword, // we want a new password
   eConfirmPassword,     // confirm the new password
   
+  eLoadingPlayer,       // player file being read (or looked for) in the background
+  eCheckingPassword,    // password being hashed or checked in the background
+  
   ePlaying              // this is the normal 'connected' mode
 } tConnectionStates;
 
@@ -28,7 +39,7 @@ typedef enum
 class tPlayer
 {
 private:
-  int s;              // socket they connected on
+  tConnection * connection; // how we talk to them, NULL once they have gone
   int port;           // port they connected on
  
   string outbuf;      // pending output
@@ -42,38 +53,52 @@ public:
   string password;    // their password
   int badPasswordCount;   // password guessing attempts
   int room;         // what room they are in
+  int fighting;     // mobile they are fighting, or NO_MOBILE
   bool closing;     // true if they are about to leave us
+  bool batching;    // true while running several commands from one line
+  bool pendingLook; // moved during a batch, look when it finishes
   std::set<string, ciLess> flags;  // player flags
-
-  tPlayer (const int sock, const int p, const string a) 
-    : s (sock), port (p), address (a), closing (false)  
+  std::set<string, ciLess> channels;  // chat channels they listen to
+  tObjectList inventory;  // what they are carrying
+  tAliasTrie aliases;     // their aliases (eg. gs = get sword)
+  tAsyncJob * waitingFor; // background job that will finish their login, or NULL
+  std::deque<string> typeahead; // input that arrived while waiting for it
+  bool timingLogin;       // true until they are playing (see preauth.h)
+  time_t loginDeadline;   // closed if they aren't playing by then
+  std::list<tPlayer*>::iterator loginTimer;   // where they are in the login timers
+  unsigned long journalId;  // their connection in the session journal, or 0 (see journal.h)
+
+  tPlayer (tConnection * c, const int p, const string a) 
+    : connection (c), port (p), address (a), closing (false), waitingFor (NULL), timingLogin (false), journalId (0)  
       { Init (); } // ctor
   
-  ~tPlayer () // dtor
-    {
-    ProcessWrite ();    // send outstanding text
-    if (s != NO_SOCKET) /* close connection if active */
-      close (s);
-    if (connstate == ePlaying)
-      Save ();          // auto-save on close
-    };
+  ~tPlayer (); // dtor
   
   void Init ()
     {
     connstate = eAwaitingName;
     room = INITIAL_ROOM;
+    fighting = NO_MOBILE;
+    batching = false;
+    pendingLook = false;
     flags.clear ();
-    prompt = "Enter your name, or 'new' to create a new character ...  "; 
+    channels.clear ();
+    DestroyObjects (inventory);
+    aliases.Clear ();
+    prompt = NAME_PROMPT; 
     }
     
   // what's our socket?
-  int GetSocket () const { return s; }
+  int GetSocket () const { return connection ? connection->Socket () : NO_SOCKET; }
   // true if connected at all
-  bool Connected () const { return s != NO_SOCKET; }
+  bool Connected () const { return connection != NULL; }
   // true if this player actively playing
   bool IsPlaying () const { return Connected () && connstate == ePlaying && !closing; }
   // true if we have something to send them
   bool PendingOutput () const { return !outbuf.empty (); }
+  // what is waiting to go to them, and the part line from them (for copyover)
+  const string & GetPendingOutput () const { return outbuf; }
+  const string & GetPendingInput () const { return inbuf; }
 
   // output to player (any type)
   template<typename T>
@@ -83,12 +108,36 @@ public:
     return *this; 
     }
   
-  void ClosePlayer () { closing = true; }    // close this player's connection
+  // output to player (string, no conversion needed)
+  tPlayer & operator<< (const string & i)  
+    {     
+    outbuf += i; 
+    return *this; 
+    }
+  
+  tPlayer & operator<< (const char * i)  
+    {     
+    outbuf += i; 
+    return *this; 
+    }
+  
+  // (a copy - the temporary is gone at the end of the tick)
+  tPlayer & operator<< (const tTempString & i)  
+    {     
+    outbuf.append (i.data (), i.size ()); 
+    return *this; 
+    }
+  
+  void ClosePlayer ();    // close this player's connection
+  void MoveTo (const int & vnum);   // change room, keeping the room index up to date
   
   void ProcessRead ();    // get player input
+  void LostConnection (); // they closed the connection
+  void AddInput (const string & text);  // split into lines, queue them for the end of the tick
   void ProcessWrite ();   // output outstanding text
   void ProcessException (); // exception on socket
-  void Load ();           // load player from disk
+  void Load (istream & f);  // load player from their player file
+  void Write (ostream & f) const;   // what goes in their player file
   void Save ();           // save player to disk
 
   tPlayer * GetPlayer (istream & sArgs, 
@@ -101,6 +150,7 @@ public:
   
   void DoCommand (const string & command);  // simulate player input (eg. look)
   string GetAddress () const { return address; }  // return player IP address
+  int GetPort () const { return port; }           // and the port they connected on
   
 };
   
@@ -144,23 +194,27 @@ class player_output_iterator : public std::iterator <std::output_iterator_tag, v
 // an action handler (commands, connection states)
 typedef void (*tHandler) (tPlayer * p, istream & args) ;
 
-// functor to help finding a player by name
-struct findPlayerName
-{
-  const string name;
-  // ctor
-  findPlayerName (const string & n) : name ( n ) {} 
-  // check for player with correct name, and actually playing
-  bool operator() (const tPlayer * p) const
-    {
-    return p->IsPlaying () && ciStringEqual (p->playername, name);
-    } // end of operator()  
-};  // end of findPlayerName
+// players in the game, by name
+typedef std::map <string, tPlayer*, ciLess> tPlayerNameMap;
+typedef tPlayerNameMap::const_iterator tPlayerNameMapIterator;
+
+// players in the game, by room, in the order they arrived
+typedef std::map <int, std::vector<tPlayer*> > tRoomPlayersMap;
+typedef tRoomPlayersMap::const_iterator tRoomPlayersMapIterator;
 
 // find a player by name
 tPlayer * FindPlayer (const string & name);
+void AddPlayerToIndex (tPlayer * p);        // they entered the game
+void RemovePlayerFromIndex (tPlayer * p);   // they left it
+void InvalidateWhoList ();  // who list needs rebuilding (in commands.cpp)
 void ProcessCommand (tPlayer * p, istream & sArgs);
+void ProcessCommandLine (tPlayer * p, istream & sArgs);
+bool TakesRestOfLine (const string & command);   // eg. say - its text isn't split at semicolons
 void ProcessPlayerInput (tPlayer * p, const string & s);
+void PlayerEnteredGame (tPlayer * p, const string & message);   // they have logged in
+int StateHistogram (const tConnectionStates state);   // metrics id for timing a state
 void SendToAll (const string & message, const tPlayer * ExceptThis = NULL, const int InRoom = 0);
+void SendToAll (const tTempString & message, const tPlayer * ExceptThis = NULL, const int InRoom = 0);
+void SendToAll (const char * message, const tPlayer * ExceptThis = NULL, const int InRoom = 0);
 
 #endif // TINYMUDSERVER_PLAYER_H
@@ -0,0 +1,89 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace std; 
+
+#include "constants.h"
+#include "strings.h"
+#include "playercache.h"
+
+bool tPlayerCache::Find (const string & name, string & text)
+{
+  map<string, tEntries::iterator, ciLess>::const_iterator i = index.find (name);
+  if (i == index.end ())
+    return false;
+    
+  entries.splice (entries.begin (), entries, i->second);  // now the most recent
+  text = i->second->second;
+  return true;
+} // end of tPlayerCache::Find
+
+void tPlayerCache::Put (const string & name, const string & text)
+{
+  map<string, tEntries::iterator, ciLess>::iterator i = index.find (name);
+  if (i != index.end ())
+    {
+    i->second->second = text;
+    entries.splice (entries.begin (), entries, i->second);
+    return;
+    }
+    
+  entries.push_front (make_pair (name, text));
+  index [name] = entries.begin ();
+  
+  // forget the least recently used
+  if (entries.size () > capacity)
+    {
+    index.erase (entries.back ().first);
+    entries.pop_back ();
+    }
+} // end of tPlayerCache::Put
+
+bool ReadPlayerFile (const string & name, string & text)
+{
+  ifstream f ((PLAYER_DIR + name + PLAYER_EXT).c_str (), ios::in);
+  if (!f)
+    return false;
+    
+  ostringstream os;
+  os << f.rdbuf ();
+  text = os.str ();
+  return true;
+} // end of ReadPlayerFile
+
+bool PlayerFileExists (const string & name)
+{
+  return access ((PLAYER_DIR + name + PLAYER_EXT).c_str (), F_OK) == 0;
+} // end of PlayerFileExists
+
+bool WritePlayerFile (const string & name, const string & text)
+{
+  // write a new file then rename it, so a reader never sees half a file
+  const string filename = PLAYER_DIR + name + PLAYER_EXT;
+  const string newname = filename + ".new";
+  {
+  ofstream f (newname.c_str (), ios::out);
+  if (!f || !(f << text) || !f.flush ())
+    return false;
+  }
+  return rename (newname.c_str (), filename.c_str ()) == 0;
+} // end of WritePlayerFile
@@ -0,0 +1,46 @@
+#ifndef TINYMUDSERVER_PLAYERCACHE_H
+#define TINYMUDSERVER_PLAYERCACHE_H
+
+#include <list>
+#include <map>
+
+/*---------------------------------------------- */
+/*  player cache - recently used player files     */
+/*---------------------------------------------- */
+
+/*
+ Keeps the text of the most recently loaded or saved player files, so
+ someone who drops and reconnects doesn't need the disk at all. Saving
+ writes through to it, so it is never older than the file. Main thread only.
+*/
+
+class tPlayerCache
+  {
+  typedef std::list<std::pair<string, string> > tEntries;   // name, file text - most recent first
+  
+  tEntries entries;
+  std::map<string, tEntries::iterator, ciLess> index;       // name -> entry
+  unsigned int capacity;
+  
+  public:
+  
+  tPlayerCache (const unsigned int size) : capacity (size) {}
+  
+  // true (and the file text) if we have it - makes it the most recent
+  bool Find (const string & name, string & text);
+  // remember the latest text of a player file
+  void Put (const string & name, const string & text);
+  // true if we have it (without making it the most recent)
+  bool Contains (const string & name) const { return index.find (name) != index.end (); }
+  };  // end of class tPlayerCache
+
+// read a whole player file - false if there isn't one (safe on any thread)
+bool ReadPlayerFile (const string & name, string & text);
+
+// is there a file for that player? (safe on any thread)
+bool PlayerFileExists (const string & name);
+
+// write a whole player file, replacing the old one in one step
+bool WritePlayerFile (const string & name, const string & text);
+
+#endif // TINYMUDSERVER_PLAYERCACHE_H
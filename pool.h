@@ -0,0 +1,83 @@
+#ifndef TINYMUDSERVER_POOL_H
+#define TINYMUDSERVER_POOL_H
+
+#include <vector>
+#include <new>
+
+/*---------------------------------------------- */
+/*  pool - allocates lots of objects of one type */
+/*---------------------------------------------- */
+
+/*
+ Objects are carved out of large blocks, so there is one call to "new" 
+ per block rather than per object. Freed objects go on a free list 
+ (linked through the freed memory itself) and are reused first.
+*/
+
+template <typename T, int BLOCK_SIZE = 1024>
+class tPool
+  {
+  // a freed slot - overlays the object's memory
+  union tSlot
+    {
+    tSlot * nextFree;
+    char storage [sizeof (T)];
+    double align;   // make sure the storage is suitably aligned
+    };
+    
+  std::vector<tSlot*> blocks;   // all the memory we got
+  tSlot * freelist;             // slots ready for reuse
+  int used;                     // slots used in the last block
+  long count;                   // objects in use
+  
+  // not copyable
+  tPool (const tPool &);
+  tPool & operator= (const tPool &);
+  
+  public:
+  
+  tPool () : freelist (NULL), used (BLOCK_SIZE), count (0) {}
+  
+  // objects still in use are not destroyed, just their memory is released
+  ~tPool ()
+    {
+    for (typename std::vector<tSlot*>::iterator i = blocks.begin (); i != blocks.end (); ++i)
+      delete [] *i;
+    }
+  
+  // a new, default-constructed, object
+  T * Allocate ()
+    {
+    tSlot * slot;
+    if (freelist)
+      {
+      slot = freelist;
+      freelist = freelist->nextFree;
+      }
+    else
+      {
+      if (used == BLOCK_SIZE)
+        {
+        blocks.push_back (new tSlot [BLOCK_SIZE]);
+        used = 0;
+        }
+      slot = &blocks.back () [used++];
+      }
+    ++count;
+    return new (slot->storage) T ();
+    }
+    
+  // destroy it, and keep the memory for next time
+  void Free (T * p)
+    {
+    p->~T ();
+    tSlot * slot = reinterpret_cast<tSlot *> (p);
+    slot->nextFree = freelist;
+    freelist = slot;
+    --count;
+    }
+    
+  long Count () const { return count; }   // objects in use
+  };  // end of class tPool
+  
+#endif // TINYMUDSERVER_POOL_H
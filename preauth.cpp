@@ -0,0 +1,255 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+// standard library includes ...
+
+#include <string>
+#include <iostream>
+
+using namespace std; 
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "globals.h"
+#include "pool.h"
+#include "preauth.h"
+#include "metrics.h"
+#include "journal.h"
+#include "gameclock.h"
+#include "log.h"
+#include "gatewaylink.h"
+
+static tPool<tPendingConnection> pendingpool;   // memory for pending connections
+static unsigned int pendingCount = 0;          // ones with a socket still open
+
+// players who are still logging in, in order of deadline
+static tPlayerList logintimers;
+
+void ClosePending (tPendingConnection * c)
+{
+  if (c->gateway)
+    CloseGatewayConnection (c->gateway);
+  else
+    close (c->s);
+  c->s = NO_SOCKET;
+  c->gateway = 0;
+  --pendingCount;
+  Count (eDisconnects);
+} // end of ClosePending
+
+string Greeting ()
+{
+  return "\nWelcome to the Tiny MUD Server version " + VERSION + "\n" 
+         + messagemap ["welcome"]    // message from message file
+         + NAME_PROMPT;              // initial prompt (Enter your name ...)
+} // end of Greeting
+
+// send them something - we don't keep a copy, it goes now or not at all
+static void SendPending (const tPendingConnection * c, const string & text)
+{
+  if (c->gateway)
+    {
+    SendToGateway (c->gateway, text);
+    return;
+    }
+    
+  // the socket buffer is empty for the greeting, so that will all go
+  const int nWrite = write (c->s, text.c_str (), text.size ());
+  if (nWrite == -1 && errno != EWOULDBLOCK)
+    LogError ("send to new connection");
+  if (nWrite > 0)
+    Count (eBytesOut, nWrite);
+} // end of SendPending
+
+// a new one, waiting for their name - NULL if there are too many already
+static tPendingConnection * NewPending (const struct in_addr & address, const unsigned short port)
+{
+  if (pendingCount >= MAX_PENDING_CONNECTIONS)
+    {
+    Log (eLogWarning, MAKE_STRING ("Too many connections waiting to log in, rejected one from " 
+                                   << inet_ntoa (address)));
+    return NULL;
+    }
+    
+  tPendingConnection * c = pendingpool.Allocate ();
+  c->address = address;
+  c->port = port;
+  c->deadline = GameTime () + PREAUTH_TIMEOUT;
+  pendingconnections.push_back (c);
+  ++pendingCount;
+  return c;
+} // end of NewPending
+
+void AddPendingConnection (const int s, const struct sockaddr_in & sa)
+{
+  tPendingConnection * c = NewPending (sa.sin_addr, ntohs (sa.sin_port));
+  if (c == NULL)
+    {
+    close (s);
+    return;
+    }
+  c->s = s;
+  SendPending (c, Greeting ());
+} // end of AddPendingConnection
+
+tPendingConnection * AddGatewayPending (const uint32_t connection, 
+                                        const struct in_addr & address, const unsigned short port)
+{
+  tPendingConnection * c = NewPending (address, port);
+  if (c == NULL)
+    return NULL;
+  c->gateway = connection;
+  SendPending (c, Greeting ());
+  return c;
+} // end of AddGatewayPending
+
+// they have sent their name (and whatever followed it) - now they need the full player treatment
+static tPlayer * PromotePending (tPendingConnection * c, const string & input)
+{
+  // sending names over and over? (guessing passwords, perhaps)
+  if (!throttle.AllowLogin (IPv4Address (c->address)))
+    {
+    SendPending (c, "\nToo many logins from your address, try again later.\n");
+    Count (eThrottled);
+    ClosePending (c);
+    return NULL;
+    }
+    
+  tConnection * connection = c->gateway ? NewGatewayConnection (c->gateway) 
+                                        : new tSocketConnection (c->s);
+  tPlayer * p = new tPlayer (connection, c->port, inet_ntoa (c->address));
+  playerlist.push_back (p);
+  StartLoginTimer (p);
+  JournalConnect (p);
+  p->AddInput (input);
+  
+  c->s = NO_SOCKET;   // the player has the connection now
+  c->gateway = 0;
+  --pendingCount;
+  return p;
+} // end of PromotePending
+
+void ProcessPendingRead (tPendingConnection * c)
+{
+  int nRead = read (c->s, &c->input [c->used], PREAUTH_INPUT_LIMIT - c->used);
+  
+  if (nRead == -1)
+    {
+    if (errno != EWOULDBLOCK)
+      LogError ("read from new connection");
+    return;
+    }
+    
+  if (nRead == 0)
+    {
+    ClosePending (c);   // gone without a word
+    return;
+    }
+    
+  c->used += nRead;
+  Count (eBytesIn, nRead);
+  
+  // not a whole line yet?
+  if (memchr (c->input, '\n', c->used) == NULL)
+    {
+    if (c->used >= PREAUTH_INPUT_LIMIT)
+      {
+      Log (eLogWarning, MAKE_STRING ("Connection from " << inet_ntoa (c->address) 
+                                     << " sent too much before its name"));
+      ClosePending (c);
+      }
+    return;
+    }
+    
+  PromotePending (c, string (c->input, c->used));
+} // end of ProcessPendingRead
+
+tPlayer * ProcessGatewayPendingInput (tPendingConnection * c, const string & text)
+{
+  Count (eBytesIn, text.size ());
+  
+  // the gateway reads more at once than we would, so the line can end in this lot
+  if (text.find ('\n') != string::npos)
+    return PromotePending (c, string (c->input, c->used) + text);
+    
+  if (c->used + text.size () >= PREAUTH_INPUT_LIMIT)
+    {
+    Log (eLogWarning, MAKE_STRING ("Connection from " << inet_ntoa (c->address) 
+                                   << " sent too much before its name"));
+    ClosePending (c);
+    return NULL;
+    }
+  memcpy (&c->input [c->used], text.data (), text.size ());
+  c->used += text.size ();
+  return NULL;
+} // end of ProcessGatewayPendingInput
+
+void StartLoginTimer (tPlayer * p)
+{
+  p->loginDeadline = GameTime () + LOGIN_TIMEOUT;
+  p->loginTimer = logintimers.insert (logintimers.end (), p);
+  p->timingLogin = true;
+} // end of StartLoginTimer
+
+void StopLoginTimer (tPlayer * p)
+{
+  if (!p->timingLogin)
+    return;
+  logintimers.erase (p->loginTimer);
+  p->timingLogin = false;
+} // end of StopLoginTimer
+
+void CheckLoginDeadlines ()
+{
+  const time_t now = GameTime ();
+  
+  // connections that never sent a name (or did, and are now players)
+  while (!pendingconnections.empty () && 
+        (!pendingconnections.front ()->Open () || pendingconnections.front ()->deadline <= now))
+    {
+    tPendingConnection * c = pendingconnections.front ();
+    pendingconnections.pop_front ();
+    if (c->Open ())
+      ClosePending (c);
+    pendingpool.Free (c);
+    }
+    
+  // players who haven't finished logging in
+  while (!logintimers.empty () && logintimers.front ()->loginDeadline <= now)
+    {
+    tPlayer * p = logintimers.front ();
+    StopLoginTimer (p);
+    *p << "\nYou took too long to log in.\n";
+    p->ClosePlayer ();
+    }
+} // end of CheckLoginDeadlines
+
+void ClosePendingConnections ()
+{
+  for (tPendingConnections::const_iterator i = pendingconnections.begin (); 
+       i != pendingconnections.end (); ++i)
+    {
+    if ((*i)->Open ())
+      ClosePending (*i);
+    pendingpool.Free (*i);
+    }
+  pendingconnections.clear ();
+} // end of ClosePendingConnections
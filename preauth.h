@@ -0,0 +1,70 @@
+#ifndef TINYMUDSERVER_PREAUTH_H
+#define TINYMUDSERVER_PREAUTH_H
+
+#include <deque>
+#include <time.h>
+#include <netinet/in.h>
+#include <stdint.h>
+
+/*---------------------------------------------- */
+/*  connections that haven't logged in yet        */
+/*---------------------------------------------- */
+
+/*
+ A new connection doesn't get a tPlayer until it sends its name - port
+ scanners and half-open clients never do, so they only cost one of these.
+ Everyone has to get through the login within a fixed time, so the
+ deadlines come in the order the connections did, and checking them
+ only looks at the front of a queue. Connections held by the gateway (see
+ gatewaylink.h) wait here too - with the gateway's number for them rather
+ than a socket, and their input passed on by ProcessGateway.
+*/
+
+struct tPendingConnection
+  {
+  int s;                            // socket, NO_SOCKET once closed or promoted to a player
+  struct in_addr address;           // where from
+  unsigned short port;
+  unsigned short used;              // bytes in input
+  uint32_t gateway;                 // or the gateway's number for it (0 if not from the gateway)
+  time_t deadline;                  // closed if no name by then
+  char input [PREAUTH_INPUT_LIMIT]; // what they have sent so far
+  
+  tPendingConnection () : s (NO_SOCKET), port (0), used (0), gateway (0), deadline (0) {}
+  
+  // still waiting for their name?
+  bool Open () const { return s != NO_SOCKET || gateway != 0; }
+  };  // end of tPendingConnection
+
+// in order of deadline
+typedef std::deque<tPendingConnection*> tPendingConnections;
+
+// what a new connection is sent
+string Greeting ();
+
+// just accepted - greet them and wait for their name
+void AddPendingConnection (const int s, const struct sockaddr_in & sa);
+
+// they have sent something - once it's a whole line they become a player
+void ProcessPendingRead (tPendingConnection * c);
+
+// the same for the gateway's connections - NULL if there are too many waiting already
+tPendingConnection * AddGatewayPending (const uint32_t connection, 
+                                        const struct in_addr & address, const unsigned short port);
+// what they sent, from the gateway - the new player once it's a whole line, otherwise NULL
+tPlayer * ProcessGatewayPendingInput (tPendingConnection * c, const string & text);
+
+// hang up on one (eg. they have gone)
+void ClosePending (tPendingConnection * c);
+
+// the login timer runs from when they send their name until they are playing
+void StartLoginTimer (tPlayer * p);
+void StopLoginTimer (tPlayer * p);
+
+// close connections that have taken too long to log in
+void CheckLoginDeadlines ();
+
+// close all of them (eg. at shutdown)
+void ClosePendingConnections ();
+
+#endif // TINYMUDSERVER_PREAUTH_H
@@ -31,3 +31,35 @@ tRoom * FindRoom (const int & vnum)
 
   return roomiter->second;
 }
+
+const string & tRoom::Render ()
+{
+  if (!rendered.empty ())
+    return rendered;
+    
+  rendered = description;
+  
+  // show available exits
+  if (!exits.empty ())
+    {
+    rendered += "Exits: ";
+    for (tExitMap::const_iterator exititer = exits.begin ();
+         exititer != exits.end (); ++exititer)
+      rendered += exititer->first + " ";
+    rendered += "\n";        
+    }
+  
+  return rendered;
+} // end of tRoom::Render
+
+void tRoom::AddExit (const string & dir, const int & vnum)
+{
+  exits [dir] = vnum;
+  Invalidate ();
+} // end of tRoom::AddExit
+
+void tRoom::RemoveExit (const string & dir)
+{
+  exits.erase (dir);
+  Invalidate ();
+} // end of tRoom::RemoveExit
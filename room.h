@@ -3,19 +3,34 @@
 
 #include <map>
 
+#include "object.h"   // for objects in the room
+
 // map of exits for rooms
 typedef std::map<string, int> tExitMap;
 
 // a room (vnum of room is in the room map)
 class tRoom   
   {
+  string rendered;      // description and exits, as shown by look
+  
   public:
   
   string description;   // what it looks like
-  tExitMap exits;       // map of exits
+  tExitMap exits;       // map of exits - use AddExit/RemoveExit to change
+  tObjectList contents; // objects lying here
 
   // ctor
   tRoom (const string & s) : description (s) {}
+  // dtor
+  ~tRoom () { DestroyObjects (contents); }
+  
+  // what "look" shows, apart from who is here - built once and reused
+  const string & Render ();
+  // throw away the rendered version (eg. description changed)
+  void Invalidate () { rendered.erase (); }
+  
+  void AddExit (const string & dir, const int & vnum);
+  void RemoveExit (const string & dir);
   };  // end of class tRoom
 
 // we will use a map of rooms
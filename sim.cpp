@@ -0,0 +1,633 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+/*
+
+ Simulation - the game without the network.
+
+ Loads the world, puts N players in it on virtual connections (see
+ connection.h), and runs ticks: each player sends some commands (look, say,
+ emote, move, tell, who), then the commands are run and the output is
+ collected, just as the main loop does. Nothing goes near a socket, and the
+ game's clock moves one poll timeout each tick, so this measures the game
+ logic alone - commands per second, how much output they fan out to, and
+ how many times they call "new" (this program replaces it, to count them).
+
+   make sim
+   ./sim -n 1000 -t 200
+
+ Or, instead of the mix of commands, one part of the game on its own:
+
+   ./sim -C 10000 -t 1000      a post a tick to a chat channel 10000 listen to
+   
+ "./sim -m 100000" adds that many mobiles, and reports how long each of the
+ mobile systems (wander, aggression, combat, respawn) takes per mobile tick.
+
+ "./sim -l 500" is a reconnect storm: 500 players, whose files are not in the
+ player cache, all send their name and password at once. It reports logins
+ per second, and the longest the main thread was busy at a time (the files
+ are read, and passwords checked, on the background threads).
+
+ And "./sim -s" runs the same ticks twice - room commands one by one, then in
+ parallel (see inputqueue.cpp) - and checks that everyone was sent the same.
+
+*/
+
+#include <sys/wait.h>
+#include <time.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <poll.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <new>
+
+using namespace std; 
+
+#include "utils.h"
+#include "constants.h"
+#include "player.h"
+#include "globals.h"
+#include "broadcast.h"
+#include "inputqueue.h"
+#include "gameclock.h"
+#include "metrics.h"
+#include "arena.h"
+#include "kdf.h"
+
+void LoadThings ();
+void PeriodicUpdates ();
+void RemoveInactivePlayers ();
+
+// what we measure
+typedef enum
+  {
+  ePeriodic,    // PeriodicUpdates
+  eInput,       // RunQueuedInput
+  eRoomEvents,  // FlushRoomEvents
+  eOutput,      // ProcessWrite for everyone
+  
+  PHASE_COUNT   // must be last
+  } tPhase;
+  
+static const char * phasenames [PHASE_COUNT] = 
+  { "periodic updates", "run queued input", "flush room events", "output" };
+
+// posts to the channel between sending the listeners what they have been sent (-C)
+static const int CHANNEL_FLUSH_POSTS = 10;
+
+// what the reconnecting players' password is (-l)
+static const string STORM_PASSWORD = "swordfish";
+
+// every allocation the game makes (strings, streams, containers) comes through here
+static uint64_t allocations = 0;
+
+void * operator new (size_t size)
+{
+  __atomic_add_fetch (&allocations, 1, __ATOMIC_RELAXED);   // commands can run on worker threads
+  void * p = malloc (size ? size : 1);
+  if (p == NULL)
+    throw bad_alloc ();
+  return p;
+} // end of operator new
+
+void operator delete (void * p) throw ()
+{
+  free (p);
+} // end of operator delete
+
+// the sized one, which the compiler uses when it knows the size - otherwise it would go to the library's
+void operator delete (void * p, size_t) throw ()
+{
+  free (p);
+} // end of operator delete
+
+static double Now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+} // end of Now
+
+// same sequence every run (xorshift)
+static uint32_t seed = 12345;
+static unsigned int Random (const unsigned int n)
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed % n;
+} // end of Random
+
+// something a player might type
+static string PickCommand (const tPlayer * p, const int players)
+{
+  const unsigned int r = Random (100);
+  
+  if (r < 25)
+    return "look";
+  if (r < 50)
+    return "say Hello there, how is everyone?";
+  if (r < 60)
+    return "emote waves.";
+  if (r < 70)
+    return MAKE_STRING ("tell Sim" << (Random (players) + 1) << " Meet me at the fountain.");
+  if (r < 75)
+    return "who";
+    
+  // move somewhere they can go
+  tRoom * room = FindRoom (p->room);
+  if (room == NULL || room->exits.empty ())
+    return "look";
+  tExitMap::const_iterator exititer = room->exits.begin ();
+  advance (exititer, Random (room->exits.size ()));
+  return exititer->first;
+} // end of PickCommand
+
+// everyone is sent what they have waiting, and it is thrown away
+static void Flush (const vector<tPlayer *> & players, const vector<tVirtualConnection *> & connections,
+                   uint64_t & outputBytes)
+{
+  for (vector<tPlayer *>::const_iterator i = players.begin (); i != players.end (); ++i)
+    (*i)->ProcessWrite ();
+  for (vector<tVirtualConnection *>::const_iterator i = connections.begin (); 
+       i != connections.end (); ++i)
+    {
+    outputBytes += (*i)->output.size ();
+    (*i)->output.clear ();
+    }
+} // end of Flush
+
+// one player posts to a chat channel each tick, which lots of others listen to (-C)
+static int ChannelBenchmark (tPlayer * sender, const int listeners, const int ticks)
+{
+  if (channelmap.empty ())
+    {
+    cerr << "There are no chat channels (see the control file)" << endl;
+    return 1;
+    }
+  tChannel * c = channelmap.begin ()->second;
+  
+  // the listeners only need to be playing - they aren't in a room
+  vector<tPlayer *> players;
+  vector<tVirtualConnection *> connections;
+  for (int i = 1; i <= listeners; ++i)
+    {
+    tVirtualConnection * v = new tVirtualConnection;
+    tPlayer * p = new tPlayer (v, 0, "simulation");
+    p->playername = MAKE_STRING ("Listener" << i);
+    p->connstate = ePlaying;
+    p->channels.insert (c->name);
+    c->Subscribe (p);
+    players.push_back (p);
+    connections.push_back (v);
+    }
+  sender->channels.insert (c->name);
+  c->Subscribe (sender);
+  
+  cout << "Posting " << ticks << " messages to the " << c->name << " channel, which " 
+       << c->subscribers.size () << " players listen to ..." << endl;
+  
+  const string post = c->name + " Anyone want to buy a sword? Going cheap.\n";
+  double elapsed = 0;
+  uint64_t outputBytes = 0;
+  for (int t = 0; t < ticks; ++t)
+    {
+    sender->AddInput (post);
+    const double start = Now ();
+    RunQueuedInput ();
+    elapsed += Now () - start;
+    
+    ResetArenas ();
+    
+    // sending it on isn't the channel's work
+    if ((t + 1) % CHANNEL_FLUSH_POSTS == 0 || t + 1 == ticks)
+      Flush (players, connections, outputBytes);
+    } // end of each tick
+    
+  const double deliveries = double (ticks) * c->subscribers.size ();
+  cout << fixed << setprecision (3);
+  cout << "Posted " << ticks << " messages in " << elapsed << " seconds: " << setprecision (0) 
+       << ticks / elapsed << " messages/s, " << deliveries / elapsed << " deliveries/s" << endl;
+  cout << "Output " << outputBytes << " bytes" << endl;
+  
+  for_each (players.begin (), players.end (), DeleteObject ());
+  return 0;
+} // end of ChannelBenchmark
+
+// lots of players log in at once, as if the server had just come back (-l)
+static int LoginStorm (const int logins)
+{
+  // their files are on disk, but not in the cache (hashing once will do for all of them)
+  const string file = MAKE_STRING (HashPassword (STORM_PASSWORD) << "\n" << INITIAL_ROOM << "\n\n");
+  vector<string> names;
+  for (int i = 1; i <= logins; ++i)
+    {
+    const string name = MAKE_STRING ("Storm" << i);
+    if (!WritePlayerFile (name, file))
+      {
+      cerr << "Could not write the player file for " << name << endl;
+      return 1;
+      }
+    names.push_back (name);
+    }
+  
+  vector<tPlayer *> players;
+  vector<tVirtualConnection *> connections;
+  for (int i = 0; i < logins; ++i)
+    {
+    tVirtualConnection * v = new tVirtualConnection;
+    tPlayer * p = new tPlayer (v, 0, "simulation");
+    playerlist.push_back (p);
+    players.push_back (p);
+    connections.push_back (v);
+    }
+    
+  cout << logins << " players logging in at once, with " << BACKGROUND_THREADS 
+       << " background thread(s) ..." << endl;
+       
+  int loggedIn = 0;
+  uint64_t passes = 0, busy = 0, outputBytes = 0;
+  double longest = 0;
+  const double start = Now ();
+  while (loggedIn < logins)
+    {
+    // they answer whatever they have been asked (again, if the server was busy)
+    for (int i = 0; i < logins; ++i)
+      {
+      tPlayer * p = players [i];
+      if (p->waitingFor)
+        continue;
+      if (p->connstate == eAwaitingName)
+        p->AddInput (names [i] + "\n");
+      else if (p->connstate == eAwaitingPassword)
+        p->AddInput (STORM_PASSWORD + "\n");
+      }
+    
+    // what the main loop does, less the sockets
+    const double time = Now ();
+    RunQueuedInput ();
+    struct pollfd wakeup = { backgroundpool.WakeupFd (), POLLIN, 0 };
+    const double waited = Now ();
+    poll (&wakeup, 1, COMMS_WAIT_USEC / 1000);
+    const double woken = Now ();
+    backgroundpool.FinishJobs ();
+    FlushRoomEvents ();
+    for (vector<tPlayer *>::const_iterator i = players.begin (); i != players.end (); ++i)
+      (*i)->ProcessWrite ();
+    ResetArenas ();
+    longest = max (longest, Now () - time - (woken - waited));
+    passes++;
+    
+    loggedIn = 0;
+    for (int i = 0; i < logins; ++i)
+      {
+      string & output = connections [i]->output;
+      if (output.find ("busy") != string::npos)
+        busy++;
+      outputBytes += output.size ();
+      output.clear ();
+      if (players [i]->connstate == ePlaying)
+        loggedIn++;
+      }
+    } // end of until they are all in
+  const double elapsed = Now () - start;
+  
+  cout << fixed << setprecision (3);
+  cout << "Logged in " << logins << " players in " << elapsed << " seconds: " << setprecision (1) 
+       << logins / elapsed << " logins/s" << endl;
+  cout << "Main loop passes " << passes << ", longest " << setprecision (3) << longest * 1000 
+       << " ms, told the server was busy " << busy << " time(s)" << endl;
+  cout << "Output " << outputBytes << " bytes" << endl;
+  
+  for (vector<string>::const_iterator i = names.begin (); i != names.end (); ++i)
+    unlink ((PLAYER_DIR + *i + PLAYER_EXT).c_str ());
+  return 0;
+} // end of LoginStorm
+
+// more mobiles, of the kinds in the mobiles file, spread over every room (-m)
+static void SpawnMobiles (const int count)
+{
+  if (mobiles.prototypes.empty ())
+    return;
+    
+  vector<int> rooms;
+  for (tRoomMapIterator i = roommap.begin (); i != roommap.end (); ++i)
+    rooms.push_back (i->first);
+    
+  for (int i = 0; i < count; ++i)
+    {
+    const int m = mobiles.Create (Random (mobiles.prototypes.size ()));
+    mobiles.Unlink (m);
+    mobiles.Link (m, rooms [Random (rooms.size ())]);
+    }
+} // end of SpawnMobiles
+
+// how long each mobile system took, each mobile tick (see tMobiles::Tick)
+static void ReportMobileSystems ()
+{
+  istringstream report (MetricsReport ());
+  string line;
+  while (getline (report, line))
+    if (line.find ("mobile_system") != string::npos || line.find ("count") != string::npos)
+      cout << line << endl;
+} // end of ReportMobileSystems
+
+// what a run of ticks measured
+struct tResults
+  {
+  double elapsed;                           // seconds
+  double phasetime [PHASE_COUNT];           // seconds
+  uint64_t phaseallocations [PHASE_COUNT];
+  uint64_t outputBytes;
+  uint64_t hash;                            // of everything everyone was sent, in player order
+  };  // end of tResults
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME  = 1099511628211ULL;
+
+// the usual simulation - everyone sends commands each tick
+static void RunTicks (const int ticks, const int commands, const int players, 
+                      const vector<tVirtualConnection *> & connections, int64_t & now,
+                      const bool hashing, tResults & r)
+{
+  const int64_t tick = COMMS_WAIT_SEC * 1000000 + COMMS_WAIT_USEC;
+  
+  memset (&r, 0, sizeof r);
+  r.hash = FNV_OFFSET;
+  double untimed = 0;
+  const double start = Now ();
+  
+  for (int t = 0; t < ticks; ++t)
+    {
+    now += tick;
+    SetGameTime (now);
+    
+    double time = Now ();
+    uint64_t allocated = allocations;
+    PeriodicUpdates ();
+    r.phasetime [ePeriodic] += Now () - time;
+    r.phaseallocations [ePeriodic] += allocations - allocated;
+    
+    // nobody should be leaving, but if they did we would need to forget them
+    RemoveInactivePlayers ();
+    
+    for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); ++i)
+      for (int c = 0; c < commands; ++c)
+        (*i)->AddInput (PickCommand (*i, players) + "\n");
+        
+    time = Now ();
+    allocated = allocations;
+    RunQueuedInput ();
+    r.phasetime [eInput] += Now () - time;
+    r.phaseallocations [eInput] += allocations - allocated;
+    
+    time = Now ();
+    allocated = allocations;
+    FlushRoomEvents ();
+    r.phasetime [eRoomEvents] += Now () - time;
+    r.phaseallocations [eRoomEvents] += allocations - allocated;
+    
+    time = Now ();
+    allocated = allocations;
+    for (tPlayerListIterator i = playerlist.begin (); i != playerlist.end (); ++i)
+      (*i)->ProcessWrite ();
+    for (vector<tVirtualConnection *>::const_iterator i = connections.begin (); 
+         i != connections.end (); ++i)
+      r.outputBytes += (*i)->output.size ();
+    r.phasetime [eOutput] += Now () - time;
+    r.phaseallocations [eOutput] += allocations - allocated;
+    
+    // not part of the tick, so not timed
+    const double hashstart = Now ();
+    for (vector<tVirtualConnection *>::const_iterator i = connections.begin (); 
+         i != connections.end (); ++i)
+      {
+      const string & output = (*i)->output;
+      if (hashing)
+        for (string::const_iterator c = output.begin (); c != output.end (); ++c)
+          r.hash = (r.hash ^ (unsigned char) *c) * FNV_PRIME;
+      (*i)->output.clear ();
+      }
+    untimed += Now () - hashstart;
+    
+    ResetArenas ();
+    } // end of each tick
+    
+  r.elapsed = Now () - start - untimed;
+} // end of RunTicks
+
+// the same ticks, with room commands run one by one and then in parallel - in
+// a copy of this process each, so both start with the same world (-s)
+static int CompareParallel (const int ticks, const int commands, const int players, const int threads,
+                            const vector<tVirtualConnection *> & connections, int64_t & now)
+{
+  static const char * names [2] = { "one by one", "in parallel" };
+  tResults results [2];
+  
+  for (int parallel = 0; parallel < 2; ++parallel)
+    {
+    int fds [2];
+    if (pipe (fds) == -1)
+      {
+      perror ("pipe");
+      return 1;
+      }
+      
+    const pid_t pid = fork ();
+    if (pid == -1)
+      {
+      perror ("fork");
+      return 1;
+      }
+      
+    // the copy runs the ticks, and sends back what it found
+    if (pid == 0)
+      {
+      close (fds [0]);
+      bParallelInput = parallel;
+      workerpool.Start (threads);
+      tResults r;
+      RunTicks (ticks, commands, players, connections, now, true, r);
+      workerpool.Stop ();
+      const bool sent = write (fds [1], &r, sizeof r) == sizeof r;
+      _exit (sent ? 0 : 1);
+      }
+      
+    close (fds [1]);
+    int status = 0;
+    const bool got = read (fds [0], &results [parallel], sizeof results [parallel]) == 
+                     sizeof results [parallel];
+    close (fds [0]);
+    waitpid (pid, &status, 0);
+    if (!got || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+      {
+      cerr << "Running room commands " << names [parallel] << " failed" << endl;
+      return 1;
+      }
+    
+    const tResults & r = results [parallel];
+    cout << fixed << setprecision (3);
+    cout << "Room commands " << left << setw (12) << names [parallel] << right 
+         << ": " << r.elapsed << " seconds, " << setprecision (1) << ticks / r.elapsed 
+         << " ticks/s, input " << setprecision (3) << r.phasetime [eInput] << " s, output hash " 
+         << hex << setw (16) << setfill ('0') << r.hash << dec << setfill (' ') << endl;
+    } // end of each way
+  
+  if (results [0].hash != results [1].hash || results [0].outputBytes != results [1].outputBytes)
+    {
+    cout << "The output is DIFFERENT" << endl;
+    return 1;
+    }
+    
+  cout << "The output is the same, " << setprecision (2) 
+       << results [0].elapsed / results [1].elapsed << " times as fast in parallel" << endl;
+  return 0;
+} // end of CompareParallel
+
+static void Usage (const char * name)
+{
+  cerr << "Usage: " << name << " [options]\n"
+       << "  -n <players>   virtual players (default 100)\n"
+       << "  -t <ticks>     ticks to run (default 1000)\n"
+       << "  -c <commands>  commands each player sends each tick (default 1)\n"
+       << "  -w <threads>   worker threads (default " << WORKER_THREADS << ")\n"
+       << "  -m <mobiles>   more mobiles, spread over the rooms (and report the mobile systems' times)\n"
+       << "  -l <logins>    instead, a reconnect storm - this many players log in at once\n"
+       << "  -s             run room commands one by one, then in parallel, and compare the output\n"
+       << "  -C <players>   instead, post to a chat channel this many players listen to, once a tick\n";
+} // end of Usage
+
+int main (int argc, char * argv [])
+{
+  int players = 100;
+  int ticks = 1000;
+  int commands = 1;
+  int threads = WORKER_THREADS;
+  int extramobiles = 0;
+  bool compare = false;
+  int listeners = 0;
+  int logins = 0;
+  
+  int opt;
+  while ((opt = getopt (argc, argv, "n:t:c:w:m:sC:l:h")) != -1)
+    switch (opt)
+      {
+      case 'n': players   = atoi (optarg); break;
+      case 't': ticks     = atoi (optarg); break;
+      case 'c': commands  = atoi (optarg); break;
+      case 'w': threads   = atoi (optarg); break;
+      case 'm': extramobiles = atoi (optarg); break;
+      case 's': compare   = true;          break;
+      case 'C': listeners = atoi (optarg); break;
+      case 'l': logins    = atoi (optarg); break;
+      default:  Usage (argv [0]); return 1;
+      }
+      
+  if (players < 1 || ticks < 1 || commands < 1 || threads < 0 || extramobiles < 0 || listeners < 0 ||
+      logins < 0)
+    {
+    Usage (argv [0]);
+    return 1;
+    }
+    
+  // a fixed clock, and nothing written to disk
+  int64_t now = int64_t (time (NULL)) * 1000000;
+  SetGameTime (now);
+  bSavePlayers = false;
+  
+  LoadThings ();
+  SpawnMobiles (extramobiles);
+  
+  // everyone logs straight in
+  vector<tVirtualConnection *> connections;
+  for (int i = 1; i <= players; ++i)
+    {
+    tVirtualConnection * c = new tVirtualConnection;
+    tPlayer * p = new tPlayer (c, 0, "simulation");
+    p->playername = MAKE_STRING ("Sim" << i);
+    playerlist.push_back (p);
+    PlayerEnteredGame (p, "");
+    c->output.clear ();
+    connections.push_back (c);
+    }
+    
+  int result = 0;
+  
+  if (listeners)
+    {
+    workerpool.Start (threads);
+    result = ChannelBenchmark (playerlist.front (), listeners, ticks);
+    }
+  else if (logins)
+    {
+    workerpool.Start (threads);
+    if (!backgroundpool.Start (BACKGROUND_THREADS, true))
+      return 1;
+    result = LoginStorm (logins);
+    }
+  else
+    {
+    cout << "Simulating " << players << " players, " << commands 
+         << " command(s) each per tick, for " << ticks << " ticks ..." << endl;
+    
+    // (no threads yet - a copy of this process only gets the thread that made it)
+    if (compare)
+      result = CompareParallel (ticks, commands, players, threads, connections, now);
+    else
+      {
+      workerpool.Start (threads);
+      tResults r;
+      RunTicks (ticks, commands, players, connections, now, false, r);
+      
+      const double total = double (players) * commands * ticks;
+      cout << fixed << setprecision (3);
+      cout << "Ran " << uint64_t (total) << " commands in " << r.elapsed << " seconds: "
+           << setprecision (0) << total / r.elapsed << " commands/s" << endl;
+      cout << "Output " << r.outputBytes << " bytes, " << setprecision (1) 
+           << r.outputBytes / total << " bytes per command" << endl;
+      uint64_t allocated = 0;
+      for (int i = 0; i < PHASE_COUNT; ++i)
+        allocated += r.phaseallocations [i];
+      cout << "Allocations " << allocated << ", " << setprecision (1) 
+           << allocated / total << " per command" << endl;
+      for (int i = 0; i < PHASE_COUNT; ++i)
+        cout << "  " << left << setw (20) << phasenames [i] << right << setprecision (3) 
+             << setw (9) << r.phasetime [i] << " s" << setprecision (1) 
+             << setw (9) << r.phaseallocations [i] / total << " allocations per command" << endl;
+      if (extramobiles)
+        {
+        cout << mobiles.Count () << " mobiles, each system's time per mobile tick (usec):" << endl;
+        ReportMobileSystems ();
+        }
+      }
+    }
+    
+  // the players go quietly
+  for_each (playerlist.begin (), playerlist.end (), DeleteObject ());
+  playerlist.clear ();
+  workerpool.Stop ();
+  backgroundpool.Stop ();
+  return result;
+} // end of main
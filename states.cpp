@@ -15,22 +15,32 @@ warranty, and with no claim as to its suitability for any purpose.
 // standard library includes ...
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
+#include <deque>
+#include <sstream>
+#include <vector>
 
 using namespace std; 
 
 #include "utils.h"
 #include "player.h"
 #include "globals.h"
+#include "kdf.h"
+#include "playercache.h"
+#include "preauth.h"
+#include "metrics.h"
+#include "log.h"
 
 void PlayerEnteredGame (tPlayer * p, const string & message)
 {
   p->connstate = ePlaying;    // now normal player
   p->prompt = PROMPT;         // default prompt
+  AddPlayerToIndex (p);       // others can now find them
+  StopLoginTimer (p);         // made it in time
   *p << "Welcome, " << p->playername << "\n\n"; // greet them
   *p << message;
   *p << messagemap ["motd"];  // message of the day
+  JoinChannels (p);           // start listening to their chat channels
   p->DoCommand ("look");     // new player looks around
 
   // tell other players
@@ -39,9 +49,265 @@ void PlayerEnteredGame (tPlayer * p, const string & message)
     p);
   
   // log it
-  cout << "Player " << p->playername << " has joined the game." << endl;
+  Log (eLogInfo, "Player " + p->playername + " has joined the game.");
 } // end of PlayerEnteredGame
 
+// detect too many password attempts - they don't get to try again on this connection
+static void BadPassword (tPlayer * p, const string & reason)
+{
+  if (++p->badPasswordCount >= MAX_PASSWORD_ATTEMPTS)
+    {
+    p->ClosePlayer ();
+    p->prompt = "Goodbye.\n";
+    throw runtime_error (reason + "\nToo many attempts to guess the password!");
+    }
+  throw runtime_error (reason);
+} // end of BadPassword
+
+// someone has that name already - ask for another
+static void NameTaken (tPlayer * p)
+{
+  p->connstate = eAwaitingNewName;
+  p->prompt = "Please choose a name for your new character ... ";  // re-prompt for name
+  throw runtime_error ("That player already exists, please choose another name.");
+} // end of NameTaken
+
+// that player might have been created while we were choosing a password, so check again
+// (playing, or saved since - the disk is checked by the background jobs)
+static void NewPlayerExists (tPlayer * p)
+{
+  if (FindPlayer (p->playername) || playercache.Contains (p->playername))
+    NameTaken (p);
+} // end of NewPlayerExists
+
+/*
+ Reading a player file, and password hashing (which takes tens of milliseconds
+ on purpose), are done on the background threads. Meanwhile the player waits
+ in eLoadingPlayer or eCheckingPassword, and the job's Finish carries on with
+ the login on the main thread.
+*/
+
+// login jobs - Run is on a worker thread, so only uses its own copies
+class tLoginJob : public tAsyncJob
+  {
+  protected:
+  tPlayer * p;          // who is waiting - only touched in Finish
+  
+  public:
+  tLoginJob (tPlayer * player) : p (player) {}
+  
+  virtual void Finish ()
+    {
+    p->waitingFor = NULL;
+    if (p->closing || !p->Connected ())
+      return;   // they went away
+    try
+      {
+      Done ();
+      }
+    catch (runtime_error & e)
+      {
+      *p << e.what () << "\n";
+      }
+    *p << p->prompt;
+    
+    // now act on anything they typed while waiting, as if it arrived just now
+    deque<string> lines;
+    lines.swap (p->typeahead);
+    while (!lines.empty () && !p->closing)
+      {
+      if (p->waitingFor)
+        {
+        p->typeahead.swap (lines);   // waiting again (eg. for their password to be checked)
+        break;
+        }
+      ProcessPlayerInput (p, lines.front ());
+      lines.pop_front ();
+      }
+    } // end of Finish
+  
+  virtual void Done () = 0;   // the login carries on here
+  };  // end of class tLoginJob
+
+// got their player file - now we can ask for the password
+static void PlayerLoaded (tPlayer * p, const string & text)
+{
+  istringstream is (text);
+  p->Load (is);   // so we know the password etc.
+  
+  p->connstate = eAwaitingPassword;
+  p->prompt = "Enter your password ... ";
+} // end of PlayerLoaded
+
+// read an existing player's file
+class tLoadPlayerJob : public tLoginJob
+  {
+  string name;          // whose file
+  string text;          // what is in it
+  bool found;
+  
+  public:
+  tLoadPlayerJob (tPlayer * player) : tLoginJob (player), name (player->playername), found (false) {}
+  
+  void Run () { found = ReadPlayerFile (name, text); }
+  
+  void Done ()
+    {
+    if (!found)
+      {
+      p->Init ();
+      throw runtime_error ("That player does not exist, type 'new' to create a new one.");
+      }
+      
+    // if they were saved while we were reading, the cache is newer
+    string cached;
+    if (playercache.Find (name, cached))
+      text = cached;
+    else
+      playercache.Put (name, text);
+    PlayerLoaded (p, text);
+    }
+  };  // end of class tLoadPlayerJob
+
+// see if a new player's name is taken by a player file
+class tNewNameJob : public tLoginJob
+  {
+  string name;          // whose file
+  bool exists;
+  
+  public:
+  tNewNameJob (tPlayer * player) : tLoginJob (player), name (player->playername), exists (false) {}
+  
+  void Run () { exists = PlayerFileExists (name); }
+  
+  void Done ()
+    {
+    if (exists)
+      NameTaken (p);
+    NewPlayerExists (p);    // or they could have joined while we were looking
+    
+    p->connstate = eAwaitingNewPassword;
+    p->prompt = "Choose a password for " + p->playername + " ... ";  
+    p->badPasswordCount = 0;
+    }
+  };  // end of class tNewNameJob
+
+// password jobs
+class tPasswordJob : public tLoginJob
+  {
+  protected:
+  string password;      // what they typed
+  
+  public:
+  tPasswordJob (tPlayer * player, const string & typed) : tLoginJob (player), password (typed) {}
+  };  // end of class tPasswordJob
+
+// hash a new player's password
+class tNewPasswordJob : public tPasswordJob
+  {
+  string name;          // whose file
+  string hashed;
+  bool exists;
+  
+  public:
+  tNewPasswordJob (tPlayer * player, const string & typed) 
+    : tPasswordJob (player, typed), name (player->playername), exists (false) {}
+  
+  void Run () 
+    { 
+    hashed = HashPassword (password); 
+    exists = PlayerFileExists (name);
+    }
+  
+  void Done ()
+    {
+    // could have been created while we were hashing
+    if (exists)
+      NameTaken (p);
+    NewPlayerExists (p);
+    p->password = hashed;
+  
+    // New player now in the game
+    PlayerEnteredGame (p, messagemap ["new_player"]);
+    }
+  };  // end of class tNewPasswordJob
+
+// check an existing player's password, and hash it if it was saved as plain text
+class tCheckPasswordJob : public tPasswordJob
+  {
+  string saved;         // from their player file
+  bool ok;
+  
+  public:
+  tCheckPasswordJob (tPlayer * player, const string & typed) 
+    : tPasswordJob (player, typed), saved (player->password), ok (false) {}
+  
+  void Run () 
+    { 
+    ok = VerifyPassword (password, saved); 
+    if (ok && !IsHashedPassword (saved))
+      saved = HashPassword (password);    // older player file - hash it from now on
+    }
+  
+  void Done ()
+    {
+    if (!ok)
+      {
+      p->connstate = eAwaitingPassword;
+      p->prompt = "Enter your password ... ";
+      BadPassword (p, "That password is incorrect.");
+      }
+      
+    // they might have logged in on another connection meanwhile
+    if (FindPlayer (p->playername))
+      {
+      string name = p->playername;
+      p->Init ();
+      throw runtime_error (name + " is already connected.");
+      }
+      
+    if (saved != p->password)
+      {
+      p->password = saved;
+      p->Save ();   // so the plain text is gone from disk now
+      }
+      
+    // check for "blocked" flag on this player
+    if (p->HaveFlag ("blocked"))
+      {
+      p->ClosePlayer ();
+      p->prompt = "Goodbye.\n";
+      throw runtime_error ("You are not permitted to connect.");
+      }
+      
+    // OK, they're in!
+    PlayerEnteredGame (p, messagemap ["existing_player"]);
+    }
+  };  // end of class tCheckPasswordJob
+
+// start a login job, and wait for it to finish
+static void WaitForJob (tPlayer * p, tLoginJob * job, const tConnectionStates state)
+{
+  if (!backgroundpool.Submit (job))
+    {
+    delete job;
+    throw runtime_error ("The server is busy, please try again.");
+    }
+  p->waitingFor = job;
+  p->connstate = state;
+  p->prompt.clear ();   // the prompt comes when the job finishes
+} // end of WaitForJob
+
+// keep what they type until the login job finishes (eg. a client sending name, password, commands)
+void ProcessWaiting (tPlayer * p, istream & sArgs)
+{
+  if (p->typeahead.size () >= MAX_TYPEAHEAD)
+    throw runtime_error ("Please wait ...");
+  string line;
+  getline (sArgs, line);
+  p->typeahead.push_back (line);
+} // end of ProcessWaiting
+
 void ProcessPlayerName (tPlayer * p, istream & sArgs)
 {
   string playername;
@@ -67,11 +333,14 @@ void ProcessPlayerName (tPlayer * p, istream & sArgs)
     {   // old player
   
     p->playername = tocapitals (playername);
-    p->Load ();   // load player so we know the password etc.
-    
-    p->connstate = eAwaitingPassword;
-    p->prompt = "Enter your password ... ";
     p->badPasswordCount = 0;
+    
+    // if they were here recently we don't need the disk
+    string text;
+    if (playercache.Find (p->playername, text))
+      PlayerLoaded (p, text);
+    else
+      WaitForJob (p, new tLoadPlayerJob (p), eLoadingPlayer);  // see tLoadPlayerJob::Done
     } // end of old player
         
 } /* end of ProcessPlayerName */
@@ -92,15 +361,14 @@ void ProcessNewPlayerName (tPlayer * p, istream & sArgs)
   if (badnameset.find (playername) != badnameset.end ())
     throw runtime_error ("That name is not permitted.");
     
-  ifstream f ((PLAYER_DIR + tocapitals (playername) + PLAYER_EXT).c_str (), ios::in);
-  if (f || FindPlayer (playername))  // player file on disk, or playing without saving yet
+  // playing without saving yet, or we have their file already
+  if (FindPlayer (playername) || playercache.Contains (playername))
     throw runtime_error ("That player already exists, please choose another name.");
   
   p->playername = tocapitals (playername);
   
-  p->connstate = eAwaitingNewPassword;
-  p->prompt = "Choose a password for " + p->playername + " ... ";  
-  p->badPasswordCount = 0;
+  // look for their file in the background - see tNewNameJob::Done
+  WaitForJob (p, new tNewNameJob (p), eLoadingPlayer);
     
 } /* end of ProcessNewPlayerName */
 
@@ -132,60 +400,35 @@ void ProcessConfirmPassword (tPlayer * p, istream & sArgs)
     throw runtime_error ("Password and confirmation do not agree.");
     }
   
-  // that player might have been created while we were choosing a password, so check again
-  ifstream f ((PLAYER_DIR + tocapitals (password) + PLAYER_EXT).c_str (), ios::in);
-  if (f || FindPlayer (password))  // player file on disk, or playing without saving yet
-    {
-    p->connstate = eAwaitingNewName;
-    p->prompt = "Please choose a name for your new character ... ";  // re-prompt for name
-    throw runtime_error ("That player already exists, please choose another name.");
-    }
+  NewPlayerExists (p);
   
-  // New player now in the game
-  PlayerEnteredGame (p, messagemap ["new_player"]);
+  // hash the password in the background - see tNewPasswordJob::Finish
+  WaitForJob (p, new tNewPasswordJob (p, password), eCheckingPassword);
          
-} /* end of ProcessNewPassword */
+} /* end of ProcessConfirmPassword */
 
 void ProcessPlayerPassword (tPlayer * p, istream & sArgs)
 {
-  try
-    {
-    string password;
-    sArgs >> password;
-
-    /* password can't be blank */
-    if (password.empty ())
-      throw runtime_error ("Password cannot be blank.");
-        
-    if (password != p->password)
-      throw runtime_error ("That password is incorrect.");
+  string password;
+  sArgs >> password;
 
-    // check for "blocked" flag on this player
-    if (p->HaveFlag ("blocked"))
-      {
-      p->ClosePlayer ();
-      p->prompt = "Goodbye.\n";
-      throw runtime_error ("You are not permitted to connect.");
-      }
-      
-    // OK, they're in!
-    PlayerEnteredGame (p, messagemap ["existing_player"]);
- 
-    } // end of try block
+  /* password can't be blank */
+  if (password.empty ())
+    BadPassword (p, "Password cannot be blank.");
     
-  // detect too many password attempts
-  catch (runtime_error & e)
-    {
-    if (++p->badPasswordCount >= MAX_PASSWORD_ATTEMPTS)
-      {
-      *p << "Too many attempts to guess the password!\n";
-      p->Init ();
-      }
-      throw;
-    }
+  // check it in the background - see tCheckPasswordJob::Done
+  WaitForJob (p, new tCheckPasswordJob (p, password), eCheckingPassword);
     
 } /* end of ProcessPlayerPassword */
     
+// how long input takes in each state (see LoadStates)
+static vector<int> statehistograms;
+
+int StateHistogram (const tConnectionStates state)
+{
+  return state < (int) statehistograms.size () ? statehistograms [state] : -1;
+} // end of StateHistogram
+
 void LoadStates ()
 {
 
@@ -196,8 +439,18 @@ void LoadStates ()
   statemap [eAwaitingNewName]     = ProcessNewPlayerName; // new player
   statemap [eAwaitingNewPassword] = ProcessNewPassword;
   statemap [eConfirmPassword]     = ProcessConfirmPassword;
+  
+  statemap [eLoadingPlayer]       = ProcessWaiting;       // either
+  statemap [eCheckingPassword]    = ProcessWaiting;
 
-  statemap [ePlaying]             = ProcessCommand;   // playing
+  statemap [ePlaying]             = ProcessCommandLine;   // playing
+  
+  // time each of them - made now, as input can be handled on worker threads
+  static const char * names [] = { "awaiting_name", "awaiting_password", "awaiting_new_name",
+                                   "awaiting_new_password", "confirm_password", "loading_player",
+                                   "checking_password", "playing" };
+  for (int i = 0; i <= ePlaying; ++i)
+    statehistograms.push_back (AddHistogram ("state", names [i]));
 
 } // end of LoadStates
 
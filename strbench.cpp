@@ -0,0 +1,314 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+/*
+
+ Microbenchmark for strings.cpp - times the string functions the server
+ calls most (case-independent compares for every name lookup, Trim for every
+ line of input, case changes) against the char-at-a-time versions they
+ replaced, which are kept below. Before timing anything, both versions are
+ run over the same inputs (including random bytes, some of them not ASCII)
+ and must agree.
+
+   make strbench
+   ./strbench
+
+*/
+
+#include <time.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// standard library includes ...
+
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+
+using namespace std; 
+
+#include "strings.h"
+
+/* ---------------- the versions these replaced ---------------- */
+
+struct oldCiEqualTo : binary_function <string, string, bool>
+  {
+  struct compare_equal 
+    : public binary_function <unsigned char, unsigned char,bool>
+    {
+    bool operator() (const unsigned char& c1, const unsigned char& c2) const
+      { return tolower (c1) == tolower (c2); }
+    };  // end of compare_equal
+
+  bool operator() (const string & s1, const string & s2) const
+    {
+    // (this used to run off the end of s2 if it was shorter)
+    if (s2.size () < s1.size ())
+      return false;
+    pair <string::const_iterator, string::const_iterator> result =
+      mismatch (s1.begin (), s1.end (), s2.begin (), compare_equal ()); 
+    return result.first == s1.end () && result.second == s2.end ();
+    }
+  }; // end of oldCiEqualTo
+
+struct oldCiLess : binary_function <string, string, bool>
+  {
+  struct compare_less 
+    : public binary_function <unsigned char, unsigned char,bool>
+    {
+    bool operator() (const unsigned char& c1, const unsigned char& c2) const
+      { return tolower (c1) < tolower (c2); }
+    }; // end of compare_less
+
+  bool operator() (const string & s1, const string & s2) const
+    {
+    return lexicographical_compare
+          (s1.begin (), s1.end (), s2.begin (), s2.end (), compare_less ()); 
+    }
+  }; // end of oldCiLess
+
+static string oldTrim (const string & s, const string & t = SPACES)
+{
+  string d = s; 
+  string::size_type i = d.find_last_not_of (t);
+  if (i == string::npos)
+    return "";
+  else
+   return d.erase (i + 1).erase (0, s.find_first_not_of (t)) ; 
+} // end of oldTrim
+
+static string oldTolower (const string & s)
+  {
+  string d = s;
+  transform (d.begin (), d.end (), d.begin (), (int(*)(int)) tolower);
+  return d;
+  }  // end of oldTolower
+
+class oldCapitals : public unary_function<unsigned char,unsigned char> 
+  {
+  bool bUpper;
+  public:
+  oldCapitals () : bUpper (true) {}
+  unsigned char operator() (const unsigned char & c)  
+    { 
+    unsigned char c1 = bUpper ? toupper (c) : tolower (c);
+    bUpper = isalnum (c) == 0 && c < 0x80;
+    return c1; 
+    }
+  };  // end of class oldCapitals
+
+static string oldTocapitals (const string & s)
+  {
+  string d = s;
+  transform (d.begin (), d.end (), d.begin (), oldCapitals ());
+  return d;
+  }  // end of oldTocapitals
+
+/* ---------------- inputs ---------------- */
+
+static uint32_t seed = 12345;
+static uint32_t Random ()
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+} // end of Random
+
+static string RandomName ()
+{
+  static const string letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  string s;
+  const int len = 3 + Random () % 10;
+  for (int i = 0; i < len; ++i)
+    s += letters [Random () % letters.size ()];
+  return s;
+} // end of RandomName
+
+// anything at all, to check the two versions agree
+static string RandomBytes ()
+{
+  static const string likely = " \t\r\nAaZz09%r@[`{";
+  string s;
+  const int len = Random () % 70;
+  for (int i = 0; i < len; ++i)
+    if (Random () % 2)
+      s += likely [Random () % likely.size ()];
+    else
+      s += char (Random ());
+  return s;
+} // end of RandomBytes
+
+static int Sign (const bool less, const bool greater)
+{
+  return less ? -1 : (greater ? 1 : 0);
+} // end of Sign
+
+static int failures = 0;
+
+static void Check (const bool ok, const string & what, const string & s1, const string & s2 = "")
+{
+  if (ok)
+    return;
+  if (++failures <= 10)
+    cerr << what << " differs for \"" << s1 << "\" \"" << s2 << "\"" << endl;
+} // end of Check
+
+// run both versions over the same inputs
+static void CheckAgainstOld ()
+{
+  vector<string> inputs;
+  for (int i = 0; i < 20000; ++i)
+    inputs.push_back (RandomBytes ());
+  // long, nearly the same, differing in case or after the first 16 bytes
+  inputs.push_back ("The quick brown fox jumps over the lazy dog, again and again");
+  inputs.push_back ("THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG, AGAIN AND AGAIN");
+  inputs.push_back ("The quick brown fox jumps over the lazy dog, again and agaiN!");
+  inputs.push_back ("The quick brown fox jumps over the lazy cat, again and again");
+  inputs.push_back ("The quick brown fox jumps over the lazy dog");
+  inputs.push_back ("The quick brown f\xe9x jumps over the lazy dog, again and again");
+
+  for (vector<string>::const_iterator i = inputs.begin (); i != inputs.end (); ++i)
+    {
+    const string & s = *i;
+    const string & other = inputs [Random () % inputs.size ()];
+    const string variant = (Random () % 2) ? oldTolower (s) : s;
+    
+    Check (tolower (s) == oldTolower (s), "tolower", s);
+    Check (tocapitals (s) == oldTocapitals (s), "tocapitals", s);
+    Check (Trim (s) == oldTrim (s), "Trim", s);
+    Check (Trim (s, "%rz") == oldTrim (s, "%rz"), "Trim (chars)", s);
+    
+    const string pairs [][2] = { { s, other }, { s, variant }, { variant, s }, { s, s.substr (0, s.size () / 2) } };
+    for (int j = 0; j < 4; ++j)
+      {
+      const string & a = pairs [j][0];
+      const string & b = pairs [j][1];
+      Check (ciStringEqual (a, b) == oldCiEqualTo () (a, b), "ciEqualTo", a, b);
+      Check (ciCompare (a, b) == Sign (oldCiLess () (a, b), oldCiLess () (b, a)), "ciCompare", a, b);
+      Check (ciLess () (a, b) == oldCiLess () (a, b), "ciLess", a, b);
+      }
+    } // end of each input
+} // end of CheckAgainstOld
+
+/* ---------------- timing ---------------- */
+
+static double Now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+} // end of Now
+
+static volatile size_t sink;    // so the compiler can't throw the work away
+
+static void Report (const string & name, const double oldtime, const double newtime, const int count)
+{
+  cout << "  " << left << setw (30) << name << right << fixed << setprecision (1)
+       << setw (9) << oldtime * 1e9 / count << " ns"
+       << setw (9) << newtime * 1e9 / count << " ns"
+       << setw (8) << setprecision (2) << oldtime / newtime << "x" << endl;
+} // end of Report
+
+// time one function over the inputs, old version then new
+#define TIME_IT(name, inputs, oldexpr, newexpr)                         \
+  {                                                                     \
+  const int reps = 20;                                                  \
+  double start = Now ();                                                \
+  for (int rep = 0; rep < reps; ++rep)                                  \
+    for (vector<string>::const_iterator i = inputs.begin ();            \
+         i != inputs.end (); ++i)                                       \
+      sink += (oldexpr);                                                \
+  const double oldtime = Now () - start;                                \
+  start = Now ();                                                       \
+  for (int rep = 0; rep < reps; ++rep)                                  \
+    for (vector<string>::const_iterator i = inputs.begin ();            \
+         i != inputs.end (); ++i)                                       \
+      sink += (newexpr);                                                \
+  Report (name, oldtime, Now () - start, reps * inputs.size ());        \
+  }
+
+// a set of names, looked up the way FindPlayer does
+template <typename LESS>
+static double TimeLookups (const vector<string> & names, const vector<string> & lookups)
+{
+  set<string, LESS> s (names.begin (), names.end ());
+  const double start = Now ();
+  for (int rep = 0; rep < 20; ++rep)
+    for (vector<string>::const_iterator i = lookups.begin (); i != lookups.end (); ++i)
+      sink += s.count (*i);
+  return Now () - start;
+} // end of TimeLookups
+
+int main ()
+{
+  CheckAgainstOld ();
+  if (failures)
+    {
+    cerr << failures << " difference(s) from the old versions - not timing them" << endl;
+    return 1;
+    }
+  cout << "New versions agree with the old ones." << endl;
+  
+  // player names, and the same names typed in other cases
+  vector<string> names, lookups;
+  for (int i = 0; i < 10000; ++i)
+    {
+    names.push_back (RandomName ());
+    lookups.push_back ((i % 2) ? oldTolower (names.back ()) : RandomName ());
+    }
+    
+  // lines of input, as typed
+  vector<string> lines;
+  static const char * commands [] = 
+    { "look", "  say Hello there, how is everyone?  ", "n", "tell Nick Meet me at the fountain.\r",
+      "emote waves.", "get sword", "  who ", "chat newbie anyone want to group?\r" };
+  for (int i = 0; i < 10000; ++i)
+    lines.push_back (commands [i % (sizeof commands / sizeof commands [0])]);
+    
+  // room descriptions
+  vector<string> descriptions;
+  for (int i = 0; i < 1000; ++i)
+    descriptions.push_back ("Room 1001.%rYou are in room 1001. It could look better. What a let-down! "
+                            "This room has no alabaster walls, no mystic fireplace, no marble floors.%r%r"
+                            "As you glance around the room, you wonder what else might exist in this world.");
+  // long names, eg. the same long object name with a different ending
+  vector<string> longnames;
+  for (int i = 0; i < 10000; ++i)
+    longnames.push_back ("a Gleaming Two-Handed Sword of the Ancient Kings " + RandomName ());
+    
+  cout << "                                     old          new" << endl;
+  
+  const double oldlookups = TimeLookups<oldCiLess> (names, lookups);
+  const double newlookups = TimeLookups<ciLess> (names, lookups);
+  Report ("set<ciLess> find (names)", oldlookups, newlookups, 20 * lookups.size ());
+  
+  const double oldlong = TimeLookups<oldCiLess> (longnames, longnames);
+  const double newlong = TimeLookups<ciLess> (longnames, longnames);
+  Report ("set<ciLess> find (long names)", oldlong, newlong, 20 * longnames.size ());
+  
+  TIME_IT ("ciStringEqual (names)", lookups, 
+           oldCiEqualTo () (*i, names [i - lookups.begin ()]), 
+           ciStringEqual (*i, names [i - lookups.begin ()]));
+  TIME_IT ("Trim (command lines)", lines, oldTrim (*i).size (), Trim (*i).size ());
+  TIME_IT ("tolower (names)", names, oldTolower (*i).size (), tolower (*i).size ());
+  TIME_IT ("tolower (descriptions)", descriptions, oldTolower (*i).size (), tolower (*i).size ());
+  TIME_IT ("tocapitals (names)", names, oldTocapitals (*i).size (), tocapitals (*i).size ());
+           
+  return 0;
+} // end of main
@@ -12,6 +12,10 @@ warranty, and with no claim as to its suitability for any purpose.
  
 */
 
+#ifdef __SSE2__
+#include <emmintrin.h>   // SSE2 - always there on x86-64
+#endif
+
 #include <string>
 #include <algorithm>
 
@@ -19,6 +23,73 @@ using namespace std;
 
 #include "strings.h"
 
+/*
+ We run in the "C" locale, where tolower only changes A-Z. So ASCII can be
+ folded with arithmetic (16 bytes at a time with SSE2), and anything else
+ is left to tolower, in case the locale is ever changed.
+*/
+
+static inline unsigned char FoldCase (const unsigned char c)
+{
+  if (c < 0x80)
+    return (unsigned (c - 'A') < 26) ? c + ('a' - 'A') : c;
+  return tolower (c);
+} // end of FoldCase
+
+#ifdef __SSE2__
+// fold 16 ASCII bytes (signed compares, so bytes over 0x7F are never "upper case")
+static inline __m128i FoldCase16 (const __m128i v)
+{
+  const __m128i upper = _mm_and_si128 (_mm_cmpgt_epi8 (v, _mm_set1_epi8 ('A' - 1)),
+                                       _mm_cmplt_epi8 (v, _mm_set1_epi8 ('Z' + 1)));
+  return _mm_add_epi8 (v, _mm_and_si128 (upper, _mm_set1_epi8 ('a' - 'A')));
+} // end of FoldCase16
+#endif
+
+// case-independent compare (of strings of either kind)
+static int ciCompare (const char * s1, const size_t size1, const char * s2, const size_t size2)
+{
+  const unsigned char * p1 = reinterpret_cast<const unsigned char *> (s1);
+  const unsigned char * p2 = reinterpret_cast<const unsigned char *> (s2);
+  const size_t len = min (size1, size2);
+  size_t i = 0;
+  
+#ifdef __SSE2__
+  // skip the part that is the same, 16 at a time
+  for ( ; i + 16 <= len; i += 16)
+    {
+    const __m128i a = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (p1 + i));
+    const __m128i b = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (p2 + i));
+    if (_mm_movemask_epi8 (_mm_or_si128 (a, b)))
+      break;    // not ASCII - do the rest one at a time
+    const int same = _mm_movemask_epi8 (_mm_cmpeq_epi8 (FoldCase16 (a), FoldCase16 (b)));
+    if (same != 0xFFFF)
+      {
+      i += __builtin_ctz (~same);   // the first difference decides it
+      break;
+      }
+    }
+#endif
+
+  for ( ; i < len; ++i)
+    {
+    const unsigned char c1 = FoldCase (p1 [i]);
+    const unsigned char c2 = FoldCase (p2 [i]);
+    if (c1 != c2)
+      return c1 < c2 ? -1 : 1;
+    }
+    
+  // the same as far as the shorter one goes
+  if (size1 == size2)
+    return 0;
+  return size1 < size2 ? -1 : 1;
+} // end of ciCompare
+
+int ciCompare (const string & s1, const string & s2)
+{
+  return ciCompare (s1.data (), s1.size (), s2.data (), s2.size ());
+} // end of ciCompare
+
 // string find-and-replace
 string FindAndReplace
   (const string& source, const string target, const string replacement)
@@ -35,22 +106,60 @@ string FindAndReplace
   return str;
   }   // end of FindAndReplace
 
-// get rid of leading and trailing spaces from a string
+// is this one of the characters to trim? (spaces is true if t is SPACES)
+static inline bool IsTrimmed (const char c, const string & t, const bool spaces)
+{
+  if (spaces)
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  return t.find (c) != string::npos;
+} // end of IsTrimmed
+
+// get rid of leading and trailing spaces from a string (or a tTempString)
+template <typename S>
+static S TrimString (const S & s, const string & t)
+{
+  const bool spaces = t == SPACES;    // the usual case - no need to search t each time
+  typename S::size_type last = s.size ();
+  while (last > 0 && IsTrimmed (s [last - 1], t, spaces))
+    --last;
+  typename S::size_type first = 0;
+  while (first < last && IsTrimmed (s [first], t, spaces))
+    ++first;
+  
+  // one copy, of just the part we want
+  return s.substr (first, last - first);
+} // end of TrimString
+
 string Trim (const string & s, const string & t)
 {
-  string d = s; 
-  string::size_type i = d.find_last_not_of (t);
-  if (i == string::npos)
-    return "";
-  else
-   return d.erase (i + 1).erase (0, s.find_first_not_of (t)) ; 
+  return TrimString (s, t);
+}
+
+tTempString Trim (const tTempString & s, const string & t)
+{
+  return TrimString (s, t);
 }
 
 // returns a lower case version of the string 
 string tolower (const string & s)
   {
 string d = s;
-  transform (d.begin (), d.end (), d.begin (), (int(*)(int)) tolower);
+  string::size_type i = 0;
+  
+#ifdef __SSE2__
+  for ( ; i + 16 <= d.size (); i += 16)
+    {
+    const __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (&d [i]));
+    if (_mm_movemask_epi8 (v))    // not all ASCII
+      for (string::size_type j = i; j < i + 16; ++j)
+        d [j] = FoldCase (d [j]);
+    else
+      _mm_storeu_si128 (reinterpret_cast<__m128i *> (&d [i]), FoldCase16 (v));
+    }
+#endif
+
+  for ( ; i < d.size (); ++i)
+    d [i] = FoldCase (d [i]);
   return d;
   }  // end of tolower
 
@@ -68,14 +177,23 @@ class fCapitals : public unary_function<unsigned char,unsigned char>
   unsigned char operator() (const unsigned char & c)  
     { 
     unsigned char c1;
+    
+    // not ASCII - let the locale decide (and the next letter isn't capitalised)
+    if (c >= 0x80)
+      {
+      c1 = bUpper ? toupper (c) : tolower (c);
+      bUpper = false;
+      return c1;
+      }
+      
     // capitalise depending on previous letter
-    if (bUpper)
-      c1 = toupper (c);
-    else
-      c1 = tolower (c);
+    const bool letter = unsigned ((c | 0x20) - 'a') < 26;
+    c1 = FoldCase (c);
+    if (bUpper && letter)
+      c1 -= 'a' - 'A';
 
     // work out whether next letter should be capitals
-    bUpper = isalnum (c) == 0 && c < 0x80;
+    bUpper = !letter && unsigned (c - '0') >= 10;
     return c1; 
     }
   };  // end of class fCapitals
@@ -88,6 +206,26 @@ string d = s;
   return d;
   }  // end of tocapitals
   
+// returns the string with the first letter capitalised
+template <typename S>
+static S Sentence (const S & s)
+  {
+S d = s;
+  if (!d.empty ())
+    d [0] = toupper (d [0]);
+  return d;
+  }  // end of Sentence
+
+string tosentence (const string & s)
+  {
+  return Sentence (s);
+  }  // end of tosentence
+
+tTempString tosentence (const tTempString & s)
+  {
+  return Sentence (s);
+  }  // end of tosentence
+  
 // compare strings for equality using the binary function above
 // returns true is s1 == s2
 bool ciStringEqual (const string & s1, const string & s2)
@@ -95,26 +233,61 @@ bool ciStringEqual (const string & s1, const string & s2)
   return ciEqualTo () (s1, s2);
   }  // end of ciStringEqual
 
+bool ciStringEqual (const tTempString & s1, const string & s2)
+  {
+  return s1.size () == s2.size () && ciCompare (s1.data (), s1.size (), s2.data (), s2.size ()) == 0;
+  }  // end of ciStringEqual
+
   /* split a line into the first word, and rest-of-the-line */
 
-pair<string, string> GetWord (const string & s)
+template <typename S>
+static pair<S, S> SplitWord (const S & s)
 {
-  string rest = s;  // make copy so we can modify it
+  S rest = s;  // make copy so we can modify it
   
  // find delimiter  
-  string::size_type i (rest.find (' '));
+  typename S::size_type i (rest.find (' '));
 
   // split into before and after delimiter
-  string w (rest.substr (0, i));
+  S w (rest.substr (0, i));
 
-  if (i == string::npos)
+  if (i == S::npos)
     rest.erase ();          // if no delimiter, remainder is empty
   else   
     rest.erase (0, i + 1);  // erase up to the delimiter
 
   // return first word in line, rest of line
-  return make_pair (Trim (w), Trim (rest));
+  return make_pair (TrimString (w, SPACES), TrimString (rest, SPACES));
   
+} /* end of SplitWord */
+
+pair<string, string> GetWord (const string & s)
+{
+  return SplitWord (s);
 } /* end of GetWord */
 
+pair<tTempString, tTempString> GetWord (const tTempString & s)
+{
+  return SplitWord (s);
+} /* end of GetWord */
+
+/* does any word in a name match (eg. rat for "a large rat") */
+
+bool NameMatches (const string & name, const string & word)
+{
+  string::size_type start = 0;
   
+  while ((start = name.find_first_not_of (SPACES, start)) != string::npos)
+    {
+    string::size_type end = name.find_first_of (SPACES, start);
+    if (end == string::npos)
+      end = name.size ();
+    
+    if (ciStringEqual (name.substr (start, end - start), word))
+      return true;
+      
+    start = end;
+    }
+    
+  return false;
+} /* end of NameMatches */
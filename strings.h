@@ -3,28 +3,23 @@
 
 #include <ctype.h>   // for toupper, tolower
 
+#include "arena.h"   // for tTempString
+
 // strings.h - string functions
 
 static const string SPACES = " \t\r\n";           // what gets removed when we trim
 
+// case-independent (ci) compare - less than 0 if s1 < s2, 0 if equal, more than 0 if s1 > s2
+// (ASCII is done 16 bytes at a time where the processor can, anything else by tolower)
+int ciCompare (const string & s1, const string & s2);
+
 // case-independent (ci) string compare
 // returns true if strings are EQUAL
 struct ciEqualTo : binary_function <string, string, bool>
   {
-  struct compare_equal 
-    : public binary_function <unsigned char, unsigned char,bool>
-    {
-    bool operator() (const unsigned char& c1, const unsigned char& c2) const
-      { return tolower (c1) == tolower (c2); }
-    };  // end of compare_equal
-
   bool operator() (const string & s1, const string & s2) const
     {
-    pair <string::const_iterator, string::const_iterator> result =
-      mismatch (s1.begin (), s1.end (), s2.begin (), compare_equal ()); 
-
-    // match if both at end
-    return result.first == s1.end () && result.second == s2.end ();
+    return s1.size () == s2.size () && ciCompare (s1, s2) == 0;
     }
   }; // end of ciEqualTo
 
@@ -32,18 +27,9 @@ struct ciEqualTo : binary_function <string, string, bool>
 // returns true if s1 < s2
 struct ciLess : binary_function <string, string, bool>
   {
-  // case-independent (ci) compare_less binary function
-  struct compare_less 
-    : public binary_function <unsigned char, unsigned char,bool>
-    {
-    bool operator() (const unsigned char& c1, const unsigned char& c2) const
-      { return tolower (c1) < tolower (c2); }
-    }; // end of compare_less
-
   bool operator() (const string & s1, const string & s2) const
     {
-    return lexicographical_compare
-          (s1.begin (), s1.end (), s2.begin (), s2.end (), compare_less ()); 
+    return ciCompare (s1, s2) < 0;
     }
   }; // end of ciLess
 
@@ -54,6 +40,7 @@ string FindAndReplace (const string& source, const string target, const string r
   
 // get rid of leading and trailing spaces from a string
 string Trim (const string & s, const string & t = SPACES);
+tTempString Trim (const tTempString & s, const string & t = SPACES);
 
 // convert to lowercase
 string tolower (const string & s);
@@ -61,11 +48,20 @@ string tolower (const string & s);
 // capitalise a string
 string tocapitals (const string & s);
 
+// capitalise the first letter only (eg. A large rat)
+string tosentence (const string & s);
+tTempString tosentence (const tTempString & s);
+
 // case-independent compare equal  
 bool ciStringEqual (const string & s1, const string & s2);
+bool ciStringEqual (const tTempString & s1, const string & s2);
   
 // split a string into first word, rest-of-line
 pair<string, string> GetWord (const string & s);
+pair<tTempString, tTempString> GetWord (const tTempString & s);
+
+// does any word in a name match (eg. rat for "a large rat")
+bool NameMatches (const string & name, const string & word);
   
 #endif // TINYMUDSERVER_STRINGS_H
 
@@ -17,11 +17,16 @@ warranty, and with no claim as to its suitability for any purpose.
 // standard library includes ...
 
 #include <iostream>
+#include <string>
 
 using namespace std; 
 
 #include "constants.h"
 #include "globals.h"
+#include "journal.h"
+#include "log.h"
+#include "copyover.h"
+#include "gatewaylink.h"
 
 void LoadThings ();
 int InitComms ();
@@ -29,38 +34,102 @@ void MainLoop ();
 void CloseComms ();
    
 
-// called approximately every 0.5 seconds - handle things like fights here
-void PeriodicUpdates ()
-  {
-    //      The example below just sends a message every MESSAGE_INTERVAL seconds.
-    // send new command if it is time
-  if (time (NULL) > (tLastMessage + MESSAGE_INTERVAL))
-    {
-    SendToAll ("You hear creepy noises ...\n");
-    tLastMessage = time (NULL);
-    }
-    
-  } // end of PeriodicUpdates
-  
-
 // main program
-int main ()
+int main (int argc, char * argv [])
 {
   cout << "Tiny MUD server version " << VERSION << endl;
 
+  // --log <file>      log to a file rather than stdout (see log.h)
+  // --record <file>   journal player input (see journal.h)
+  // --replay <file>   play a journal through the game, then stop
+  // --fast            replay without waiting between events
+  // --copyover        carry on from before a copyover (see copyover.h)
+  // --gateway         players connect to the gateway process, not to us (see gatewayipc.h)
+  string logfile, recordfile, replayfile;
+  bool fast = false, copyover = false, gateway = false;
+  for (int i = 1; i < argc; ++i)
+    {
+    const string arg = argv [i];
+    if (arg == "--log" && i + 1 < argc)
+      logfile = argv [++i];
+    else if (arg == "--record" && i + 1 < argc)
+      recordfile = argv [++i];
+    else if (arg == "--replay" && i + 1 < argc)
+      replayfile = argv [++i];
+    else if (arg == "--fast")
+      fast = true;
+    else if (arg == "--copyover")
+      copyover = true;
+    else if (arg == "--gateway")
+      gateway = true;
+    else
+      {
+      cerr << "Usage: " << argv [0] 
+           << " [--log <file>] [--record <file>] [--replay <file> [--fast]] [--gateway]" << endl;
+      return 1;
+      }
+    }
+    
+  // the journal sets the game's clock, so do it before loading mobiles etc.
+  if (!replayfile.empty () && !LoadJournal (replayfile))
+    return 1;
+    
   LoadThings ();    // load stuff
   
+  if (!StartLogging (logfile))
+    return 1;
+    
+  if (!replayfile.empty ())
+    {
+    workerpool.Start (WORKER_THREADS);
+    // background jobs finish in the order they were started
+    const int result = backgroundpool.Start (0, true) ? Replay (fast) : 1;
+    workerpool.Stop ();
+    backgroundpool.Stop ();
+    StopLogging ();
+    return result;
+    }
+    
+  if (!recordfile.empty () && !StartRecording (recordfile))
+    return 1;
+    
+  workerpool.Start (WORKER_THREADS);  // threads for room commands
+  if (!backgroundpool.Start (BACKGROUND_THREADS, true))  // threads for password hashing
+    return 1;
+  
+  // players (and the listening socket) from before a copyover
+  if (copyover)
+    RecoverCopyover ();
+  
+  if (gateway && !AttachGateway ())
+    return 1;
+    
   if (InitComms ()) // listen for new connections
     return 1;
 
-  cout << "Accepting connections from port " <<  PORT << endl;
+  if (!gateway)
+    cout << "Accepting connections from port " <<  PORT << endl;
   
   MainLoop ();    // handle player input/output
 
+  // restart without dropping anyone?
+  while (bCopyover)
+    {
+    Copyover (argv);    // only comes back if it couldn't, so carry on
+    bStopNow = bCopyover = false;
+    MainLoop ();
+    }
+
   // game over - tell them all
   SendToAll ("\n\n** Game shut down. **\n\n");
   
   CloseComms ();  // stop listening
+  
+  workerpool.Stop ();
+  backgroundpool.Stop ();
+  
+  StopRecording ();
+  StopLogging ();   // everything logged so far gets written
 
   cout << "Game shut down." << endl;  
   return 0;
@@ -0,0 +1,120 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <vector>
+#include <map>
+#include <stdexcept>
+#include <iostream>
+
+using namespace std; 
+
+#include "utils.h"
+#include "player.h"
+#include "room.h"
+#include "globals.h"
+#include "ahocorasick.h"
+#include "trigger.h"
+
+// the triggers for one room, and their patterns compiled together
+struct tRoomTriggers
+  {
+  vector<tTrigger> triggers;
+  tAhoCorasick patterns;      // pattern ids are indexes into triggers
+  };  // end of tRoomTriggers
+  
+static map<int, tRoomTriggers> roomtriggers;
+
+// what each action does
+static map<string, tTriggerHandler, ciLess> triggerhandlers;
+
+void AddTrigger (const tTrigger & trigger)
+{
+  if (triggerhandlers.find (trigger.action) == triggerhandlers.end ())
+    throw runtime_error ("Unknown trigger action: " + trigger.action);
+    
+  tRoomTriggers & t = roomtriggers [trigger.room];
+  t.patterns.Add (trigger.pattern, t.triggers.size ());
+  t.triggers.push_back (trigger);
+} // end of AddTrigger
+
+void RemoveTriggers (const int & room)
+{
+  roomtriggers.erase (room);
+} // end of RemoveTriggers
+
+/* ---- trigger actions ---- */
+
+// openexit <dir> <vnum>
+static void TriggerOpenExit (tPlayer * p, const tTrigger & trigger)
+{
+  istringstream is (trigger.args);
+  string dir;
+  int vnum;
+  is >> dir >> vnum;
+  if (!is.fail ())
+    FindRoom (trigger.room)->AddExit (dir, vnum);
+} // end of TriggerOpenExit
+
+// closeexit <dir>
+static void TriggerCloseExit (tPlayer * p, const tTrigger & trigger)
+{
+  istringstream is (trigger.args);
+  string dir;
+  is >> dir;
+  FindRoom (trigger.room)->RemoveExit (dir);
+} // end of TriggerCloseExit
+
+// echo - just the message
+static void TriggerEcho (tPlayer * p, const tTrigger & trigger)
+{
+} // end of TriggerEcho
+
+void LoadTriggerHandlers ()
+{
+  triggerhandlers ["openexit"]  = TriggerOpenExit;
+  triggerhandlers ["closeexit"] = TriggerCloseExit;
+  triggerhandlers ["echo"]      = TriggerEcho;
+} // end of LoadTriggerHandlers
+
+// This may be called on a worker thread (say is done in parallel for different 
+// rooms) so it only changes the player's room and its own triggers, and does not
+// add to the map of rooms' triggers.
+void CheckTriggers (tPlayer * p, const tTempString & what)
+{
+  map<int, tRoomTriggers>::iterator i = roomtriggers.find (p->room);
+  if (i == roomtriggers.end ())
+    return;
+    
+  tRoomTriggers & t = i->second;
+  if (!t.patterns.IsBuilt ())
+    t.patterns.Build ();
+    
+  vector<int> found;
+  t.patterns.Match (string (what.begin (), what.end ()), found);  // only rooms with triggers need the copy
+  
+  for (vector<int>::const_iterator id = found.begin (); id != found.end (); ++id)
+    {
+    const tTrigger & trigger = t.triggers [*id];
+    map<string, tTriggerHandler, ciLess>::const_iterator handler = 
+      triggerhandlers.find (trigger.action);
+    if (handler == triggerhandlers.end ())
+      continue;
+      
+    handler->second (p, trigger);
+    if (!trigger.message.empty ())
+      SendToAll (trigger.message, NULL, trigger.room);
+    }
+} // end of CheckTriggers
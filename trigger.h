@@ -0,0 +1,26 @@
+#ifndef TINYMUDSERVER_TRIGGER_H
+#define TINYMUDSERVER_TRIGGER_H
+
+// a trigger - when someone in a room says something containing
+// the pattern, the action happens (eg. open sesame opens an exit)
+struct tTrigger
+  {
+  int room;             // where it works
+  string pattern;       // what they have to say (eg. open sesame)
+  string action;        // what happens (eg. openexit)
+  string args;          // details for the action (eg. n 1004)
+  string message;       // what people in the room see
+  };  // end of tTrigger
+
+// an action handler for triggers
+typedef void (*tTriggerHandler) (tPlayer * p, const tTrigger & trigger);
+
+// add a trigger, or remove all triggers for a room
+// (the room's patterns are recompiled next time something is said there)
+void AddTrigger (const tTrigger & trigger);
+void RemoveTriggers (const int & room);
+
+// check what was said (or emoted) against the triggers for their room
+void CheckTriggers (tPlayer * p, const tTempString & what);
+
+#endif // TINYMUDSERVER_TRIGGER_H
@@ -0,0 +1,215 @@
+/*
+
+ tinymudserver - an example MUD server
+
+ Author:  Nick Gammon 
+          http://www.gammon.com.au/ 
+
+(C) Copyright Nick Gammon 2004. Permission to copy, use, modify, sell and
+distribute this software is granted provided this copyright notice appears
+in all copies. This software is provided "as is" without express or implied
+warranty, and with no claim as to its suitability for any purpose.
+ 
+*/
+
+// standard library includes ...
+
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+using namespace std; 
+
+#include "constants.h"
+#include "workers.h"
+#include "log.h"
+
+tWorkerPool::tWorkerPool () : outstanding (0), stopping (false)
+{
+  wakeup [0] = wakeup [1] = NO_SOCKET;
+  pthread_mutex_init (&lock, NULL);
+  pthread_cond_init (&workAvailable, NULL);
+  pthread_cond_init (&workDone, NULL);
+} // end of tWorkerPool::tWorkerPool
+
+tWorkerPool::~tWorkerPool ()
+{
+  Stop ();
+  pthread_cond_destroy (&workDone);
+  pthread_cond_destroy (&workAvailable);
+  pthread_mutex_destroy (&lock);
+} // end of tWorkerPool::~tWorkerPool
+
+bool tWorkerPool::Start (const int count, const bool background)
+{
+  stopping = false;
+  
+  // background jobs say they are done by writing to this pipe
+  if (background)
+    {
+    if (pipe (wakeup) == -1)
+      {
+      LogError ("pipe for background jobs");
+      wakeup [0] = wakeup [1] = NO_SOCKET;
+      return false;   // nobody would ever hear about them
+      }
+    fcntl (wakeup [0], F_SETFL, O_NONBLOCK);
+    fcntl (wakeup [1], F_SETFL, O_NONBLOCK);
+    }
+  
+  for (int i = 0; i < count; ++i)
+    {
+    pthread_t thread;
+    if (pthread_create (&thread, NULL, ThreadMain, this) != 0)
+      {
+      cerr << "Could not start worker thread" << endl;
+      break;
+      }
+    threads.push_back (thread);
+    }
+  return true;
+} // end of tWorkerPool::Start
+
+void tWorkerPool::Stop ()
+{
+  pthread_mutex_lock (&lock);
+  stopping = true;
+  
+  // don't start any more slow work
+  for (deque<tAsyncJob*>::const_iterator i = background.begin (); i != background.end (); ++i)
+    delete *i;
+  background.clear ();
+  
+  pthread_cond_broadcast (&workAvailable);
+  pthread_mutex_unlock (&lock);
+  
+  for (vector<pthread_t>::const_iterator i = threads.begin (); i != threads.end (); ++i)
+    pthread_join (*i, NULL);
+  threads.clear ();
+  
+  // nobody is waiting for these any more
+  for (deque<tAsyncJob*>::const_iterator i = finished.begin (); i != finished.end (); ++i)
+    delete *i;
+  finished.clear ();
+  
+  if (wakeup [0] != NO_SOCKET)
+    {
+    close (wakeup [0]);
+    close (wakeup [1]);
+    wakeup [0] = wakeup [1] = NO_SOCKET;
+    }
+} // end of tWorkerPool::Stop
+
+void * tWorkerPool::ThreadMain (void * arg)
+{
+  static_cast<tWorkerPool *> (arg)->WorkerLoop ();
+  return NULL;
+} // end of tWorkerPool::ThreadMain
+
+// each worker thread takes jobs from the queue until we stop
+void tWorkerPool::WorkerLoop ()
+{
+  pthread_mutex_lock (&lock);
+  while (true)
+    {
+    while (pending.empty () && background.empty () && !stopping)
+      pthread_cond_wait (&workAvailable, &lock);
+    
+    // batch jobs first - the main thread is waiting for those
+    if (pending.empty ())
+      {
+      if (background.empty ())
+        break;    // stopping, and nothing left to do
+      
+      tAsyncJob * job = background.front ();
+      background.pop_front ();
+      
+      pthread_mutex_unlock (&lock);
+      job->Run ();
+      pthread_mutex_lock (&lock);
+      
+      finished.push_back (job);
+      if (write (wakeup [1], "", 1) == -1 && errno != EAGAIN)
+        LogError ("write to wakeup pipe");   // if the pipe is full it is already readable
+      continue;
+      }
+      
+    tJob * job = pending.front ();
+    pending.pop_front ();
+    
+    pthread_mutex_unlock (&lock);
+    job->Run ();
+    pthread_mutex_lock (&lock);
+    
+    if (--outstanding == 0)
+      pthread_cond_signal (&workDone);
+    } // end of processing jobs
+  pthread_mutex_unlock (&lock);
+} // end of tWorkerPool::WorkerLoop
+
+void tWorkerPool::RunAll (const vector<tJob*> & jobs)
+{
+  // no threads? just do them here
+  if (threads.empty ())
+    {
+    for (vector<tJob*>::const_iterator i = jobs.begin (); i != jobs.end (); ++i)
+      (*i)->Run ();
+    return;
+    }
+    
+  pthread_mutex_lock (&lock);
+  pending.insert (pending.end (), jobs.begin (), jobs.end ());
+  outstanding += jobs.size ();
+  pthread_cond_broadcast (&workAvailable);
+  
+  // wait for all of them to finish
+  while (outstanding > 0)
+    pthread_cond_wait (&workDone, &lock);
+  pthread_mutex_unlock (&lock);
+} // end of tWorkerPool::RunAll
+
+bool tWorkerPool::Submit (tAsyncJob * job)
+{
+  // no threads? do it here, it will be finished next time around
+  if (threads.empty ())
+    {
+    job->Run ();
+    finished.push_back (job);
+    if (write (wakeup [1], "", 1) == -1 && errno != EAGAIN)
+      LogError ("write to wakeup pipe");
+    return true;
+    }
+    
+  pthread_mutex_lock (&lock);
+  const bool room = background.size () < MAX_BACKGROUND_JOBS;
+  if (room)
+    {
+    background.push_back (job);
+    pthread_cond_signal (&workAvailable);
+    }
+  pthread_mutex_unlock (&lock);
+  return room;
+} // end of tWorkerPool::Submit
+
+void tWorkerPool::FinishJobs ()
+{
+  // empty the pipe
+  char buf [256];
+  while (wakeup [0] != NO_SOCKET && read (wakeup [0], buf, sizeof buf) > 0)
+    {}
+    
+  deque<tAsyncJob*> done;
+  pthread_mutex_lock (&lock);
+  done.swap (finished);
+  pthread_mutex_unlock (&lock);
+  
+  // Finish may well submit more jobs, so we don't hold the lock for this
+  for (deque<tAsyncJob*>::const_iterator i = done.begin (); i != done.end (); ++i)
+    {
+    if (!(*i)->Cancelled ())
+      (*i)->Finish ();
+    delete *i;
+    }
+} // end of tWorkerPool::FinishJobs
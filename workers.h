@@ -0,0 +1,70 @@
+#ifndef TINYMUDSERVER_WORKERS_H
+#define TINYMUDSERVER_WORKERS_H
+
+#include <vector>
+#include <deque>
+#include <pthread.h>
+
+// a piece of work to be done on a worker thread
+class tJob
+  {
+  public:
+  virtual ~tJob () {}
+  virtual void Run () = 0;  // called on a worker thread - must not touch shared state
+  };  // end of class tJob
+
+// a piece of work done in the background, with the result handed back to the main thread
+class tAsyncJob : public tJob
+  {
+  bool cancelled;   // main thread only
+  
+  public:
+  tAsyncJob () : cancelled (false) {}
+  virtual void Finish () = 0;   // called on the main thread after Run
+  
+  // whoever was waiting for it has gone - Finish won't be called
+  void Cancel () { cancelled = true; }
+  bool Cancelled () const { return cancelled; }
+  };  // end of class tAsyncJob
+
+/*---------------------------------------------- */
+/*  worker pool - threads to do work off the main thread */
+/*---------------------------------------------- */
+
+class tWorkerPool
+  {
+  std::vector<pthread_t> threads;   // our workers
+  std::deque<tJob*> pending;        // jobs waiting for a worker
+  std::deque<tAsyncJob*> background;  // background jobs waiting for a worker
+  std::deque<tAsyncJob*> finished;  // background jobs waiting for Finish
+  int wakeup [2];                   // pipe written to when a background job finishes
+  pthread_mutex_t lock;             // protects everything below
+  pthread_cond_t workAvailable;     // signalled when a job is queued
+  pthread_cond_t workDone;          // signalled when a batch job finishes
+  int outstanding;                  // batch jobs not yet finished
+  bool stopping;                    // true when shutting down
+
+  static void * ThreadMain (void * arg);
+  void WorkerLoop ();
+  
+  public:
+  
+  tWorkerPool ();
+  ~tWorkerPool ();
+  
+  // start the threads (and the wakeup pipe, if it will run background jobs) - false if we can't
+  bool Start (const int count, const bool background = false);
+  void Stop ();                   // finish current jobs, stop the threads
+  
+  // run all of these jobs, in parallel, and wait for them all to finish
+  void RunAll (const std::vector<tJob*> & jobs);
+  
+  // queue a job to run in the background - false if too many are waiting already
+  bool Submit (tAsyncJob * job);
+  // readable when background jobs have finished (add it to the select)
+  int WakeupFd () const { return wakeup [0]; }
+  // call Finish for finished background jobs, and delete them
+  void FinishJobs ();
+  };  // end of class tWorkerPool
+
+#endif // TINYMUDSERVER_WORKERS_H